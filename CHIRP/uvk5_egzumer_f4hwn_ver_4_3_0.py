@@ -684,6 +684,7 @@ VOX_LIST = ["OFF", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10"]
 MEM_SIZE = 0x2000 # size of all memory
 PROG_SIZE = 0x1d00  # size of the memory that we will write
 MEM_BLOCK = 0x80  # largest block of memory that we can reliably write
+CRC_BLOCK = 0x20  # block size for the block CRC query used by incremental uploads
 CAL_START = 0x1E00  # calibration memory start address
 F4HWN_START =0x1FF2 # calibration F4HWN memory start address
 
@@ -916,6 +917,52 @@ def _writemem(serport, data, offset):
     raise errors.RadioError("Bad response to writemem")
 
 
+def _readcrcs(serport, offset, length):
+    """CRC-16/XMODEM of every CRC_BLOCK block in the range (command 0x060A),
+    or None if the firmware doesn't know the command"""
+    LOG.debug("Sending readcrcs offset=0x%4.4x len=0x%4.4x", offset, length)
+
+    readcrcs = b"\x0a\x06\x0c\x00" + \
+        struct.pack("<HHBBBB", offset, length, CRC_BLOCK, 0, 0, 0) + \
+        b"\x6a\x39\x57\x64"
+    _send_command(serport, readcrcs)
+
+    count = (length + CRC_BLOCK - 1) // CRC_BLOCK
+    crcs = []
+    while len(crcs) < count:
+        try:
+            rep = _receive_reply(serport)
+        except errors.RadioError:
+            if crcs:
+                raise
+            LOG.info("Firmware has no block CRC command, uploading everything")
+            return None
+        if rep[0] != 0x0b or rep[1] != 0x06:
+            raise errors.RadioError("Bad response to readcrcs")
+        crcs += struct.unpack_from("<%dH" % rep[7], rep, 8)
+
+    return crcs
+
+
+def _changed_blocks(radio, serport, start_addr, stop_addr):
+    """(address, length) runs of at most MEM_BLOCK that differ from the radio"""
+    crcs = _readcrcs(serport, start_addr, stop_addr - start_addr)
+    mmap = radio.get_mmap()
+    runs = []
+    for i in range(start_addr, stop_addr, CRC_BLOCK):
+        if crcs is not None:
+            end = min(i + CRC_BLOCK, stop_addr)
+            if calculate_crc16_xmodem(mmap[i:end]) == crcs[(i - start_addr) // CRC_BLOCK]:
+                continue
+        # writemem stores whole 8 byte blocks
+        length = (min(CRC_BLOCK, stop_addr - i) + 7) & ~7
+        if runs and runs[-1][0] + runs[-1][1] == i and runs[-1][1] < MEM_BLOCK:
+            runs[-1][1] += length
+        else:
+            runs.append([i, length])
+    return runs
+
+
 def _resetradio(serport):
     resetpacket = b"\xdd\x05\x00\x00"
     _send_command(serport, resetpacket)
@@ -983,17 +1030,14 @@ def do_upload(radio):
  
     while mstep < 2: # stop when 2
         
-        addr = start_addr
-        while addr < stop_addr:
-            dat = radio.get_mmap()[addr:addr+MEM_BLOCK]
+        # only the blocks that differ from what the radio holds
+        for addr, length in _changed_blocks(radio, serport, start_addr, stop_addr):
+            dat = radio.get_mmap()[addr:addr+length]
+            if not dat:
+                raise errors.RadioError("Memory upload incomplete")
             _writemem(serport, dat, addr)
             status.cur = addr - start_addr
             radio.status_fn(status)
-            if dat:
-                addr += MEM_BLOCK
-            else:
-                raise errors.RadioError("Memory upload incomplete")
-                mstep = 2 # on error stop loop
 
         mstep += 1 # go to next step
                     
@@ -0,0 +1,52 @@
+// SARADC stand-in for the host simulator: a healthy battery, no charger.
+
+#include "driver/adc.h"
+#include "sim.h"
+
+#define ADC_BATTERY_RAW 2000u   // ~7.6 V with the default calibration
+
+uint8_t ADC_GetChannelNumber(ADC_CH_MASK Mask)
+{
+    for (uint8_t i = 0; i < 16; i++)
+        if (Mask & (1u << i))
+            return i;
+    return 0;
+}
+
+void ADC_Disable(void)
+{
+}
+
+void ADC_Enable(void)
+{
+}
+
+void ADC_SoftReset(void)
+{
+}
+
+uint32_t ADC_GetClockConfig(void)
+{
+    return 0;
+}
+
+void ADC_Configure(ADC_Config_t *pAdc)
+{
+    (void)pAdc;
+}
+
+void ADC_Start(void)
+{
+    SIM_AdvanceUs(20);
+}
+
+bool ADC_CheckEndOfConversion(ADC_CH_MASK Mask)
+{
+    (void)Mask;
+    return true;
+}
+
+uint16_t ADC_GetValue(ADC_CH_MASK Mask)
+{
+    return (Mask == ADC_CH4) ? ADC_BATTERY_RAW : 0;
+}
@@ -0,0 +1,158 @@
+// Host microbenchmarks of firmware code for the simulator.
+//
+// Started by a "bench <name>" script event, they run the firmware's own
+// functions on the host CPU next to a reference written the way the code
+// used to be, check that both give the same answers and time them. The
+// times are host nanoseconds: good for comparing the two, not M0 cycles.
+// Tables a benchmark changes are put back before it returns.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "misc.h"
+#include "radio.h"
+#include "settings.h"
+#include "sim.h"
+
+#define BENCH_HOPS  2000000
+
+static uint32_t gBenchRandom = 1;
+
+static uint32_t Random(void)
+{
+    gBenchRandom ^= gBenchRandom << 13;
+    gBenchRandom ^= gBenchRandom >> 17;
+    gBenchRandom ^= gBenchRandom << 5;
+    return gBenchRandom;
+}
+
+static double Now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// RADIO_FindNextChannel before the channel bitmaps: every channel in turn
+static uint8_t FindNextChannelLoop(uint8_t Channel, int8_t Direction, bool bCheckScanList, uint8_t VFO)
+{
+    for (unsigned int i = 0; IS_MR_CHANNEL(i); i++, Channel += Direction) {
+        if (Channel == 0xFF) {
+            Channel = MR_CHANNEL_LAST;
+        } else if (!IS_MR_CHANNEL(Channel)) {
+            Channel = MR_CHANNEL_FIRST;
+        }
+
+        if (RADIO_CheckValidChannel(Channel, bCheckScanList, VFO)) {
+            return Channel;
+        }
+    }
+
+    return 0xFF;
+}
+
+static void UpdateAllBitmaps(void)
+{
+    for (unsigned int c = 0; IS_MR_CHANNEL(c); c++)
+        RADIO_UpdateChannelBitmaps(c);
+}
+
+// ns per hop through scan list 1, each search starting past the last hit
+static void TimeHops(const char *pName)
+{
+    volatile unsigned sink = 0;
+    uint8_t           ch;
+    double            t, loop, bitmap;
+
+    ch = 0;
+    t  = Now();
+    for (int i = 0; i < BENCH_HOPS; i++)
+        sink += ch = FindNextChannelLoop(ch + 1, 1, true, 1);
+    loop = Now() - t;
+
+    ch = 0;
+    t  = Now();
+    for (int i = 0; i < BENCH_HOPS; i++)
+        sink += ch = RADIO_FindNextChannel(ch + 1, 1, true, 1);
+    bitmap = Now() - t;
+
+    (void)sink;
+    fprintf(stderr, "bench channels %s: loop %.1f ns, bitmap %.1f ns per hop\n",
+            pName, loop / BENCH_HOPS * 1e9, bitmap / BENCH_HOPS * 1e9);
+}
+
+static void BenchChannels(void)
+{
+    ChannelAttributes_t attributes[sizeof(gMR_ChannelAttributes) / sizeof(gMR_ChannelAttributes[0])];
+    bool                exclude[sizeof(gMR_ChannelExclude)];
+    uint8_t             priority[2][3];
+    unsigned            cases = 0, mismatches = 0;
+
+    memcpy(attributes, gMR_ChannelAttributes, sizeof(attributes));
+    memcpy(exclude, gMR_ChannelExclude, sizeof(exclude));
+    memcpy(priority[0], gEeprom.SCANLIST_PRIORITY_CH1, 3);
+    memcpy(priority[1], gEeprom.SCANLIST_PRIORITY_CH2, 3);
+
+    // random attributes, exclusions and priority channels; every start
+    // channel, direction, list and check mode against the loop
+    for (int table = 0; table < 200; table++) {
+        for (unsigned int c = 0; IS_MR_CHANNEL(c); c++) {
+            gMR_ChannelAttributes[c].__val = Random() & 0xFF;
+            gMR_ChannelExclude[c]          = Random() % 7 == 0;
+        }
+        for (int i = 0; i < 3; i++) {
+            gEeprom.SCANLIST_PRIORITY_CH1[i] = Random() & 0xFF;
+            gEeprom.SCANLIST_PRIORITY_CH2[i] = Random() & 0xFF;
+        }
+        UpdateAllBitmaps();
+
+        for (int start = 0; start < 256; start++)
+            for (int dir = -1; dir <= 1; dir += 2)
+                for (int check = 0; check < 2; check++)
+                    for (int list = 1; list < 7; list++, cases++)
+                        if (FindNextChannelLoop(start, dir, check, list) != RADIO_FindNextChannel(start, dir, check, list))
+                            mismatches++;
+    }
+    fprintf(stderr, "bench channels %u cases, %u mismatches\n", cases, mismatches);
+
+    // a sparse list: 5 of 200 channels, a third of the rest empty
+    for (unsigned int c = 0; IS_MR_CHANNEL(c); c++) {
+        gMR_ChannelAttributes[c].__val = 0;
+        gMR_ChannelAttributes[c].band  = (c % 3 == 0) ? 7 : 2;
+        gMR_ChannelExclude[c]          = false;
+    }
+    gMR_ChannelAttributes[3].scanlist1   = 1;
+    gMR_ChannelAttributes[50].scanlist1  = 1;
+    gMR_ChannelAttributes[51].scanlist1  = 1;
+    gMR_ChannelAttributes[120].scanlist1 = 1;
+    gMR_ChannelAttributes[190].scanlist1 = 1;
+    gEeprom.SCANLIST_PRIORITY_CH1[0] = 0xFF;
+    gEeprom.SCANLIST_PRIORITY_CH2[0] = 0xFF;
+    UpdateAllBitmaps();
+    TimeHops("sparse 5/200");
+
+    // every channel in the list
+    for (unsigned int c = 0; IS_MR_CHANNEL(c); c++) {
+        gMR_ChannelAttributes[c].band      = 2;
+        gMR_ChannelAttributes[c].scanlist1 = 1;
+    }
+    UpdateAllBitmaps();
+    TimeHops("full 200/200");
+
+    memcpy(gMR_ChannelAttributes, attributes, sizeof(attributes));
+    memcpy(gMR_ChannelExclude, exclude, sizeof(exclude));
+    memcpy(gEeprom.SCANLIST_PRIORITY_CH1, priority[0], 3);
+    memcpy(gEeprom.SCANLIST_PRIORITY_CH2, priority[1], 3);
+    UpdateAllBitmaps();
+}
+
+void SIM_Bench_Run(const char *pName)
+{
+    if (strcmp(pName, "channels") == 0)
+        BenchChannels();
+    else
+        fprintf(stderr, "bench: no benchmark '%s'\n", pName);
+}
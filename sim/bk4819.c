@@ -0,0 +1,359 @@
+// Register-level BK4819 model for the host simulator.
+//
+// Stands in for the bit-banged bus in driver/bk4819.c. The register file is
+// plain memory; on top of it the model knows just enough to drive the
+// firmware: the PLL retunes on a REG_30 off/on toggle and takes a while to
+// settle (glitch indicator reads 255 meanwhile), RSSI/noise/glitch follow a
+// scripted band occupancy, and squelch open/close raises interrupts through
+// REG_0C/REG_02. Every transaction costs roughly what the real bus does.
+//
+// FSK reception is modelled at the FIFO: a scripted packet arrives one word
+// per 16 bit times, raises FIFO-almost-full at the REG_5E threshold and is
+// lost word by word once the 8 word RX FIFO overflows. FSK TX takes the
+// same air time and ends with FSK-TX-finished; the words written to the TX
+// FIFO then go to the remote station model.
+
+#include <stddef.h>
+#include <string.h>
+
+#include "driver/bk4819.h"
+#include "sim.h"
+
+#define BUS_WRITE_US    76u     // 24 clocks at ~3 us plus chip select
+#define BUS_READ_US     60u
+
+#define MAX_SIGNALS     64
+#define FSK_FIFO_WORDS  8
+#define FSK_WORD_US     13333u  // 16 bits at 1200 bit/s
+#define FSK_MAX_PACKET  128
+#define CHANNEL_HALF_BW 1250u   // 12.5 kHz in 10 Hz units
+#define NOISE_FLOOR_DBM (-128)
+
+typedef struct {
+    uint32_t Frequency;
+    int16_t  dBm;
+    uint32_t FromMs;
+    uint32_t ToMs;
+} Signal_t;
+
+SIM_BK4819_Stats_t gSimBK4819_Stats;
+
+static uint16_t gRegs[0x80];
+static uint16_t gIrqPending;
+static uint16_t gIrqLatched;
+static uint64_t gSettledAtUs;
+static bool     gSquelchOpen;
+static uint32_t gNoiseSeed = 0x4819;
+
+static Signal_t gSignals[MAX_SIGNALS];
+static unsigned gSignalCount;
+
+static uint8_t  gFskPacket[FSK_MAX_PACKET];
+static unsigned gFskLength;
+static unsigned gFskNext;               // next packet byte to arrive
+static uint64_t gFskNextWordUs;
+static uint16_t gFskFifo[FSK_FIFO_WORDS];
+static uint64_t gFskFifoTimeUs[FSK_FIFO_WORDS];
+static unsigned gFskFifoCount;
+static uint64_t gFskTxDoneUs;           // 0 while no FSK TX is in progress
+static uint8_t  gFskTxPacket[FSK_MAX_PACKET];
+static unsigned gFskTxLength;
+static uint64_t gKeyUpUs;
+
+// cheap deterministic jitter, -Range .. +Range
+static int Jitter(int Range)
+{
+    gNoiseSeed = gNoiseSeed * 1103515245u + 12345u;
+    return (int)((gNoiseSeed >> 16) % (2u * Range + 1u)) - Range;
+}
+
+uint32_t SIM_BK4819_GetFrequency(void)
+{
+    return ((uint32_t)gRegs[BK4819_REG_39] << 16) | gRegs[BK4819_REG_38];
+}
+
+void SIM_BK4819_AddSignal(uint32_t Frequency, int16_t dBm, uint32_t FromMs, uint32_t ToMs)
+{
+    if (gSignalCount >= MAX_SIGNALS)
+        return;
+
+    gSignals[gSignalCount++] = (Signal_t){Frequency, dBm, FromMs, ToMs};
+}
+
+void SIM_BK4819_RaiseInterrupt(uint16_t Flags)
+{
+    gIrqPending |= Flags & gRegs[BK4819_REG_3F];
+}
+
+void SIM_BK4819_ReceiveFSK(const void *pData, unsigned Size)
+{
+    const unsigned packet = gRegs[BK4819_REG_5D] >> 8;     // bytes the chip expects
+
+    memset(gFskPacket, 0, sizeof(gFskPacket));
+    memcpy(gFskPacket, pData, Size < FSK_MAX_PACKET ? Size : FSK_MAX_PACKET);
+    gFskLength     = packet ? (packet < FSK_MAX_PACKET ? packet : FSK_MAX_PACKET) : Size;
+    gFskNext       = 0;
+    gFskNextWordUs = SIM_GetTimeUs() + FSK_WORD_US;
+    SIM_BK4819_RaiseInterrupt(BK4819_REG_02_FSK_RX_SYNC);
+}
+
+// deliver the words whose air time has passed
+static void UpdateFSK(void)
+{
+    const uint64_t now = SIM_GetTimeUs();
+
+    if (gFskTxDoneUs && gFskTxDoneUs <= now) {
+        gFskTxDoneUs = 0;
+        SIM_BK4819_RaiseInterrupt(BK4819_REG_02_FSK_TX_FINISHED);
+        SIM_Peer_Transmitted(gFskTxPacket, gFskTxLength);
+    }
+
+    while (gFskNext < gFskLength && gFskNextWordUs <= now) {
+        const uint16_t word = gFskPacket[gFskNext] | (gFskPacket[gFskNext + 1] << 8);
+
+        if (!(gRegs[BK4819_REG_59] & (1u << 12))) {
+            // FSK RX is off (e.g. the messenger is sending its receipt)
+        } else if (gFskFifoCount < FSK_FIFO_WORDS) {
+            gFskFifo[gFskFifoCount]       = word;
+            gFskFifoTimeUs[gFskFifoCount] = gFskNextWordUs;
+            gFskFifoCount++;
+        } else {
+            gSimBK4819_Stats.FskOverruns++;
+        }
+
+        gSimBK4819_Stats.FskWords++;
+        gFskNext += 2;
+        gFskNextWordUs += FSK_WORD_US;
+
+        if (gFskFifoCount >= (gRegs[BK4819_REG_5E] & 7u))
+            SIM_BK4819_RaiseInterrupt(BK4819_REG_02_FSK_FIFO_ALMOST_FULL);
+        if (gFskNext >= gFskLength)
+            SIM_BK4819_RaiseInterrupt(BK4819_REG_02_FSK_RX_FINISHED);
+    }
+}
+
+static uint16_t ReadFSK(void)
+{
+    uint16_t word;
+    uint64_t age;
+
+    if (gFskFifoCount == 0)
+        return 0;
+
+    word = gFskFifo[0];
+    age  = SIM_GetTimeUs() - gFskFifoTimeUs[0];
+    if (age > gSimBK4819_Stats.FskMaxAgeUs)
+        gSimBK4819_Stats.FskMaxAgeUs = age;
+
+    gFskFifoCount--;
+    memmove(gFskFifo, gFskFifo + 1, gFskFifoCount * sizeof(gFskFifo[0]));
+    memmove(gFskFifoTimeUs, gFskFifoTimeUs + 1, gFskFifoCount * sizeof(gFskFifoTimeUs[0]));
+    return word;
+}
+
+static bool IsReceiving(void)
+{
+    return (gRegs[BK4819_REG_30] & BK4819_REG_30_ENABLE_RX_DSP) != 0;
+}
+
+static bool IsSettled(void)
+{
+    return SIM_GetTimeUs() >= gSettledAtUs;
+}
+
+// strongest scripted carrier inside the channel we are tuned to
+static int16_t GetSignal_dBm(void)
+{
+    const uint32_t now_ms = (uint32_t)(SIM_GetTimeUs() / 1000);
+    const uint32_t f      = SIM_BK4819_GetFrequency();
+    int16_t        best   = NOISE_FLOOR_DBM;
+
+    if (!IsReceiving() || !IsSettled())
+        return best;
+
+    for (unsigned i = 0; i < gSignalCount; i++) {
+        const Signal_t *s = &gSignals[i];
+        const uint32_t delta = (f > s->Frequency) ? f - s->Frequency : s->Frequency - f;
+
+        if (delta > CHANNEL_HALF_BW || now_ms < s->FromMs || (s->ToMs && now_ms >= s->ToMs))
+            continue;
+
+        if (s->dBm > best)
+            best = s->dBm;
+    }
+
+    return best;
+}
+
+static uint16_t GetRssi(void)
+{
+    const int dBm = GetSignal_dBm() + Jitter(1);
+    const int raw = (dBm + 160) * 2;
+    return raw < 0 ? 0 : (raw > 0x1FF ? 0x1FF : raw);
+}
+
+static uint8_t GetNoise(void)
+{
+    const int above = GetSignal_dBm() - NOISE_FLOOR_DBM;
+    const int noise = (above > 6 ? 70 - above * 2 : 72) + Jitter(3);
+    return noise < 0 ? 0 : (noise > 0x7F ? 0x7F : noise);
+}
+
+static uint8_t GetGlitch(void)
+{
+    if (IsReceiving() && !IsSettled())
+        return 255;
+
+    const int above  = GetSignal_dBm() - NOISE_FLOOR_DBM;
+    const int glitch = (above > 6 ? 40 - above : 90) + Jitter(8);
+    return glitch < 0 ? 0 : (glitch > 254 ? 254 : glitch);
+}
+
+static void UpdateSquelch(void)
+{
+    if (!IsReceiving() || !IsSettled())
+        return;
+
+    const uint16_t rssi   = GetRssi();
+    const uint8_t  noise  = GetNoise();
+    const uint8_t  glitch = GetGlitch();
+    bool           open;
+
+    if (!gSquelchOpen)
+        open = rssi >= (gRegs[BK4819_REG_78] >> 8) &&
+               noise <= (gRegs[BK4819_REG_4F] & 0x7F) &&
+               glitch <= (gRegs[BK4819_REG_4E] & 0xFF);
+    else
+        open = !(rssi < (gRegs[BK4819_REG_78] & 0xFF) ||
+                 noise > ((gRegs[BK4819_REG_4F] >> 8) & 0x7F) ||
+                 glitch > (gRegs[BK4819_REG_4D] & 0xFF));
+
+    if (open == gSquelchOpen)
+        return;
+
+    gSquelchOpen = open;
+
+    // "squelch lost" is the chip's name for the squelch opening
+    SIM_BK4819_RaiseInterrupt(open ? BK4819_REG_02_SQUELCH_LOST : BK4819_REG_02_SQUELCH_FOUND);
+}
+
+static void Retune(void)
+{
+    static uint32_t last_frequency;
+    const uint32_t  f     = SIM_BK4819_GetFrequency();
+    const uint32_t  delta = (f > last_frequency) ? f - last_frequency : last_frequency - f;
+    uint32_t        settle_us;
+
+    // small hops lock quickly, big jumps need a full VCO calibration
+    settle_us = 350 + (delta / 10000u) * 40u;
+    if (settle_us > 2000)
+        settle_us = 2000;
+
+    gSettledAtUs   = SIM_GetTimeUs() + settle_us;
+    last_frequency = f;
+    gSquelchOpen   = false;
+    gSimBK4819_Stats.Retunes++;
+}
+
+uint16_t BK4819_BusRead(BK4819_REGISTER_t Register)
+{
+    gSimBK4819_Stats.BusReads++;
+    SIM_AdvanceUs(BUS_READ_US);
+    UpdateFSK();
+
+    switch (Register) {
+        case BK4819_REG_02:
+            return gIrqLatched;
+
+        case BK4819_REG_0C:
+            UpdateSquelch();
+            return (gIrqPending ? 1u : 0u) | (gSquelchOpen ? 2u : 0u);
+
+        case BK4819_REG_63:
+            return GetGlitch();
+
+        case BK4819_REG_65:
+            return GetNoise();
+
+        case BK4819_REG_67:
+            return GetRssi();
+
+        case BK4819_REG_5F:
+            return ReadFSK();
+
+        case BK4819_REG_0D:
+        case BK4819_REG_0E:
+        case BK4819_REG_64:
+        case BK4819_REG_68:
+        case BK4819_REG_69:
+        case BK4819_REG_6A:
+        case BK4819_REG_6F:
+            return 0;
+
+        default:
+            return (Register < 0x80) ? gRegs[Register] : 0;
+    }
+}
+
+void BK4819_BusWrite(BK4819_REGISTER_t Register, uint16_t Data)
+{
+    gSimBK4819_Stats.BusWrites++;
+    SIM_AdvanceUs(BUS_WRITE_US);
+    UpdateFSK();
+
+    if (Register >= 0x80)
+        return;
+
+    const uint16_t previous = gRegs[Register];
+
+    switch (Register) {
+        case BK4819_REG_00:
+            if (Data & 0x8000) {
+                for (unsigned i = 0; i < 0x80; i++)
+                    gRegs[i] = 0;
+                gIrqPending = gIrqLatched = 0;
+                gSquelchOpen = false;
+            }
+            return;
+
+        case BK4819_REG_02:
+            gIrqLatched = gIrqPending;
+            gIrqPending = 0;
+            return;
+
+        case BK4819_REG_59:
+            gRegs[Register] = Data;
+            if (Data & (1u << 15))
+                gFskTxLength = 0;           // clear TX FIFO
+            if (Data & (1u << 14))
+                gFskFifoCount = 0;          // clear RX FIFO
+            if ((Data & (1u << 11)) && !(previous & (1u << 11)))
+                gFskTxDoneUs = SIM_GetTimeUs() + (gRegs[BK4819_REG_5D] >> 9) * FSK_WORD_US;
+            return;
+
+        case BK4819_REG_5F:
+            if (gFskTxLength + 2 <= FSK_MAX_PACKET) {
+                gFskTxPacket[gFskTxLength++] = Data & 0xFF;
+                gFskTxPacket[gFskTxLength++] = Data >> 8;
+            }
+            return;
+
+        case BK4819_REG_30:
+            gRegs[Register] = Data;
+            if (previous == 0 && (Data & BK4819_REG_30_ENABLE_RX_DSP))
+                Retune();
+            if ((Data ^ previous) & BK4819_REG_30_ENABLE_PA_GAIN) {
+                if (Data & BK4819_REG_30_ENABLE_PA_GAIN) {
+                    gSimBK4819_Stats.KeyUps++;
+                    gKeyUpUs = SIM_GetTimeUs();
+                } else {
+                    gSimBK4819_Stats.TxUs += SIM_GetTimeUs() - gKeyUpUs;
+                }
+            }
+            return;
+
+        default:
+            gRegs[Register] = Data;
+            return;
+    }
+}
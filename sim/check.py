@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Run the simulator regression checks in sim/tests (make sim-check).
+
+    sim/check.py                 every check
+    sim/check.py fec_ber scan    only these
+    sim/check.py -v ...          print each run's whole output
+
+A check is sim/tests/<name>.txt or sim/tests/<name>.c plus the lines it has
+to print in sim/tests/<name>.expected.
+
+<name>.txt is an ordinary simulator script run on a fresh EEPROM image.
+Comment lines at its top may set
+
+    # flags: ENABLE_MESSENGER_FEC=1    make variables for the simulator build
+    # time: 60                         seconds of virtual time (default 10)
+
+and the run's exit report and UART output are checked.
+
+<name>.c is a host program, built with gcc -O2 together with the firmware
+sources named on a "// sources:" line at its top, and its standard output
+and error are checked. It fails the check by exiting non-zero too.
+
+Every line of <name>.expected must match a line of the output: whitespace
+is collapsed, a '*' stands for any one word, and the output line may go on
+past the end of the expected one. Timings in the output are for reading,
+keep them out of the expected lines.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+TESTS = os.path.join(ROOT, 'sim', 'tests')
+BUILD = os.path.join(ROOT, '_build_sim')
+
+HOST_CFLAGS = ['-O2', '-Wall', '-Wextra', '-Werror', '-Wno-unused-function', '-funsigned-char', '-fshort-enums']
+
+
+def header(path, prefix):
+    """The "key: value" settings from the comment block at the top of a file."""
+    settings = {}
+    with open(path) as f:
+        for line in f:
+            if not line.startswith(prefix):
+                break
+            m = re.match(re.escape(prefix) + r'\s*(\w+):\s*(.*)', line)
+            if m:
+                settings[m.group(1)] = m.group(2).strip()
+    return settings
+
+
+def matches(expected, line):
+    want = expected.split()
+    got = line.split()
+    if len(got) < len(want):
+        return False
+    return all(w == '*' or w == g for w, g in zip(want, got))
+
+
+def build_sim(flags):
+    tag = '_'.join(f.split('=')[0].replace('ENABLE_', '').lower() + f.split('=')[1] for f in flags) or 'default'
+    build = os.path.join('_build_sim', 'check', tag)
+    result = subprocess.run(['make', '-s', '-j%d' % (os.cpu_count() or 1), 'sim', 'SIM_BUILD=' + build] + flags,
+                            cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        raise RuntimeError('make sim %s failed:\n%s' % (' '.join(flags), result.stdout))
+    return build
+
+
+def run_script(name, path, builds):
+    settings = header(path, '#')
+    flags = settings.get('flags', '').split()
+    key = tuple(flags)
+    if key not in builds:
+        builds[key] = build_sim(flags)
+    build = os.path.join(ROOT, builds[key])
+
+    eeprom = os.path.join(build, name + '.eeprom')
+    uart = os.path.join(build, name + '.uart')
+    for stale in (eeprom, uart):
+        if os.path.exists(stale):
+            os.remove(stale)
+
+    result = subprocess.run([os.path.join(build, 'uv-kx_sim'), '-e', eeprom, '-s', path,
+                             '-t', settings.get('time', '10'), '-u', uart],
+                            cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    output = result.stdout
+    if os.path.exists(uart):
+        with open(uart, 'rb') as f:
+            output += f.read().decode('latin-1')
+    return result.returncode == 0, output
+
+
+def run_host(name, path):
+    settings = header(path, '//')
+    build = os.path.join(BUILD, 'check', 'host')
+    os.makedirs(build, exist_ok=True)
+    binary = os.path.join(build, name)
+    sources = [os.path.join(ROOT, s) for s in settings.get('sources', '').split()]
+    includes = ['-I' + os.path.join(ROOT, d) for d in ('src', 'src/driver', 'src/helper', 'src/app', 'src/radio')]
+    flags = settings.get('flags', '').split()
+
+    result = subprocess.run(['gcc'] + HOST_CFLAGS + flags + includes + [path] + sources + ['-o', binary, '-lm'],
+                            cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        return False, result.stdout
+
+    result = subprocess.run([binary], cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    return result.returncode == 0, result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('names', nargs='*', help='checks to run (default all)')
+    parser.add_argument('-v', '--verbose', action='store_true', help="print each run's output")
+    args = parser.parse_args()
+
+    names = args.names or sorted(os.path.splitext(f)[0] for f in os.listdir(TESTS) if f.endswith('.expected'))
+    builds = {}
+    failed = []
+
+    for name in names:
+        script = os.path.join(TESTS, name + '.txt')
+        program = os.path.join(TESTS, name + '.c')
+        with open(os.path.join(TESTS, name + '.expected')) as f:
+            expected = [line.rstrip('\n') for line in f if line.strip() and not line.startswith('#')]
+
+        if os.path.exists(program):
+            ok, output = run_host(name, program)
+        else:
+            ok, output = run_script(name, script, builds)
+
+        lines = output.splitlines()
+        missing = [e for e in expected if not any(matches(e, line) for line in lines)]
+
+        if args.verbose:
+            sys.stdout.write(output)
+        if ok and not missing:
+            print('PASS  %s' % name)
+            continue
+
+        failed.append(name)
+        print('FAIL  %s' % name)
+        if not ok:
+            print('      exited with an error')
+        for e in missing:
+            print('      expected: %s' % e)
+        if not args.verbose:
+            for line in lines:
+                print('      | %s' % line)
+
+    print('%d of %d checks passed' % (len(names) - len(failed), len(names)))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
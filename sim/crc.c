@@ -0,0 +1,23 @@
+// Software copy of the DP32G030 CRC unit as driver/crc.c configures it:
+// CRC-16/CCITT, polynomial 0x1021, zero initial value, no reflection.
+
+#include "driver/crc.h"
+#include "sim.h"
+
+void CRC_Init(void)
+{
+}
+
+uint16_t CRC_Calculate(const void *pBuffer, uint16_t Size)
+{
+    const uint8_t *pData = (const uint8_t *)pBuffer;
+    uint16_t       Crc   = 0;
+
+    for (uint16_t i = 0; i < Size; i++) {
+        Crc ^= (uint16_t)pData[i] << 8;
+        for (int j = 0; j < 8; j++)
+            Crc = (Crc & 0x8000) ? (uint16_t)((Crc << 1) ^ 0x1021) : (uint16_t)(Crc << 1);
+    }
+
+    return Crc;
+}
@@ -0,0 +1,224 @@
+// I2C bus with a 24C64 EEPROM on it, for the host simulator.
+//
+// Modelled at the level driver/eeprom.c talks to: device address, 16-bit
+// word address, sequential reads, 32-byte page writes that wrap inside the
+// page, and a write cycle during which the chip does not ACK its address.
+// The array is backed by a file so settings survive between runs. Other
+// devices on the bus (BK1080) are absent and never ACK.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "sim.h"
+
+#define EEPROM_SIZE         0x2000u
+#define EEPROM_PAGE_SIZE    32u
+#define EEPROM_ADDRESS      0xA0u
+#define EEPROM_WRITE_US     5000u   // tWR
+#define I2C_BYTE_US         30u     // bit-banged, 3 delays per bit plus ACK
+#define I2C_COND_US         4u
+
+typedef enum {
+    BUS_IDLE,
+    BUS_ADDR_HI,
+    BUS_ADDR_LO,
+    BUS_WRITE,
+    BUS_READ,
+} BusState_t;
+
+SIM_EEPROM_Stats_t gSimEEPROM_Stats;
+
+static uint8_t    gEeprom[EEPROM_SIZE];
+static FILE      *gEepromFile;
+static BusState_t gState;
+static bool       gAddressed;
+static uint16_t   gPointer;
+static uint8_t    gLatch[EEPROM_PAGE_SIZE];
+static uint32_t   gLatchMask;
+static uint64_t   gBusyUntilUs;
+
+// a fresh image gets a battery calibration, otherwise the firmware thinks
+// the battery is flat and boots straight into power save
+static const uint16_t gDefaultBatteryCalibration[6] = {1800, 1870, 1920, 1960, 2060, 2300};
+
+static void SeedImage(void)
+{
+    for (unsigned i = 0; i < 6; i++) {
+        gEeprom[0x1F40 + i * 2 + 0] = gDefaultBatteryCalibration[i] & 0xFF;
+        gEeprom[0x1F40 + i * 2 + 1] = gDefaultBatteryCalibration[i] >> 8;
+    }
+}
+
+bool SIM_EEPROM_Open(const char *pPath)
+{
+    memset(gEeprom, 0xFF, sizeof(gEeprom));
+
+    gEepromFile = fopen(pPath, "r+b");
+    if (gEepromFile == NULL) {
+        gEepromFile = fopen(pPath, "w+b");
+        if (gEepromFile == NULL)
+            return false;
+        SeedImage();
+        fwrite(gEeprom, 1, sizeof(gEeprom), gEepromFile);
+        fflush(gEepromFile);
+        return true;
+    }
+
+    if (fread(gEeprom, 1, sizeof(gEeprom), gEepromFile) != sizeof(gEeprom)) {
+        // short image: pad with erased bytes
+        fseek(gEepromFile, 0, SEEK_SET);
+        fwrite(gEeprom, 1, sizeof(gEeprom), gEepromFile);
+        fflush(gEepromFile);
+    }
+
+    return true;
+}
+
+void SIM_EEPROM_Close(void)
+{
+    if (gEepromFile == NULL)
+        return;
+
+    fclose(gEepromFile);
+    gEepromFile = NULL;
+}
+
+void SIM_EEPROM_Poke(uint16_t Address, const void *pData, unsigned Size)
+{
+    for (unsigned i = 0; i < Size; i++)
+        gEeprom[(Address + i) & (EEPROM_SIZE - 1)] = ((const uint8_t *)pData)[i];
+
+    if (gEepromFile != NULL) {
+        fseek(gEepromFile, 0, SEEK_SET);
+        fwrite(gEeprom, 1, sizeof(gEeprom), gEepromFile);
+        fflush(gEepromFile);
+    }
+}
+
+void SIM_EEPROM_Busy(uint32_t Ms)
+{
+    const uint64_t until = SIM_GetTimeUs() + Ms * 1000ull;
+
+    if (until > gBusyUntilUs)
+        gBusyUntilUs = until;
+}
+
+// end of a write transaction: burn the latched bytes into the array
+static void CommitPage(void)
+{
+    const uint16_t page  = gPointer & ~(EEPROM_PAGE_SIZE - 1);
+    unsigned       count = 0;
+
+    for (unsigned i = 0; i < EEPROM_PAGE_SIZE; i++) {
+        if (!(gLatchMask & (1u << i)))
+            continue;
+        gEeprom[page + i] = gLatch[i];
+        count++;
+    }
+
+    if (gEepromFile != NULL) {
+        fseek(gEepromFile, page, SEEK_SET);
+        fwrite(&gEeprom[page], 1, EEPROM_PAGE_SIZE, gEepromFile);
+        fflush(gEepromFile);
+    }
+
+    gSimEEPROM_Stats.Writes++;
+    gSimEEPROM_Stats.BytesWritten += count;
+    gBusyUntilUs = SIM_GetTimeUs() + EEPROM_WRITE_US;
+    gLatchMask   = 0;
+}
+
+void I2C_Start(void)
+{
+    SIM_AdvanceUs(I2C_COND_US);
+    gState     = BUS_IDLE;
+    gAddressed = false;
+    gLatchMask = 0;
+}
+
+void I2C_Stop(void)
+{
+    SIM_AdvanceUs(I2C_COND_US);
+    if (gState == BUS_WRITE && gLatchMask)
+        CommitPage();
+    gState     = BUS_IDLE;
+    gAddressed = false;
+}
+
+int I2C_Write(uint8_t Data)
+{
+    SIM_AdvanceUs(I2C_BYTE_US);
+
+    if (!gAddressed) {
+        if ((Data & 0xFE) != EEPROM_ADDRESS || SIM_GetTimeUs() < gBusyUntilUs)
+            return -1;
+        gAddressed = true;
+        if (Data & 1) {
+            gState = BUS_READ;
+            gSimEEPROM_Stats.Reads++;
+        } else {
+            gState = BUS_ADDR_HI;
+        }
+        return 0;
+    }
+
+    switch (gState) {
+        case BUS_ADDR_HI:
+            gPointer = (uint16_t)((Data << 8) & (EEPROM_SIZE - 1));
+            gState   = BUS_ADDR_LO;
+            break;
+        case BUS_ADDR_LO:
+            gPointer |= Data;
+            gState    = BUS_WRITE;
+            break;
+        case BUS_WRITE: {
+            const unsigned offset = gPointer & (EEPROM_PAGE_SIZE - 1);
+            gLatch[offset] = Data;
+            gLatchMask    |= 1u << offset;
+            gPointer = (uint16_t)((gPointer & ~(EEPROM_PAGE_SIZE - 1)) | ((offset + 1) & (EEPROM_PAGE_SIZE - 1)));
+            break;
+        }
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+uint8_t I2C_Read(bool bFinal)
+{
+    uint8_t Data = 0xFF;
+
+    (void)bFinal;
+    SIM_AdvanceUs(I2C_BYTE_US);
+
+    if (gState == BUS_READ) {
+        Data     = gEeprom[gPointer];
+        gPointer = (gPointer + 1) & (EEPROM_SIZE - 1);
+        gSimEEPROM_Stats.BytesRead++;
+    }
+
+    return Data;
+}
+
+int I2C_ReadBuffer(void *pBuffer, uint8_t Size)
+{
+    uint8_t *pData = (uint8_t *)pBuffer;
+
+    for (uint8_t i = 0; i < Size; i++)
+        pData[i] = I2C_Read(i + 1 == Size);
+
+    return Size;
+}
+
+int I2C_WriteBuffer(const void *pBuffer, uint8_t Size)
+{
+    const uint8_t *pData = (const uint8_t *)pBuffer;
+
+    for (uint8_t i = 0; i < Size; i++)
+        if (I2C_Write(pData[i]) < 0)
+            return -1;
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+// Host stand-in for the CMSIS Cortex-M0 device header. Only the pieces the
+// firmware actually touches are provided; SysTick is backed by the simulator
+// clock in sim/systick.c.
+
+#ifndef SIM_ARMCM0_H
+#define SIM_ARMCM0_H
+
+#include <stdint.h>
+
+typedef int IRQn_Type;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+extern SysTick_Type SIM_SysTick;
+
+#define SysTick (&SIM_SysTick)
+
+#define SysTick_LOAD_RELOAD_Msk (0xFFFFFFUL)
+
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __NOP(void) {}
+static inline void __WFI(void) {}
+
+static inline void NVIC_EnableIRQ(IRQn_Type IRQn) { (void)IRQn; }
+static inline void NVIC_DisableIRQ(IRQn_Type IRQn) { (void)IRQn; }
+
+void NVIC_SystemReset(void) __attribute__((noreturn));
+
+#endif
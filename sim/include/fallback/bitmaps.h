@@ -0,0 +1,12 @@
+// Stand-in for the firmware's bitmaps.h, which the source snapshot does
+// not carry. Searched after every firmware include directory, so the real
+// header wins once it is there.
+
+#ifndef SIM_BITMAPS_H
+#define SIM_BITMAPS_H
+
+#include <stdint.h>
+
+static const uint8_t BITMAP_Antenna[5] = { 0x03, 0x05, 0x7f, 0x05, 0x03 };
+
+#endif
@@ -0,0 +1,3 @@
+// Stand-in for the firmware's ui helper.h, which the source snapshot does
+// not carry and nothing in menu.c still uses. Searched after every
+// firmware include directory, so the real header wins once it is there.
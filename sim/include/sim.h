@@ -0,0 +1,111 @@
+// Host simulator interface (make sim).
+//
+// The simulator builds src/app, src/radio and src/ui for the host and swaps
+// the DP32G030 drivers for the stand-ins in sim/. Time is virtual: it only
+// moves when the firmware delays, talks to a peripheral model or goes idle
+// at the bottom of the main loop, so runs are deterministic and usually far
+// faster than real time.
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// virtual clock
+uint64_t SIM_GetTimeUs(void);
+void     SIM_AdvanceUs(uint32_t Us);
+void     SIM_Idle(void);
+
+typedef struct {
+    uint64_t MaxPassUs;     // longest main loop pass, idle to idle
+} SIM_Loop_Stats_t;
+
+extern SIM_Loop_Stats_t gSimLoop_Stats;
+
+// BK4819 register model
+typedef struct {
+    uint32_t BusReads;
+    uint32_t BusWrites;
+    uint32_t Retunes;
+    uint32_t FskWords;      // FSK RX words that came over the air
+    uint32_t FskOverruns;   // of those, lost to a full RX FIFO
+    uint64_t FskMaxAgeUs;   // longest a word sat in the FIFO before REG_5F
+    uint32_t KeyUps;        // REG_30 PA gain switched on
+    uint64_t TxUs;          // time with the PA on
+} SIM_BK4819_Stats_t;
+
+extern SIM_BK4819_Stats_t gSimBK4819_Stats;
+
+void     SIM_BK4819_AddSignal(uint32_t Frequency, int16_t dBm, uint32_t FromMs, uint32_t ToMs);
+void     SIM_BK4819_RaiseInterrupt(uint16_t Flags);
+void     SIM_BK4819_ReceiveFSK(const void *pData, unsigned Size);
+uint32_t SIM_BK4819_GetFrequency(void);
+
+// ST7565 model
+typedef struct {
+    uint32_t Commands;
+    uint32_t DataBytes;
+    uint32_t Transfers;
+    uint64_t BlockedUs;     // main loop time spent waiting on the SPI
+} SIM_LCD_Stats_t;
+
+extern SIM_LCD_Stats_t gSimLCD_Stats;
+
+bool     SIM_LCD_Dump(const char *pPath);
+
+// 24C64 EEPROM on the I2C bus, backed by a file
+typedef struct {
+    uint32_t Reads;
+    uint32_t Writes;
+    uint32_t BytesRead;
+    uint32_t BytesWritten;
+} SIM_EEPROM_Stats_t;
+
+extern SIM_EEPROM_Stats_t gSimEEPROM_Stats;
+
+bool     SIM_EEPROM_Open(const char *pPath);
+void     SIM_EEPROM_Close(void);
+// straight into the array, as a programmer would before boot
+void     SIM_EEPROM_Poke(uint16_t Address, const void *pData, unsigned Size);
+// the chip ignores its address for that long, as in a write cycle
+void     SIM_EEPROM_Busy(uint32_t Ms);
+
+// UART
+typedef struct {
+    uint32_t TxBytes;
+    uint64_t BlockedUs;     // main loop time spent waiting on the transmitter
+} SIM_UART_Stats_t;
+
+extern SIM_UART_Stats_t gSimUART_Stats;
+
+void     SIM_UART_Open(const char *pPath);
+void     SIM_UART_Inject(const void *pData, uint32_t Size);
+
+// keyboard
+void     SIM_KEY_Set(int Key);
+
+// a second messenger station at the far end of a noisy FSK channel
+typedef struct {
+    uint32_t Frames;        // FSK packets the firmware sent
+    uint32_t Hit;           // of those, with at least one bit flipped
+    uint32_t Corrected;     // put right by the FEC
+    uint32_t Damaged;       // rejected: bad CRC or text not as sent
+    uint32_t Undetected;    // taken although damaged
+    uint32_t Delivered;     // distinct messages taken
+    uint32_t Replies;       // ACKs and NACKs sent back
+} SIM_Peer_Stats_t;
+
+extern SIM_Peer_Stats_t gSimPeer_Stats;
+
+void     SIM_Peer_Start(uint32_t BerPpm, uint32_t Seed);
+void     SIM_Peer_Transmitted(const uint8_t *pData, unsigned Size);
+void     SIM_Peer_Run(uint64_t NowUs);
+
+// host-timed benchmarks of firmware functions, results on stderr
+void     SIM_Bench_Run(const char *pName);
+
+// scripted events, run by the clock as virtual time passes
+void     SIM_Script_Run(uint64_t NowUs);
+
+#endif
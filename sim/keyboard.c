@@ -0,0 +1,35 @@
+// Scripted keypad for the host simulator.
+//
+// The key held down is set from the event script; PTT is mirrored onto
+// GPIOC so the code that reads the PTT pin directly sees it too.
+
+#include "dp32g030/gpio.h"
+#include "driver/gpio.h"
+#include "driver/keyboard.h"
+#include "sim.h"
+
+#define KEY_SCAN_US     40u     // four rows, each with a short settle delay
+
+KEY_Code_t gKeyReading0     = KEY_INVALID;
+KEY_Code_t gKeyReading1     = KEY_INVALID;
+uint16_t   gDebounceCounter = 0;
+bool       gWasFKeyPressed  = false;
+
+static KEY_Code_t gSimKey = KEY_INVALID;
+
+void SIM_KEY_Set(int Key)
+{
+    gSimKey = (Key >= 0 && Key < KEY_INVALID) ? (KEY_Code_t)Key : KEY_INVALID;
+
+    if (gSimKey == KEY_PTT)
+        GPIO_ClearBit(&GPIOC->DATA, GPIOC_PIN_PTT);
+    else
+        GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_PTT);
+}
+
+KEY_Code_t KEYBOARD_Poll(void)
+{
+    SIM_AdvanceUs(KEY_SCAN_US);
+
+    return (gSimKey == KEY_PTT) ? KEY_INVALID : gSimKey;
+}
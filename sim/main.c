@@ -0,0 +1,392 @@
+// Host simulator entry point.
+//
+//   _build_sim/uv-kx_sim [-e eeprom.bin] [-s script] [-t seconds] [-l lcd.pbm] [-u uart.out]
+//
+// Maps the DP32G030 peripheral window so the firmware's register accesses
+// land in ordinary memory, loads the event script and calls Main(). The run
+// ends after the requested amount of virtual time (or a "quit" event) and a
+// short report of virtual time, bus traffic and host CPU time is printed.
+//
+// Script lines are "<ms> <event> [args]", in time order, '#' for comments:
+//
+//   0     signal 145.500 -80 2000    carrier at 145.5 MHz, -80 dBm, for 2 s
+//   100   key menu                   hold a key (0-9 menu up down exit star
+//   200   key none                   f ptt side1 side2), "none" releases it
+//   300   uart SMS:hello\r\n         bytes into the UART RX ring (C escapes)
+//   400   fsk MShello                FSK packet received over the air
+//   450   irq 0x0c00                 raise BK4819 interrupt flags (REG_02 bits)
+//   480   peer 1000 7                answer FSK packets as a second station,
+//                                    1000 bit errors per million, seed 7
+//   500   dump shot.pbm              write the LCD contents, "dump -" prints
+//                                    them to stderr
+//   900   quit
+//   0     eeprom 0e7b 00             bytes (hex) written into the image
+//                                    before boot, whatever the time
+//   600   eeprom_busy 100            the EEPROM NACKs its address for 100 ms
+//   700   bench channels             run a host benchmark (sim/bench.c)
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "app/messenger.h"
+#ifdef ENABLE_SPECTRUM
+#include "app/spectrum.h"
+#endif
+#include "dp32g030/gpio.h"
+#include "driver/bk4819.h"
+#include "driver/eeprom.h"
+#include "driver/gpio.h"
+#include "driver/keyboard.h"
+#include "driver/uart.h"
+#include "sim.h"
+
+#define PERIPH_BASE     0x40000000UL
+#define PERIPH_SIZE     0x000C0000UL
+
+#define MAX_EVENTS      1024
+#define MAX_ARG         256
+#define MAX_POKES       64
+
+typedef enum {
+    EVENT_KEY,
+    EVENT_UART,
+    EVENT_DUMP,
+    EVENT_FSK,
+    EVENT_IRQ,
+    EVENT_PEER,
+    EVENT_EEPROM_BUSY,
+    EVENT_BENCH,
+    EVENT_QUIT,
+} EventType_t;
+
+typedef struct {
+    uint32_t    TimeMs;
+    EventType_t Type;
+    int         Key;
+    uint16_t    Flags;
+    uint32_t    Value[2];
+    uint16_t    Length;
+    char        Arg[MAX_ARG];
+} Event_t;
+
+void Main(void);
+
+typedef struct {
+    uint16_t    Address;
+    uint16_t    Length;
+    uint8_t     Data[MAX_ARG];
+} Poke_t;
+
+static Poke_t    gPokes[MAX_POKES];
+static unsigned  gPokeCount;
+static Event_t  *gEvents;
+static unsigned  gEventCount;
+static unsigned  gEventNext;
+static uint64_t  gEndUs = 10ULL * 1000000ULL;
+static const char *gLcdPath;
+static clock_t   gCpuStart;
+
+static const char *const gKeyNames[] = {
+    "0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+    "menu", "up", "down", "exit", "star", "f", "ptt", "side2", "side1",
+};
+
+static int ParseKey(const char *pName)
+{
+    for (unsigned i = 0; i < sizeof(gKeyNames) / sizeof(gKeyNames[0]); i++)
+        if (strcasecmp(pName, gKeyNames[i]) == 0)
+            return (int)i;
+    return KEY_INVALID;
+}
+
+static uint16_t Unescape(char *pOut, const char *pIn)
+{
+    uint16_t n = 0;
+
+    while (*pIn && n < MAX_ARG) {
+        char c = *pIn++;
+        if (c == '\\' && *pIn) {
+            c = *pIn++;
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case '0': c = '\0'; break;
+                case 'x': {
+                    unsigned v = 0;
+                    for (int i = 0; i < 2 && isxdigit((unsigned char)*pIn); i++, pIn++)
+                        v = v * 16 + (isdigit((unsigned char)*pIn) ? *pIn - '0' : (tolower((unsigned char)*pIn) - 'a' + 10));
+                    c = (char)v;
+                    break;
+                }
+                default: break;
+            }
+        }
+        pOut[n++] = c;
+    }
+
+    return n;
+}
+
+static bool LoadScript(const char *pPath)
+{
+    char  line[1152];
+    FILE *f = fopen(pPath, "r");
+
+    if (f == NULL)
+        return false;
+
+    gEvents = calloc(MAX_EVENTS, sizeof(Event_t));
+
+    for (unsigned lineno = 1; fgets(line, sizeof(line), f); lineno++) {
+        char     verb[16];
+        char     rest[1040] = "";     // a full 256 byte UART frame in \x escapes
+        unsigned ms;
+
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '#' || sscanf(line, "%u %15s %1039[^\n]", &ms, verb, rest) < 2)
+            continue;
+
+        if (strcmp(verb, "signal") == 0) {
+            double   mhz;
+            int      dbm;
+            unsigned duration = 0;
+            if (sscanf(rest, "%lf %d %u", &mhz, &dbm, &duration) < 2) {
+                fprintf(stderr, "%s:%u: signal <MHz> <dBm> [ms]\n", pPath, lineno);
+                continue;
+            }
+            SIM_BK4819_AddSignal((uint32_t)(mhz * 100000.0 + 0.5), (int16_t)dbm, ms, duration ? ms + duration : 0);
+            continue;
+        }
+
+        if (strcmp(verb, "eeprom") == 0) {
+            Poke_t  *p = &gPokes[gPokeCount];
+            unsigned address;
+            int      used;
+            unsigned byte;
+            char    *pHex = rest;
+
+            if (gPokeCount >= MAX_POKES || sscanf(pHex, "%x%n", &address, &used) < 1) {
+                fprintf(stderr, "%s:%u: eeprom <address> <hex bytes>\n", pPath, lineno);
+                continue;
+            }
+            p->Address = (uint16_t)address;
+            p->Length  = 0;
+            for (pHex += used; p->Length < MAX_ARG && sscanf(pHex, "%2x%n", &byte, &used) == 1; pHex += used)
+                p->Data[p->Length++] = (uint8_t)byte;
+            gPokeCount++;
+            continue;
+        }
+
+        if (gEventCount >= MAX_EVENTS)
+            break;
+
+        Event_t *e = &gEvents[gEventCount];
+        e->TimeMs = ms;
+
+        if (strcmp(verb, "key") == 0) {
+            e->Type = EVENT_KEY;
+            e->Key  = ParseKey(rest);
+        } else if (strcmp(verb, "uart") == 0) {
+            e->Type   = EVENT_UART;
+            e->Length = Unescape(e->Arg, rest);
+        } else if (strcmp(verb, "dump") == 0) {
+            e->Type = EVENT_DUMP;
+            snprintf(e->Arg, sizeof(e->Arg), "%.255s", rest);
+        } else if (strcmp(verb, "fsk") == 0) {
+            e->Type   = EVENT_FSK;
+            e->Length = Unescape(e->Arg, rest);
+        } else if (strcmp(verb, "irq") == 0) {
+            e->Type = EVENT_IRQ;
+            e->Flags = (uint16_t)strtoul(rest, NULL, 0);
+        } else if (strcmp(verb, "peer") == 0) {
+            e->Type = EVENT_PEER;
+            if (sscanf(rest, "%u %u", &e->Value[0], &e->Value[1]) < 1) {
+                fprintf(stderr, "%s:%u: peer <ber_ppm> [seed]\n", pPath, lineno);
+                continue;
+            }
+        } else if (strcmp(verb, "eeprom_busy") == 0) {
+            e->Type     = EVENT_EEPROM_BUSY;
+            e->Value[0] = (uint32_t)strtoul(rest, NULL, 0);
+        } else if (strcmp(verb, "bench") == 0) {
+            e->Type = EVENT_BENCH;
+            snprintf(e->Arg, sizeof(e->Arg), "%.255s", rest);
+        } else if (strcmp(verb, "quit") == 0) {
+            e->Type = EVENT_QUIT;
+        } else {
+            fprintf(stderr, "%s:%u: unknown event '%s'\n", pPath, lineno, verb);
+            continue;
+        }
+
+        gEventCount++;
+    }
+
+    fclose(f);
+    return true;
+}
+
+static void Report(void)
+{
+    const double cpu = (double)(clock() - gCpuStart) / CLOCKS_PER_SEC;
+    const double vt  = SIM_GetTimeUs() / 1e6;
+
+    if (gLcdPath)
+        SIM_LCD_Dump(gLcdPath);
+
+    fprintf(stderr, "virtual time   %10.3f s   (host cpu %.3f s)\n", vt, cpu);
+    fprintf(stderr, "main loop      %10.1f ms longest pass\n", gSimLoop_Stats.MaxPassUs / 1e3);
+    fprintf(stderr, "bk4819 bus     %10u reads  %10u writes  %u retunes, tuned to %.5f MHz\n",
+            gSimBK4819_Stats.BusReads, gSimBK4819_Stats.BusWrites, gSimBK4819_Stats.Retunes,
+            SIM_BK4819_GetFrequency() / 100000.0);
+    if (gSimBK4819_Stats.FskWords)
+        fprintf(stderr, "bk4819 fsk     %10u words  %10u overruns  oldest word %.1f ms\n",
+                gSimBK4819_Stats.FskWords, gSimBK4819_Stats.FskOverruns,
+                gSimBK4819_Stats.FskMaxAgeUs / 1e3);
+    if (gSimBK4819_Stats.KeyUps)
+        fprintf(stderr, "bk4819 tx      %10u key ups %9.3f s on air\n",
+                gSimBK4819_Stats.KeyUps, gSimBK4819_Stats.TxUs / 1e6);
+#ifdef ENABLE_BK4819_BUS_STATS
+    fprintf(stderr, "bk4819 shadow  %10u hits   %10u writes skipped\n",
+            gBK4819_BusStats.ReadHits, gBK4819_BusStats.WritesSkipped);
+#endif
+#if defined(ENABLE_SPECTRUM) && defined(ENABLE_SPECTRUM_STATS)
+    if (gSpectrumStats.Sweeps)
+        fprintf(stderr, "spectrum       %10u sweeps %10u steps\n",
+                gSpectrumStats.Sweeps, gSpectrumStats.Steps);
+#endif
+    fprintf(stderr, "lcd            %10u data   %10u cmds  %u transfers, %.3f s blocked\n",
+            gSimLCD_Stats.DataBytes, gSimLCD_Stats.Commands, gSimLCD_Stats.Transfers,
+            gSimLCD_Stats.BlockedUs / 1e6);
+    fprintf(stderr, "uart tx        %10u bytes  %.3f s blocked\n",
+            gSimUART_Stats.TxBytes, gSimUART_Stats.BlockedUs / 1e6);
+#ifdef ENABLE_UART_TX_QUEUE
+    fprintf(stderr, "uart tx queue  %10u queued %10u dropped  %u waits, peak %u bytes\n",
+            gUART_TxStats.Queued, gUART_TxStats.Dropped, gUART_TxStats.Waits, gUART_TxStats.Peak);
+#endif
+    if (gSimPeer_Stats.Frames)
+        fprintf(stderr, "fsk peer       %10u frames %10u delivered  %u hit, %u corrected, %u damaged, %u undetected, %u replies\n",
+                gSimPeer_Stats.Frames, gSimPeer_Stats.Delivered, gSimPeer_Stats.Hit, gSimPeer_Stats.Corrected,
+                gSimPeer_Stats.Damaged, gSimPeer_Stats.Undetected, gSimPeer_Stats.Replies);
+#ifdef ENABLE_MESSENGER_FEC
+    fprintf(stderr, "messenger fec  %10u clean  %10u corrected  (%u bytes), %u failed\n",
+            gMsgFecStats.Clean, gMsgFecStats.Corrected, gMsgFecStats.Bytes, gMsgFecStats.Failed);
+#endif
+#ifdef ENABLE_MESSENGER_LINK
+    fprintf(stderr, "messenger link %10u sent   %10u delivered  %u retries, %u failed; rx %u, %u repeats, %u bad\n",
+            gMsgLinkStats.Sent, gMsgLinkStats.Delivered, gMsgLinkStats.Retries, gMsgLinkStats.Failed,
+            gMsgLinkStats.Received, gMsgLinkStats.Duplicates, gMsgLinkStats.BadFrames);
+#endif
+#ifdef ENABLE_MESSENGER_LONG
+    fprintf(stderr, "messenger long %10u incomplete\n", gMsgLinkStats.Incomplete);
+#endif
+    fprintf(stderr, "eeprom         %10u reads  %10u writes  (%u / %u bytes)\n",
+            gSimEEPROM_Stats.Reads, gSimEEPROM_Stats.Writes,
+            gSimEEPROM_Stats.BytesRead, gSimEEPROM_Stats.BytesWritten);
+#ifdef ENABLE_EEPROM_WRITE_CACHE
+    fprintf(stderr, "eeprom cache   %10u pages lost\n", gEepromLostPages);
+#endif
+
+    SIM_EEPROM_Close();
+}
+
+void SIM_Script_Run(uint64_t NowUs)
+{
+    if (NowUs >= gEndUs)
+        exit(0);
+
+    while (gEventNext < gEventCount && (uint64_t)gEvents[gEventNext].TimeMs * 1000 <= NowUs) {
+        const Event_t *e = &gEvents[gEventNext++];
+
+        switch (e->Type) {
+            case EVENT_KEY:
+                SIM_KEY_Set(e->Key);
+                break;
+            case EVENT_UART:
+                SIM_UART_Inject(e->Arg, e->Length);
+                break;
+            case EVENT_DUMP:
+                SIM_LCD_Dump(e->Arg);
+                break;
+            case EVENT_FSK:
+                SIM_BK4819_ReceiveFSK(e->Arg, e->Length);
+                break;
+            case EVENT_IRQ:
+                SIM_BK4819_RaiseInterrupt(e->Flags);
+                break;
+            case EVENT_PEER:
+                SIM_Peer_Start(e->Value[0], e->Value[1]);
+                break;
+            case EVENT_EEPROM_BUSY:
+                SIM_EEPROM_Busy(e->Value[0]);
+                break;
+            case EVENT_BENCH:
+                SIM_Bench_Run(e->Arg);
+                break;
+            case EVENT_QUIT:
+                exit(0);
+        }
+    }
+
+    SIM_Peer_Run(NowUs);
+}
+
+static void Usage(const char *pName)
+{
+    fprintf(stderr, "usage: %s [-e eeprom.bin] [-s script] [-t seconds] [-l lcd.pbm] [-u uart.out]\n", pName);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *eeprom = "eeprom.bin";
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0 || i + 1 >= argc)
+            Usage(argv[0]);
+
+        const char *value = argv[++i];
+        switch (argv[i - 1][1]) {
+            case 'e': eeprom = value; break;
+            case 'l': gLcdPath = value; break;
+            case 't': gEndUs = (uint64_t)(atof(value) * 1e6); break;
+            case 'u': SIM_UART_Open(value); break;
+            case 's':
+                if (!LoadScript(value)) {
+                    perror(value);
+                    return 1;
+                }
+                break;
+            default:
+                Usage(argv[0]);
+        }
+    }
+
+    void *periph = mmap((void *)PERIPH_BASE, PERIPH_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (periph != (void *)PERIPH_BASE) {
+        fprintf(stderr, "cannot map the peripheral window at 0x%08lx\n", PERIPH_BASE);
+        return 1;
+    }
+
+    if (!SIM_EEPROM_Open(eeprom)) {
+        perror(eeprom);
+        return 1;
+    }
+    for (unsigned i = 0; i < gPokeCount; i++)
+        SIM_EEPROM_Poke(gPokes[i].Address, gPokes[i].Data, gPokes[i].Length);
+
+    // idle levels: PTT released
+    GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_PTT);
+
+    gCpuStart = clock();
+    atexit(Report);
+
+    Main();
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+// Remote messenger station for the host simulator.
+//
+// Started by a "peer <ber_ppm> [seed]" script event. Every FSK packet the
+// firmware sends is taken off the air with bit errors at the given rate and
+// judged: link frames (ENABLE_MESSENGER_LINK) by their CRC, older 'MS'
+// frames by comparing the text with what was sent. With ENABLE_MESSENGER_FEC
+// the parity is used to put the packet right first. The peer answers link
+// frames the way a second radio would, an ACK of its sequence window for a
+// good DATA frame or a NACK for a damaged one, over the same noisy channel
+// and as long after the packet as the firmware would. A long message
+// (ENABLE_MESSENGER_LONG) counts as delivered once all its fragments are in.
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ENABLE_MESSENGER_FEC
+    #include "helper/fec.h"
+#endif
+#ifdef ENABLE_MESSENGER_LINK
+    #include "helper/msglink.h"
+#endif
+#include "sim.h"
+
+#define PEER_STATION        0x7E57
+#define PEER_TURNAROUND_US  600000u // the firmware's reply delay and key up
+#define PEER_REPLY_SLOT_US  50000u  // and its random reply slot
+#define PEER_REPLY_SLOTS    6
+#define PEER_FRAME_SIZE     52
+#define PEER_PACKET_SIZE    128
+#define PEER_TEXT_SIZE      32      // 'MS' and the text
+
+SIM_Peer_Stats_t gSimPeer_Stats;
+
+static bool     gPeerOn;
+static uint32_t gPeerBerPpm;
+static uint64_t gPeerRandom;
+
+static uint8_t  gPeerReply[PEER_PACKET_SIZE];
+static unsigned gPeerReplySize;
+static uint64_t gPeerReplyUs;           // 0 while nothing is to be sent
+
+// texts (or link sequence numbers) taken, to count each message once
+static char     gPeerTexts[256][PEER_TEXT_SIZE];
+static unsigned gPeerTextCount;
+
+static uint32_t Random(void)
+{
+    gPeerRandom ^= gPeerRandom << 13;
+    gPeerRandom ^= gPeerRandom >> 7;
+    gPeerRandom ^= gPeerRandom << 17;
+    return (uint32_t)(gPeerRandom >> 32);
+}
+
+static unsigned Corrupt(uint8_t *pData, unsigned Size)
+{
+    unsigned flips = 0;
+
+    for (unsigned i = 0; i < Size * 8; i++) {
+        if (Random() % 1000000u < gPeerBerPpm) {
+            pData[i / 8] ^= 1u << (i % 8);
+            flips++;
+        }
+    }
+    return flips;
+}
+
+static bool Take(const char *pText)
+{
+    for (unsigned i = 0; i < gPeerTextCount; i++)
+        if (strncmp(gPeerTexts[i], pText, PEER_TEXT_SIZE) == 0)
+            return false;
+
+    if (gPeerTextCount < 256)
+        strncpy(gPeerTexts[gPeerTextCount++], pText, PEER_TEXT_SIZE);
+    return true;
+}
+
+#ifdef ENABLE_MESSENGER_LINK
+static uint8_t gPeerTop;
+static uint8_t gPeerSeen;
+static bool    gPeerStarted;
+static uint8_t gPeerHave[256];          // fragments taken, by first sequence number
+static bool    gPeerWhole[256];
+
+static void Reply(uint8_t Type, uint16_t Dst, uint8_t Seq, uint8_t Seen)
+{
+    const MSGLINK_Frame_t frame = {
+        .Type     = Type,
+        .Seq      = Seq,
+        .Src      = PEER_STATION,
+        .Dst      = Dst,
+        .Length   = (Type == MSGLINK_ACK) ? 1 : 0,
+        .pPayload = &Seen,
+    };
+
+    MSGLINK_Build(gPeerReply, &frame);
+    gPeerReplySize = PEER_FRAME_SIZE;
+#ifdef ENABLE_MESSENGER_FEC
+    FEC_Encode(gPeerReply, PEER_FRAME_SIZE, gPeerReply + PEER_FRAME_SIZE);
+    gPeerReplySize += FEC_PARITY_SIZE;
+#endif
+    gPeerReplyUs = SIM_GetTimeUs() + PEER_TURNAROUND_US + PEER_REPLY_SLOT_US * (Random() % PEER_REPLY_SLOTS);
+}
+
+// the same window as the firmware keeps per station
+static void Window(uint8_t Seq)
+{
+    const int8_t ahead = (int8_t)(Seq - gPeerTop);
+
+    if (!gPeerStarted || ahead > 8 || ahead < -8) {
+        gPeerStarted = true;
+        gPeerTop     = Seq;
+        gPeerSeen    = 0;
+    } else if (ahead > 0) {
+        gPeerSeen = (uint8_t)(((gPeerSeen << 1) | 1u) << (ahead - 1));
+        gPeerTop  = Seq;
+    } else if (ahead < 0) {
+        gPeerSeen |= 1u << (-ahead - 1);
+    }
+}
+
+static bool Judge(const uint8_t *pSent, const uint8_t *pFrame, unsigned Size)
+{
+    MSGLINK_Frame_t frame;
+    char            text[PEER_TEXT_SIZE] = "";
+
+    switch (MSGLINK_Parse(pFrame, Size, &frame)) {
+        case MSGLINK_OK:
+            if (frame.Type != MSGLINK_DATA && frame.Type != MSGLINK_FRAGMENT)
+                return true;
+            if (memcmp(pFrame, pSent, MSGLINK_HEADER_SIZE + frame.Length + 2) != 0)
+                gSimPeer_Stats.Undetected++;
+            if (frame.Type == MSGLINK_FRAGMENT && frame.Length > 0) {
+                const uint8_t index = frame.pPayload[0] >> 4;
+                const uint8_t count = (frame.pPayload[0] & 15) + 1;
+                const uint8_t first = frame.Seq - index;
+
+                gPeerHave[first] |= 1u << index;
+                if (gPeerHave[first] == (1u << count) - 1 && !gPeerWhole[first]) {
+                    gPeerWhole[first] = true;
+                    gSimPeer_Stats.Delivered++;
+                }
+            } else {
+                snprintf(text, sizeof(text), "%04x:%02x", frame.Src, frame.Seq);
+                if (Take(text))
+                    gSimPeer_Stats.Delivered++;
+            }
+            Window(frame.Seq);
+            Reply(MSGLINK_ACK, frame.Src, gPeerTop, gPeerSeen);
+            return true;
+
+        case MSGLINK_BAD_CRC:
+            gSimPeer_Stats.Damaged++;
+            if (frame.Type == MSGLINK_DATA ||
+                (frame.Type == MSGLINK_FRAGMENT && !(gPeerReplyUs && gPeerReply[2] == MSGLINK_ACK)))
+                Reply(MSGLINK_NACK, frame.Src, frame.Seq, 0);
+            return true;
+
+        default:
+            return false;
+    }
+}
+#endif
+
+void SIM_Peer_Start(uint32_t BerPpm, uint32_t Seed)
+{
+    gPeerOn     = true;
+    gPeerBerPpm = BerPpm;
+    gPeerRandom = 0x9E3779B97F4A7C15ull ^ Seed;
+}
+
+void SIM_Peer_Transmitted(const uint8_t *pData, unsigned Size)
+{
+    uint8_t frame[PEER_PACKET_SIZE] = {0};
+
+    if (!gPeerOn)
+        return;
+
+    if (Size > sizeof(frame))
+        Size = sizeof(frame);
+    memcpy(frame, pData, Size);
+
+    gSimPeer_Stats.Frames++;
+    if (Corrupt(frame, Size))
+        gSimPeer_Stats.Hit++;
+
+#ifdef ENABLE_MESSENGER_FEC
+    {
+        FEC_Decoder_t decoder;
+
+        FEC_DecodeStart(&decoder);
+        for (unsigned i = 0; i < Size; i++)
+            FEC_DecodeByte(&decoder, frame[i]);
+        if (FEC_DecodeEnd(&decoder, frame, PEER_FRAME_SIZE) > 0)
+            gSimPeer_Stats.Corrected++;
+    }
+#endif
+    if (Size > PEER_FRAME_SIZE)
+        Size = PEER_FRAME_SIZE;
+
+#ifdef ENABLE_MESSENGER_LINK
+    if (Judge(pData, frame, Size))
+        return;
+#endif
+
+    // older format: the text has to arrive as sent, and it isn't a receipt
+    if (Size < PEER_TEXT_SIZE || pData[0] != 'M' || pData[1] != 'S' || pData[2] == 0x1b)
+        return;
+    if (memcmp(frame, pData, PEER_TEXT_SIZE) != 0) {
+        gSimPeer_Stats.Damaged++;
+        return;
+    }
+    if (Take((const char *)frame + 2))
+        gSimPeer_Stats.Delivered++;
+}
+
+void SIM_Peer_Run(uint64_t NowUs)
+{
+    uint8_t frame[PEER_PACKET_SIZE];
+
+    if (gPeerReplyUs == 0 || NowUs < gPeerReplyUs)
+        return;
+
+    gPeerReplyUs = 0;
+    memcpy(frame, gPeerReply, gPeerReplySize);
+    Corrupt(frame, gPeerReplySize);
+    gSimPeer_Stats.Replies++;
+    SIM_BK4819_ReceiveFSK(frame, gPeerReplySize);
+}
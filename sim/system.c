@@ -0,0 +1,22 @@
+// SYSTEM_* stand-ins for the host simulator.
+
+#include <stdlib.h>
+
+#include "ARMCM0.h"
+#include "driver/system.h"
+#include "sim.h"
+
+void SYSTEM_DelayMs(uint32_t Delay)
+{
+    SIM_AdvanceUs(Delay * 1000);
+}
+
+void SYSTEM_ConfigureClocks(void)
+{
+}
+
+void NVIC_SystemReset(void)
+{
+    SIM_EEPROM_Close();
+    exit(0);
+}
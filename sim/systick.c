@@ -0,0 +1,85 @@
+// Virtual clock for the host simulator.
+//
+// SYSTICK_DelayUs() and friends advance virtual time instead of spinning.
+// Every 10 ms of virtual time SystickHandler() is called, just like the
+// SysTick interrupt on the radio, and SysTick->VAL counts down in 48 MHz
+// ticks so code that timestamps with it sees sensible values.
+
+#include "ARMCM0.h"
+#include "driver/systick.h"
+#include "misc.h"
+#include "sim.h"
+
+#define SIM_TICK_US     10000u
+#define SIM_TICK_LOAD   480000u
+
+SysTick_Type SIM_SysTick;
+SIM_Loop_Stats_t gSimLoop_Stats;
+
+void SystickHandler(void);
+
+static uint64_t gSimTimeUs;
+static uint64_t gSimNextTickUs = SIM_TICK_US;
+static bool     gSimInTick;
+static uint64_t gSimPassStartUs;
+
+uint64_t SIM_GetTimeUs(void)
+{
+    return gSimTimeUs;
+}
+
+void SIM_AdvanceUs(uint32_t Us)
+{
+    const uint64_t target = gSimTimeUs + Us;
+
+    // SystickHandler() never delays, but scripted events may poke models
+    // that do; don't let them recurse into another tick
+    if (gSimInTick) {
+        gSimTimeUs = target;
+        return;
+    }
+
+    gSimInTick = true;
+    while (gSimNextTickUs <= target) {
+        gSimTimeUs = gSimNextTickUs;
+        gSimNextTickUs += SIM_TICK_US;
+        SIM_Script_Run(gSimTimeUs);
+        SystickHandler();
+    }
+    gSimTimeUs = target;
+    gSimInTick = false;
+
+    SIM_SysTick.VAL = SIM_TICK_LOAD - 1 - (uint32_t)((gSimTimeUs % SIM_TICK_US) * (SIM_TICK_LOAD / SIM_TICK_US));
+}
+
+// bottom of the main loop: nothing left to do until the next 10 ms slice
+void SIM_Idle(void)
+{
+    // the first pass is the boot, not counted
+    if (gSimPassStartUs != 0 && gSimTimeUs - gSimPassStartUs > gSimLoop_Stats.MaxPassUs)
+        gSimLoop_Stats.MaxPassUs = gSimTimeUs - gSimPassStartUs;
+
+    // a tick that landed while the loop was busy is serviced straight away
+    if (!gNextTimeslice) {
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+        // the radio spins here; APP_Update() polls the BK4819 once per ms
+        SIM_AdvanceUs(1000u - (uint32_t)(gSimTimeUs % 1000u));
+#else
+        SIM_AdvanceUs((uint32_t)(gSimNextTickUs - gSimTimeUs));
+#endif
+    }
+
+    gSimPassStartUs = gSimTimeUs;
+}
+
+void SYSTICK_Init(void)
+{
+    SIM_SysTick.LOAD = SIM_TICK_LOAD - 1;
+    SIM_SysTick.VAL  = SIM_TICK_LOAD - 1;
+    SIM_SysTick.CTRL = 7;
+}
+
+void SYSTICK_DelayUs(uint32_t Delay)
+{
+    SIM_AdvanceUs(Delay);
+}
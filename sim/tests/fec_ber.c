@@ -0,0 +1,142 @@
+// sources: src/helper/fec.c
+// flags: -DENABLE_MESSENGER_FEC
+//
+// helper/fec.c on random 52 byte messenger packets. Codewords with 0 to 11
+// random bytes wrong: up to FEC_PARITY_SIZE / 2 must come back exact with
+// the right count, more must never be taken for a good packet. Then frame
+// success with and without the parity at a range of bit error rates, for
+// random errors and for 16 bit bursts (whose real rate is about half the
+// one in the table: every other bit of a burst flips).
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "helper/fec.h"
+
+#define ARRAY_SIZE(a)   (sizeof(a) / sizeof((a)[0]))
+
+#define DATA_SIZE       52
+#define CODE_SIZE       (DATA_SIZE + FEC_PARITY_SIZE)
+#define CODEWORDS       20000
+#define FRAMES          20000
+
+static unsigned long long gRandom = 88172645463325252ULL;
+
+static unsigned Random(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (unsigned)(gRandom >> 32);
+}
+
+static int8_t Decode(uint8_t *pCode)
+{
+    FEC_Decoder_t decoder;
+
+    FEC_DecodeStart(&decoder);
+    for (unsigned int i = 0; i < CODE_SIZE; i++)
+        FEC_DecodeByte(&decoder, pCode[i]);
+    return FEC_DecodeEnd(&decoder, pCode, DATA_SIZE);
+}
+
+static void RandomPacket(uint8_t *pCode)
+{
+    for (unsigned int i = 0; i < DATA_SIZE; i++)
+        pCode[i] = (uint8_t)Random();
+    FEC_Encode(pCode, DATA_SIZE, pCode + DATA_SIZE);
+}
+
+// each bit starts an error with probability ppm / 1e6; a burst of more
+// than one bit flips each of its other bits with probability 1/2
+static void AddBitErrors(uint8_t *pData, unsigned Size, unsigned Ppm, unsigned Burst)
+{
+    for (unsigned int i = 0; i < Size * 8; i++) {
+        if (Random() % 1000000U >= Ppm)
+            continue;
+        for (unsigned int b = 0; b < Burst && i + b < Size * 8; b++)
+            if (b == 0 || (Random() & 1))
+                pData[(i + b) / 8] ^= 1U << ((i + b) % 8);
+        i += Burst;
+    }
+}
+
+static unsigned CheckByteErrors(void)
+{
+    unsigned wrong = 0, detected = 0, miscorrected = 0, beyond = 0;
+
+    for (int t = 0; t < CODEWORDS; t++) {
+        uint8_t       code[CODE_SIZE], received[CODE_SIZE];
+        bool          used[CODE_SIZE] = {false};
+        const uint8_t errors = Random() % 12;
+
+        RandomPacket(code);
+        memcpy(received, code, CODE_SIZE);
+        for (uint8_t k = 0; k < errors; ) {
+            const unsigned p = Random() % CODE_SIZE;
+
+            if (used[p])
+                continue;
+            used[p] = true;
+            received[p] ^= 1 + Random() % 255;
+            k++;
+        }
+
+        const int8_t result = Decode(received);
+
+        if (errors <= FEC_PARITY_SIZE / 2) {
+            if (result != errors || memcmp(received, code, DATA_SIZE) != 0)
+                wrong++;
+        } else {
+            beyond++;
+            if (result < 0)
+                detected++;
+            else if (memcmp(received, code, DATA_SIZE) != 0)
+                miscorrected++;
+        }
+    }
+
+    printf("byte errors: %u of %u codewords with up to %u not corrected exactly\n",
+           wrong, CODEWORDS - beyond, FEC_PARITY_SIZE / 2);
+    printf("byte errors: %u of %u codewords with more detected, %u miscorrected\n",
+           detected, beyond, miscorrected);
+
+    return wrong + miscorrected;
+}
+
+static void FrameSuccess(unsigned Burst)
+{
+    static const unsigned Ppm[] = {1000, 3000, 5000, 10000, 15000, 20000};
+
+    printf("%2u bit bursts  plain     fec\n", Burst);
+    for (unsigned int k = 0; k < ARRAY_SIZE(Ppm); k++) {
+        unsigned plain = 0, fec = 0;
+
+        for (int t = 0; t < FRAMES; t++) {
+            uint8_t code[CODE_SIZE], received[CODE_SIZE];
+
+            RandomPacket(code);
+
+            memcpy(received, code, CODE_SIZE);
+            AddBitErrors(received, DATA_SIZE, Ppm[k] / Burst, Burst);
+            plain += memcmp(received, code, DATA_SIZE) == 0;
+
+            memcpy(received, code, CODE_SIZE);
+            AddBitErrors(received, CODE_SIZE, Ppm[k] / Burst, Burst);
+            fec += Decode(received) >= 0 && memcmp(received, code, DATA_SIZE) == 0;
+        }
+
+        printf("ber %.1f%%    %5.1f%%  %5.1f%%\n", Ppm[k] / 1e4, 100.0 * plain / FRAMES, 100.0 * fec / FRAMES);
+    }
+}
+
+int main(void)
+{
+    const unsigned failed = CheckByteErrors();
+
+    FrameSuccess(1);
+    FrameSuccess(16);
+
+    return failed != 0;
+}
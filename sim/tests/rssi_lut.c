@@ -0,0 +1,160 @@
+// sources: src/helper/rssi.c
+// flags: -DENABLE_RSSI_LUT
+//
+// helper/rssi.c against the conversions it replaced, copied here the way
+// they were: the spectrum's Rssi2PX()/DBm2S() and the main screen's
+// convertRSSIToSLevel(). Every band correction, every dbMin..dbMax window
+// the controls allow, both graph heights and RSSI 0..700 must give the
+// same pixel, and every dBm the same S-level.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "helper/rssi.h"
+
+#define ARRAY_SIZE(a)   (sizeof(a) / sizeof((a)[0]))
+
+#define FRAMES          200000
+
+// src/ui/main.c
+static const int8_t dBmCorrTable[7] = {-15, -25, -20, -4, -7, -6, -1};
+
+// src/app/spectrum.h
+static const uint8_t U8RssiMap[] = {121, 115, 109, 103, 97, 91, 85, 79, 73, 63};
+
+static int gDbMin, gDbMax, gCorr;
+
+static int clamp(int v, int min, int max)
+{
+    return v < min ? min : (v > max ? max : v);
+}
+
+static int Rssi2DBm(uint16_t rssi)
+{
+    return (rssi / 2) - 160 + gCorr;
+}
+
+static __attribute__((noinline)) uint8_t Rssi2PX(uint16_t rssi, uint8_t pxMin, uint8_t pxMax)
+{
+    const int DB_MIN = gDbMin << 1;
+    const int DB_MAX = gDbMax << 1;
+    const int DB_RANGE = DB_MAX - DB_MIN;
+
+    const uint8_t PX_RANGE = pxMax - pxMin;
+
+    int dbm = clamp(Rssi2DBm(rssi) << 1, DB_MIN, DB_MAX);
+
+    return ((dbm - DB_MIN) * PX_RANGE + DB_RANGE / 2) / DB_RANGE + pxMin;
+}
+
+static uint8_t DBm2S_Old(int dbm)
+{
+    uint8_t i = 0;
+    dbm *= -1;
+    for (i = 0; i < ARRAY_SIZE(U8RssiMap); i++)
+    {
+        if (dbm >= U8RssiMap[i])
+        {
+            return i;
+        }
+    }
+    return i;
+}
+
+// spectrum.c with ENABLE_RSSI_LUT
+static uint8_t DBm2S(int dbm)
+{
+    if (dbm > -67 && dbm <= -63)
+        return 9;
+    return RSSI_DBmToSLevel(dbm);
+}
+
+static uint8_t convertRSSIToSLevel(int16_t rssi_dBm)
+{
+    static const int16_t sLevelThresholds[] = {
+        -121, -115, -109, -103, -97, -91, -85, -79, -73, -67
+    };
+
+    for (uint8_t level = 0; level < ARRAY_SIZE(sLevelThresholds); level++) {
+        if (rssi_dBm <= sLevelThresholds[level]) {
+            return level;
+        }
+    }
+
+    return 10;
+}
+
+static double Now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+    static RSSI_Scale_t scale;
+    unsigned long long  cases = 0, differ = 0;
+
+    // RenderSpectrum(): y = endY - Rssi2PX(rssi, 0, endY), 33 with the
+    // waterfall on and 50 without
+    for (unsigned int band = 0; band < ARRAY_SIZE(dBmCorrTable); band++) {
+        gCorr = dBmCorrTable[band];
+        for (gDbMin = -185; gDbMin <= 10; gDbMin++) {
+            for (gDbMax = gDbMin + 1; gDbMax <= 10; gDbMax++) {
+                for (uint8_t endY = 33; endY <= 50; endY += 17) {
+                    RSSI_ScaleSet(&scale, gDbMin, gDbMax, gCorr, endY);
+                    for (uint16_t rssi = 0; rssi <= 700; rssi++, cases++) {
+                        const uint8_t old = endY - Rssi2PX(rssi, 0, endY);
+                        const uint8_t lut = scale.PxRange - RSSI_ScalePx(&scale, rssi);
+
+                        if (old != lut && differ++ < 5)
+                            printf("band %u, %d..%d dBm, height %u, rssi %u: %u, table %u\n",
+                                   band, gDbMin, gDbMax, endY, rssi, old, lut);
+                    }
+                }
+            }
+        }
+    }
+    printf("spectrum pixels: %llu cases, %llu differ\n", cases, differ);
+
+    cases  = 0;
+    differ = 0;
+    for (int dBm = -300; dBm <= 100; dBm++, cases += 2) {
+        differ += DBm2S_Old(dBm) != DBm2S(dBm);
+        differ += convertRSSIToSLevel(dBm) != RSSI_DBmToSLevel(dBm);
+    }
+    printf("s-levels: %llu cases, %llu differ\n", cases, differ);
+
+    // one 128 column frame of the default window, host ns
+    volatile unsigned sink = 0;
+    uint16_t          history[128];
+    double            t, old, lut;
+
+    gCorr  = -6;
+    gDbMin = -130;
+    gDbMax = -50;
+    RSSI_ScaleSet(&scale, gDbMin, gDbMax, gCorr, 50);
+    for (unsigned int x = 0; x < ARRAY_SIZE(history); x++)
+        history[x] = (x * 37) % 300 + 50;
+
+    t = Now();
+    for (int f = 0; f < FRAMES; f++)
+        for (unsigned int x = 0; x < ARRAY_SIZE(history); x++)
+            sink += 50 - Rssi2PX(history[x], 0, 50);
+    old = Now() - t;
+
+    t = Now();
+    for (int f = 0; f < FRAMES; f++)
+        for (unsigned int x = 0; x < ARRAY_SIZE(history); x++)
+            sink += scale.PxRange - RSSI_ScalePx(&scale, history[x]);
+    lut = Now() - t;
+
+    (void)sink;
+    printf("spectrum column: division %.2f ns, table %.2f ns\n",
+           old / FRAMES / ARRAY_SIZE(history) * 1e9, lut / FRAMES / ARRAY_SIZE(history) * 1e9);
+
+    return differ != 0;
+}
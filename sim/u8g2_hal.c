@@ -0,0 +1,211 @@
+// ST7565 stand-in for the host simulator.
+//
+// Replaces driver/u8g2_hal.c: u8g2 runs unchanged, but the bytes it would
+// clock out on SPI0 go into a model of the controller's display RAM
+// (8 pages of 132 columns). Commands and data are counted and charged at
+// the SPI0 byte rate, so the cost of a refresh is visible in virtual time.
+// With ENABLE_LCD_DMA the bytes go out in the background instead: the main
+// loop only pays when it has to wait for the segment ring or the transfer.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "u8g2_hal.h"
+#include "sim.h"
+
+#define LCD_PAGES       8
+#define LCD_COLUMNS     132
+#define LCD_X_OFFSET    4       // matches u8x8_st7565_64128n_display_info
+#define LCD_WIDTH       128
+#define SPI_BYTE_US     6u      // SPR=2, ~1.5 MHz SCK
+#define DMA_SEGMENTS    15      // usable slots of the driver's segment ring
+#define DMA_INLINE      8
+
+u8g2_t          u8g2;
+SIM_LCD_Stats_t gSimLCD_Stats;
+
+static uint8_t  gDisplayRam[LCD_PAGES][LCD_COLUMNS];
+static uint8_t  gPage;
+static uint8_t  gColumn;
+static bool     gDataMode;
+static bool     gSkipArgument;
+
+#ifdef ENABLE_LCD_DMA
+static uint64_t gSegmentDone[DMA_SEGMENTS];     // completion time per slot
+static unsigned gSegmentNext;
+static uint64_t gBusyUntil;
+static bool     gInlineOpen;
+static bool     gInlineData;
+static unsigned gInlineLength;
+
+static void LCD_Block(uint64_t Until)
+{
+    const uint64_t Now = SIM_GetTimeUs();
+
+    if (Until > Now) {
+        gSimLCD_Stats.BlockedUs += Until - Now;
+        SIM_AdvanceUs((uint32_t)(Until - Now));
+    }
+}
+
+// Mirrors LCD_DMA_Send in driver/u8g2_hal.c closely enough for timing:
+// frame buffer runs get a slot each, other bytes are packed 8 to a slot.
+static void LCD_Queue(unsigned Bytes, bool bFrame)
+{
+    while (Bytes > 0) {
+        unsigned n = Bytes;
+
+        if (bFrame) {
+            gInlineOpen = false;
+        } else if (gInlineOpen && gInlineData == gDataMode && gInlineLength < DMA_INLINE) {
+            n = n < DMA_INLINE - gInlineLength ? n : DMA_INLINE - gInlineLength;
+            gInlineLength += n;
+            gBusyUntil += n * SPI_BYTE_US;
+            gSegmentDone[(gSegmentNext + DMA_SEGMENTS - 1) % DMA_SEGMENTS] = gBusyUntil;
+            Bytes -= n;
+            continue;
+        } else {
+            n = n < DMA_INLINE ? n : DMA_INLINE;
+            gInlineOpen   = true;
+            gInlineData   = gDataMode;
+            gInlineLength = n;
+        }
+
+        LCD_Block(gSegmentDone[gSegmentNext]);
+        if (gBusyUntil < SIM_GetTimeUs())
+            gBusyUntil = SIM_GetTimeUs();
+        gBusyUntil += n * SPI_BYTE_US;
+        gSegmentDone[gSegmentNext] = gBusyUntil;
+        gSegmentNext = (gSegmentNext + 1) % DMA_SEGMENTS;
+        Bytes -= n;
+    }
+}
+
+void U8G2_HAL_WaitIdle(void)
+{
+    LCD_Block(gBusyUntil);
+}
+#endif
+
+static void LCD_Command(uint8_t Cmd)
+{
+    gSimLCD_Stats.Commands++;
+
+    if (gSkipArgument) {
+        gSkipArgument = false;
+        return;
+    }
+
+    if ((Cmd & 0xF0) == 0xB0)
+        gPage = Cmd & 0x0F;
+    else if ((Cmd & 0xF0) == 0x10)
+        gColumn = (uint8_t)((gColumn & 0x0F) | ((Cmd & 0x0F) << 4));
+    else if ((Cmd & 0xF0) == 0x00)
+        gColumn = (uint8_t)((gColumn & 0xF0) | (Cmd & 0x0F));
+    else if (Cmd == 0x81 || Cmd == 0xF8)
+        gSkipArgument = true;     // electronic volume / booster ratio take one byte
+}
+
+static void LCD_Data(uint8_t Data)
+{
+    gSimLCD_Stats.DataBytes++;
+
+    if (gPage < LCD_PAGES && gColumn < LCD_COLUMNS)
+        gDisplayRam[gPage][gColumn] = Data;
+    gColumn++;
+}
+
+// "-" prints the rows to stderr as text, "lcd <row> ..#..", for sim/tests
+bool SIM_LCD_Dump(const char *pPath)
+{
+    const bool text = strcmp(pPath, "-") == 0;
+    FILE      *f    = text ? stderr : fopen(pPath, "wb");
+
+    if (f == NULL)
+        return false;
+
+    if (!text)
+        fprintf(f, "P1\n%u %u\n", LCD_WIDTH, LCD_PAGES * 8);
+    for (unsigned y = 0; y < LCD_PAGES * 8; y++) {
+        if (text)
+            fprintf(f, "lcd %2u ", y);
+        for (unsigned x = 0; x < LCD_WIDTH; x++) {
+            const bool on = (gDisplayRam[y / 8][x + LCD_X_OFFSET] >> (y % 8)) & 1;
+
+            if (text) {
+                fputc(on ? '#' : '.', f);
+            } else {
+                fputc(on ? '1' : '0', f);
+                fputc(x + 1 < LCD_WIDTH ? ' ' : '\n', f);
+            }
+        }
+        if (text)
+            fputc('\n', f);
+    }
+
+    if (!text)
+        fclose(f);
+    return true;
+}
+
+static uint8_t u8x8_sim_gpio_and_delay_cb(__attribute__((unused)) u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, __attribute__((unused)) void *arg_ptr) {
+    switch (msg) {
+    case U8X8_MSG_DELAY_MILLI:
+#ifdef ENABLE_LCD_DMA
+        U8G2_HAL_WaitIdle();
+#endif
+        SIM_AdvanceUs(arg_int * 10);
+        break;
+    case U8X8_MSG_GPIO_DC:
+        gDataMode = arg_int != 0;
+        break;
+    default:
+        break;
+    }
+    return 1;
+}
+
+static uint8_t u8x8_sim_spi_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
+    const uint8_t *data;
+
+    switch (msg) {
+    case U8X8_MSG_BYTE_SEND:
+        data = (const uint8_t *)arg_ptr;
+#ifdef ENABLE_LCD_DMA
+        LCD_Queue(arg_int, data >= u8g2_GetBufferPtr(&u8g2) && data < u8g2_GetBufferPtr(&u8g2) + LCD_PAGES * LCD_WIDTH);
+#else
+        gSimLCD_Stats.BlockedUs += arg_int * SPI_BYTE_US;
+        SIM_AdvanceUs(arg_int * SPI_BYTE_US);
+#endif
+        while (arg_int > 0) {
+            if (gDataMode)
+                LCD_Data(*data);
+            else
+                LCD_Command(*data);
+            data++;
+            arg_int--;
+        }
+        break;
+    case U8X8_MSG_BYTE_START_TRANSFER:
+        gSimLCD_Stats.Transfers++;
+        break;
+    case U8X8_MSG_BYTE_END_TRANSFER:
+        break;
+    case U8X8_MSG_BYTE_SET_DC:
+        u8x8_gpio_SetDC(u8x8, arg_int);
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
+
+void U8G2_HAL_Init(void) {
+    u8g2_Setup_st7565_64128n_f(&u8g2, U8G2_R0, u8x8_sim_spi_cb, u8x8_sim_gpio_and_delay_cb);
+    u8g2_InitDisplay(&u8g2);
+    u8g2_SetPowerSave(&u8g2, 0);
+    u8g2_ClearDisplay(&u8g2);
+#ifdef ENABLE_LCD_DMA
+    U8G2_HAL_WaitIdle();
+#endif
+}
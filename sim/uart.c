@@ -0,0 +1,213 @@
+// UART1 stand-in for the host simulator.
+//
+// Transmit goes to a file (or nowhere) and is charged at the current baud
+// rate, 115200 unless the firmware switched it. With ENABLE_UART_TX_QUEUE the
+// bytes go out in the background instead: the main loop only pays when the
+// ring is full or it asks for a flush.
+// Receive mimics the DMA ring the real driver sets up: injected bytes land
+// in UART_DMA_Buffer and the write position shows up in DMA_CH0->ST, which
+// is all app/uart.c looks at.
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "dp32g030/dma.h"
+#include "driver/uart.h"
+#include "printf.h"
+#include "sim.h"
+
+uint8_t UART_DMA_Buffer[256];
+
+SIM_UART_Stats_t gSimUART_Stats;
+
+static FILE    *gUartFile;
+static uint32_t gUartRxIndex;
+static uint32_t gUartBaud = UART_DEFAULT_BAUD;
+
+#ifdef ENABLE_UART_TX_QUEUE
+UART_TxStats_t  gUART_TxStats;
+
+static uint64_t gTxBusyUntil;       // last queued byte is on the wire
+static uint64_t gTxInPlaceStart;
+static uint64_t gTxInPlaceEnd;
+#endif
+
+void SIM_UART_Open(const char *pPath)
+{
+    gUartFile = fopen(pPath, "wb");
+}
+
+void SIM_UART_Inject(const void *pData, uint32_t Size)
+{
+    const uint8_t *p = pData;
+
+    for (uint32_t i = 0; i < Size; i++) {
+        UART_DMA_Buffer[gUartRxIndex] = p[i];
+        gUartRxIndex = (gUartRxIndex + 1) % sizeof(UART_DMA_Buffer);
+    }
+
+    DMA_CH0->ST = (DMA_CH0->ST & ~0xFFFU) | gUartRxIndex;
+}
+
+void UART_Init(void)
+{
+    gUartBaud    = UART_DEFAULT_BAUD;
+    gUartRxIndex = 0;
+    DMA_CH0->ST  = 0;
+}
+
+static void UART_Write(const void *pBuffer, uint32_t Size)
+{
+    if (gUartFile != NULL) {
+        fwrite(pBuffer, 1, Size, gUartFile);
+        fflush(gUartFile);
+    }
+
+    gSimUART_Stats.TxBytes += Size;
+}
+
+// 10 bits a byte
+static uint64_t UART_ByteTimeUs(uint32_t Size)
+{
+    return (uint64_t)Size * 10000000u / gUartBaud;
+}
+
+static void UART_Block(uint64_t Until)
+{
+    const uint64_t Now = SIM_GetTimeUs();
+
+    if (Until > Now) {
+        gSimUART_Stats.BlockedUs += Until - Now;
+        SIM_AdvanceUs((uint32_t)(Until - Now));
+    }
+}
+
+#ifdef ENABLE_UART_TX_QUEUE
+// bytes of the ring not on the wire yet, the in-place buffer doesn't count
+static uint32_t UART_RingUsed(void)
+{
+    const uint64_t Now     = SIM_GetTimeUs();
+    uint64_t       Pending = gTxBusyUntil > Now ? gTxBusyUntil - Now : 0;
+
+    if (gTxInPlaceEnd > Now) {
+        const uint64_t Start = gTxInPlaceStart > Now ? gTxInPlaceStart : Now;
+
+        Pending -= gTxInPlaceEnd - Start;
+    }
+
+    return (uint32_t)((Pending * gUartBaud + 9999999u) / 10000000u);
+}
+
+static void UART_Queue(uint32_t Size)
+{
+    const uint64_t Now  = SIM_GetTimeUs();
+    const uint32_t Used = UART_RingUsed() + Size;
+
+    if (gTxBusyUntil < Now)
+        gTxBusyUntil = Now;
+    gTxBusyUntil += UART_ByteTimeUs(Size);
+
+    gUART_TxStats.Queued += Size;
+    if (Used > gUART_TxStats.Peak)
+        gUART_TxStats.Peak = Used < UART_TX_QUEUE_SIZE ? Used : UART_TX_QUEUE_SIZE;
+}
+
+void UART_Send(const void *pBuffer, uint32_t Size)
+{
+    UART_Write(pBuffer, Size);
+    UART_Queue(Size);
+
+    // returns when the last byte fits into the ring
+    if (UART_RingUsed() > UART_TX_QUEUE_SIZE) {
+        gUART_TxStats.Waits++;
+        UART_Block(gTxBusyUntil - UART_ByteTimeUs(UART_TX_QUEUE_SIZE));
+    }
+}
+
+bool UART_TrySend(const void *pBuffer, uint32_t Size)
+{
+    if (Size > UART_TX_QUEUE_SIZE - UART_RingUsed()) {
+        gUART_TxStats.Dropped += Size;
+        return false;
+    }
+
+    UART_Write(pBuffer, Size);
+    UART_Queue(Size);
+    return true;
+}
+
+bool UART_SendInPlace(const void *pPrefix, uint32_t PrefixSize, const void *pBuffer, uint16_t Size)
+{
+    if (UART_TxInPlaceBusy() || PrefixSize > UART_TX_QUEUE_SIZE - UART_RingUsed()) {
+        gUART_TxStats.Dropped += PrefixSize + Size;
+        return false;
+    }
+
+    UART_Write(pPrefix, PrefixSize);
+    UART_Queue(PrefixSize);
+    UART_Write(pBuffer, Size);
+    gTxInPlaceStart = gTxBusyUntil;
+    gTxBusyUntil   += UART_ByteTimeUs(Size);
+    gTxInPlaceEnd   = gTxBusyUntil;
+    gUART_TxStats.Queued += Size;
+    return true;
+}
+
+bool UART_TxInPlaceBusy(void)
+{
+    return gTxInPlaceEnd > SIM_GetTimeUs();
+}
+
+void UART_Flush(void)
+{
+    UART_Block(gTxBusyUntil);
+}
+#else
+void UART_Send(const void *pBuffer, uint32_t Size)
+{
+    UART_Write(pBuffer, Size);
+    UART_Block(SIM_GetTimeUs() + UART_ByteTimeUs(Size));
+}
+#endif
+
+#ifdef ENABLE_UART_FAST_EEPROM
+void UART_SetBaudRate(uint32_t Baud)
+{
+#ifdef ENABLE_UART_TX_QUEUE
+    UART_Flush();
+#endif
+    gUartBaud = Baud;
+}
+#endif
+
+void UART_LogSend(const void *pBuffer, uint32_t Size)
+{
+    (void)pBuffer;
+    (void)Size;
+}
+
+#ifdef ENABLE_FEAT_F4HWN_SCREENSHOT
+    bool UART_IsCableConnected(void) {
+        for (size_t i = 0; i < sizeof(UART_DMA_Buffer); i++) {
+            if (UART_DMA_Buffer[i] == 0x55) {
+                UART_DMA_Buffer[i] = 0x00;
+                return true;
+            }
+        }
+        return false;
+    }
+#endif
+
+void UART_printf(const char *str, ...)
+{
+    char text[256];
+    int  len;
+
+    va_list va;
+    va_start(va, str);
+    len = vsnprintf(text, sizeof(text), str, va);
+    va_end(va);
+
+    UART_Send(text, len);
+}
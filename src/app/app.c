@@ -55,6 +55,7 @@
     #include "driver/bk1080.h"
 #endif
 #include "driver/bk4819.h"
+#include "driver/eeprom.h"
 #include "driver/gpio.h"
 #include "driver/keyboard.h"
 ////#include "driver/st7565.h"
@@ -64,6 +65,7 @@
 #include "frequencies.h"
 #include "functions.h"
 #include "helper/battery.h"
+#include "helper/profiler.h"
 #include "misc.h"
 #include "radio.h"
 #include "settings.h"
@@ -663,15 +665,44 @@ static void DualwatchAlternate(void)
     #endif
 }
 
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+// Producer side of the BK4819 event queue. It runs on every main loop pass,
+// at most once per millisecond, so FSK FIFO words and DTMF codes are picked
+// up long before the next 10 ms slice gets to CheckRadioInterrupts().
+static void PollRadioInterrupts(void)
+{
+    static uint8_t last_step = 0xFF;
+    const uint8_t  step      = SysTick->VAL / ((SysTick->LOAD + 1) / 10);
+
+    if (step == last_step)
+        return;
+    last_step = step;
+
+    if (SCANNER_IsScanning() || gReducedService)
+        return;
+
+    if (gCurrentFunction != FUNCTION_POWER_SAVE || !gRxIdleMode)
+        BK4819_PollInterrupts();
+}
+#endif
+
 static void CheckRadioInterrupts(void)
 {
     if (SCANNER_IsScanning())
         return;
 
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+    BK4819_IrqEvent_t event;
+
+    BK4819_PollInterrupts();
+
+    while (BK4819_GetInterrupt(&event)) {
+#else
     while (BK4819_ReadRegister(BK4819_REG_0C) & 1u) { // BK chip interrupt request
         // clear interrupts
         BK4819_WriteRegister(BK4819_REG_02, 0);
         // fetch interrupt status bits
+#endif
 
         union {
             struct {
@@ -695,7 +726,11 @@ static void CheckRadioInterrupts(void)
             uint16_t __raw;
         } interrupts;
 
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+        interrupts.__raw = event.Flags;
+#else
         interrupts.__raw = BK4819_ReadRegister(BK4819_REG_02);
+#endif
 
         // 0 = no phase shift
         // 1 = 120deg phase shift
@@ -706,7 +741,11 @@ static void CheckRadioInterrupts(void)
 //          g_CTCSS_Lost = true;
 
         if (interrupts.dtmf5ToneFound) {    
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+            const char c = DTMF_GetCharacter(event.Code); // save the RX'ed DTMF character
+#else
             const char c = DTMF_GetCharacter(BK4819_GetDTMF_5TONE_Code()); // save the RX'ed DTMF character
+#endif
             if (c != 0xff) {
                 if (gCurrentFunction != FUNCTION_TRANSMIT) {
                     if (gSetting_live_DTMF_decoder) {
@@ -804,15 +843,25 @@ static void CheckRadioInterrupts(void)
             gAircopyState == AIRCOPY_TRANSFER &&
             gAirCopyIsSendMode == 0)
         {
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+            for (unsigned int i = 0; i < event.FifoWords; i++) {
+                g_FSK_Buffer[gFSKWriteIndex++] = event.Fifo[i];
+            }
+#else
             for (unsigned int i = 0; i < 4; i++) {
                 g_FSK_Buffer[gFSKWriteIndex++] = BK4819_ReadRegister(BK4819_REG_5F);
             }
+#endif
 
             AIRCOPY_StorePacket();
         }
 #endif
 #ifdef ENABLE_MESSENGER
+	#ifdef ENABLE_BK4819_IRQ_QUEUE
+		MSG_StorePacket(interrupts.__raw, event.Fifo, event.FifoWords);
+	#else
 		MSG_StorePacket(interrupts.__raw);
+	#endif
 #endif
     }
 }
@@ -906,6 +955,10 @@ static void HandleVox(void)
 
 void APP_Update(void)
 {
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+    PollRadioInterrupts();
+#endif
+
 #ifdef ENABLE_VOICE
     if (gFlagPlayQueuedVoice) {
             AUDIO_PlayQueuedVoice();
@@ -1021,7 +1074,10 @@ void APP_Update(void)
     if (!SCANNER_IsScanning() && gScanStateDir != SCAN_OFF && gScheduleScanListen && !gPttIsPressed)
 #endif
     {   // scanning
-        CHFRSCANNER_ContinueScanning();
+#ifdef ENABLE_SCAN_PRECHECK
+        if (!CHFRSCANNER_KeepDwelling())
+#endif
+            CHFRSCANNER_ContinueScanning();
     }
 
 #ifdef ENABLE_NOAA
@@ -1372,6 +1428,10 @@ void APP_TimeSlice10ms(void)
     gNextTimeslice = false;
     gFlashLightBlinkCounter++;
 
+#ifdef ENABLE_EEPROM_WRITE_CACHE
+    EEPROM_TimeSlice10ms();
+#endif
+
 #ifdef ENABLE_MESSENGER
 	if (keyTickCounter <= MSG_NEXT_CHAR_DELAY) {
 		keyTickCounter++;
@@ -1379,27 +1439,37 @@ void APP_TimeSlice10ms(void)
 	if (keyTickCounter > MSG_NEXT_CHAR_DELAY) {
 		MSG_TimeoutInput();
 	}
+	MSG_TimeSlice10ms();
 #endif
 
 #ifdef ENABLE_AM_FIX
     if (gRxVfo->Modulation == MODULATION_AM) {
+        PROFILE_BEGIN(PROFILER_AM_FIX);
         AM_fix_10ms(gEeprom.RX_VFO);
+        PROFILE_END(PROFILER_AM_FIX);
     }
 #endif
 
 #ifdef ENABLE_UART
-    if (UART_IsCommandAvailable()) {
-        __disable_irq();
+    PROFILE_BEGIN(PROFILER_UART);
+    // the handlers share nothing with the SysTick or LCD DMA interrupts,
+    // leave them running through long transfers
+    if (UART_IsCommandAvailable())
         UART_HandleCommand();
-        __enable_irq();
-    }
+#ifdef ENABLE_UART_TX_QUEUE
+    UART_SendPendingScreen();
+#endif
+    PROFILE_END(PROFILER_UART);
 #endif
 
     if (gReducedService)
         return;
 
-    if (gCurrentFunction != FUNCTION_POWER_SAVE || !gRxIdleMode)
+    if (gCurrentFunction != FUNCTION_POWER_SAVE || !gRxIdleMode) {
+        PROFILE_BEGIN(PROFILER_RADIO_IRQ);
         CheckRadioInterrupts();
+        PROFILE_END(PROFILER_RADIO_IRQ);
+    }
 
     if (gCurrentFunction == FUNCTION_TRANSMIT)
     {   // transmitting
@@ -1703,6 +1773,9 @@ void APP_TimeSlice500ms(void)
 
         if (gBatteryCurrent > 500 || gBatteryCalibration[3] < gBatteryCurrentVoltage)
         {
+            #ifdef ENABLE_EEPROM_WRITE_CACHE
+                EEPROM_Flush();
+            #endif
             #ifdef ENABLE_OVERLAY
                 overlay_FLASH_RebootToBootloader();
             #else
@@ -2084,6 +2157,16 @@ static void ProcessKey(KEY_Code_t Key, bool bKeyPressed, bool bKeyHeld)
         goto Skip;
     }
 
+#ifdef ENABLE_MESSENGER
+    if (MSG_IsTransmitting()) {
+        // keyed up for the messenger: its screen still takes the next
+        // message, nothing else may send DTMF or take over the PTT
+        if (gScreenToDisplay == DISPLAY_MSG && Key != KEY_PTT && Key != KEY_SIDE1 && Key != KEY_SIDE2)
+            MSG_ProcessKeys(Key, bKeyPressed, bKeyHeld);
+        goto Skip;
+    }
+#endif
+
     if (gCurrentFunction == FUNCTION_TRANSMIT) {
 #if defined(ENABLE_ALARM) || defined(ENABLE_TX1750)
         if (gAlarmState == ALARM_STATE_OFF)
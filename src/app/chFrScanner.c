@@ -1,7 +1,13 @@
 
 #include "app/app.h"
 #include "app/chFrScanner.h"
+#ifdef ENABLE_SCAN_PRECHECK
+    #include "driver/bk4819.h"
+#endif
 #include "functions.h"
+#ifdef ENABLE_FREQ_BLACKLIST
+    #include "helper/blacklist.h"
+#endif
 #include "misc.h"
 #include "settings.h"
 //#include "debugging.h"
@@ -34,9 +40,63 @@ uint8_t             initialCROSS_BAND_RX_TX;
     uint32_t lastFoundFrqOrChanOld;
 #endif
 
+#ifdef ENABLE_SCAN_PRECHECK
+static uint16_t     scanDwellRest_10ms;     // rest of the dwell once the pre-check passes
+#endif
+
 static void NextFreqChannel(void);
 static void NextMemChannel(void);
 
+#ifdef ENABLE_SCAN_PRECHECK
+static void StartPrecheck(void)
+{
+    scanDwellRest_10ms = 0;
+
+    if (gScanPauseDelayIn_10ms > SCAN_PRECHECK_10MS) {
+        scanDwellRest_10ms     = gScanPauseDelayIn_10ms - SCAN_PRECHECK_10MS;
+        gScanPauseDelayIn_10ms = SCAN_PRECHECK_10MS;
+    }
+}
+
+static bool PrecheckPassed(void)
+{
+    const VFO_Info_t *pInfo = gRxVfo;
+
+#if SCAN_PRECHECK_POLICY & SCAN_PRECHECK_RSSI
+    if (BK4819_GetRSSI() + SCAN_PRECHECK_RSSI_MARGIN < pInfo->SquelchOpenRSSIThresh)
+        return false;
+#endif
+#if SCAN_PRECHECK_POLICY & SCAN_PRECHECK_NOISE
+    if (BK4819_GetExNoiceIndicator() > pInfo->SquelchOpenNoiseThresh + SCAN_PRECHECK_NOISE_MARGIN)
+        return false;
+#endif
+#if SCAN_PRECHECK_POLICY & SCAN_PRECHECK_GLITCH
+    if (BK4819_GetGlitchIndicator() > pInfo->SquelchOpenGlitchThresh + SCAN_PRECHECK_GLITCH_MARGIN)
+        return false;
+#endif
+
+    return true;
+}
+
+// called when the dwell timer runs out, true while the step deserves more time
+bool CHFRSCANNER_KeepDwelling(void)
+{
+    const uint16_t rest = scanDwellRest_10ms;
+
+    scanDwellRest_10ms = 0;
+
+    // an open squelch is handled by the normal scan logic
+    if (rest == 0 || gCurrentFunction == FUNCTION_INCOMING || !PrecheckPassed())
+        return false;
+
+    gScanPauseDelayIn_10ms = rest;
+    gScheduleScanListen    = false;
+
+    return true;
+}
+#endif
+
+
 void CHFRSCANNER_Start(const bool storeBackupSettings, const int8_t scan_direction)
 {
     if (storeBackupSettings) {
@@ -133,6 +193,10 @@ void CHFRSCANNER_Found(void)
     // gScheduleScanListen is always false...
     gScheduleScanListen = false;
 
+#ifdef ENABLE_SCAN_PRECHECK
+    scanDwellRest_10ms = 0;
+#endif
+
     /*
     if(gEeprom.SCAN_RESUME_MODE > 1 && gEeprom.SCAN_RESUME_MODE < 26)
     {
@@ -224,15 +288,24 @@ void CHFRSCANNER_Stop(void)
     gUpdateDisplay = true;
 }
 
-static void NextFreqChannel(void)
+static uint32_t NextFrequency(void)
 {
 #ifdef ENABLE_SCAN_RANGES
-    if(gScanRangeStart) {
-        gRxVfo->freq_config_RX.Frequency = APP_SetFreqByStepAndLimits(gRxVfo, gScanStateDir, gScanRangeStart, gScanRangeStop);
-    }
-    else
+    if(gScanRangeStart)
+        return APP_SetFreqByStepAndLimits(gRxVfo, gScanStateDir, gScanRangeStart, gScanRangeStop);
+#endif
+    return APP_SetFrequencyByStep(gRxVfo, gScanStateDir);
+}
+
+static void NextFreqChannel(void)
+{
+    gRxVfo->freq_config_RX.Frequency = NextFrequency();
+
+#ifdef ENABLE_FREQ_BLACKLIST
+    // step over blacklisted frequencies, no more than all of them in a row
+    for (unsigned int i = 0; i < BLACKLIST_MAX_ENTRIES && BLACKLIST_Contains(gRxVfo->freq_config_RX.Frequency); i++)
+        gRxVfo->freq_config_RX.Frequency = NextFrequency();
 #endif
-        gRxVfo->freq_config_RX.Frequency = APP_SetFrequencyByStep(gRxVfo, gScanStateDir);
 
     RADIO_ApplyOffset(gRxVfo);
     RADIO_ConfigureSquelchAndOutputPower(gRxVfo);
@@ -244,6 +317,10 @@ static void NextFreqChannel(void)
     gScanPauseDelayIn_10ms = scan_pause_delay_in_6_10ms;
 #endif
 
+#ifdef ENABLE_SCAN_PRECHECK
+    StartPrecheck();
+#endif
+
     gUpdateDisplay     = true;
 }
 
@@ -363,6 +440,10 @@ static void NextMemChannel(void)
     gScanPauseDelayIn_10ms = scan_pause_delay_in_3_10ms;
 #endif
 
+#ifdef ENABLE_SCAN_PRECHECK
+    StartPrecheck();
+#endif
+
     if (enabled)
         if (++currentScanList >= SCAN_NEXT_NUM)
             currentScanList = SCAN_NEXT_CHAN_SCANLIST1;  // back round we go
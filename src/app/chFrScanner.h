@@ -15,6 +15,35 @@ extern uint32_t          gScanRangeStart;
 extern uint32_t          gScanRangeStop;
 #endif
 
+#ifdef ENABLE_SCAN_PRECHECK
+    // Two-stage dwell: every step is first given SCAN_PRECHECK_10MS to settle,
+    // then the RSSI/noise/glitch indicators are compared with the squelch open
+    // thresholds, widened by the margins below. Only a step that could open the
+    // squelch gets the rest of the normal dwell, the others are skipped at once.
+    // SCAN_PRECHECK_POLICY picks the indicators that must agree.
+    #define SCAN_PRECHECK_RSSI          (1u << 0)
+    #define SCAN_PRECHECK_NOISE         (1u << 1)
+    #define SCAN_PRECHECK_GLITCH        (1u << 2)
+
+    #ifndef SCAN_PRECHECK_POLICY
+        #define SCAN_PRECHECK_POLICY    (SCAN_PRECHECK_RSSI | SCAN_PRECHECK_NOISE | SCAN_PRECHECK_GLITCH)
+    #endif
+    #ifndef SCAN_PRECHECK_10MS
+        #define SCAN_PRECHECK_10MS      2   // PLL lock plus one RSSI/noise integration
+    #endif
+    #ifndef SCAN_PRECHECK_RSSI_MARGIN
+        #define SCAN_PRECHECK_RSSI_MARGIN   10  // 0.5 dB units below the open threshold
+    #endif
+    #ifndef SCAN_PRECHECK_NOISE_MARGIN
+        #define SCAN_PRECHECK_NOISE_MARGIN  10  // above the open threshold
+    #endif
+    #ifndef SCAN_PRECHECK_GLITCH_MARGIN
+        #define SCAN_PRECHECK_GLITCH_MARGIN 20  // above the open threshold
+    #endif
+
+    bool CHFRSCANNER_KeepDwelling(void);
+#endif
+
 void CHFRSCANNER_Found(void);
 void CHFRSCANNER_Stop(void);
 void CHFRSCANNER_Start(const bool storeBackupSettings, const int8_t scan_direction);
@@ -39,6 +39,9 @@
 #include "driver/bk4819.h"
 #include "dtmf.h"
 #include "frequencies.h"
+#ifdef ENABLE_FREQ_BLACKLIST
+    #include "helper/blacklist.h"
+#endif
 #include "misc.h"
 #include "radio.h"
 #include "settings.h"
@@ -79,6 +82,7 @@ static void toggle_chan_scanlist(void)
     if(gMR_ChannelExclude[gTxVfo->CHANNEL_SAVE] == true)
     {
         gMR_ChannelExclude[gTxVfo->CHANNEL_SAVE] = false;
+        RADIO_UpdateChannelBitmaps(gTxVfo->CHANNEL_SAVE);
         return;
     }
 
@@ -685,10 +689,19 @@ static void MAIN_Key_MENU(bool bKeyPressed, bool bKeyHeld)
             {
                 if(FUNCTION_IsRx() || gScanPauseDelayIn_10ms > 9)
                 {
-                    gMR_ChannelExclude[gTxVfo->CHANNEL_SAVE] = true;
+                    #ifdef ENABLE_FREQ_BLACKLIST
+                    // frequency scan: skip this frequency from now on
+                    if(IS_FREQ_CHANNEL(gTxVfo->CHANNEL_SAVE))
+                        BLACKLIST_Add(gRxVfo->freq_config_RX.Frequency);
+                    else
+                    #endif
+                    {
+                        gMR_ChannelExclude[gTxVfo->CHANNEL_SAVE] = true;
+                        RADIO_UpdateChannelBitmaps(gTxVfo->CHANNEL_SAVE);
 
-                    gVfoConfigureMode = VFO_CONFIGURE;
-                    gFlagResetVfos    = true;
+                        gVfoConfigureMode = VFO_CONFIGURE;
+                        gFlagResetVfos    = true;
+                    }
 
                     lastFoundFrqOrChan = lastFoundFrqOrChanOld;
 
@@ -1556,6 +1556,9 @@ static void MENU_Key_MENU(const bool bKeyPressed, const bool bKeyHeld)
 
                         MENU_AcceptSetting();
 
+                        #ifdef ENABLE_EEPROM_WRITE_CACHE
+                            EEPROM_Flush();
+                        #endif
                         #if defined(ENABLE_OVERLAY)
                             overlay_FLASH_RebootToBootloader();
                         #else
@@ -20,6 +20,23 @@
 #if defined(ENABLE_UART)
 	#include "driver/uart.h"
 #endif
+#ifdef ENABLE_MESSENGER_LINK
+	#include "driver/crc.h"
+	#include "helper/msglink.h"
+#endif
+#ifdef ENABLE_MESSENGER_FEC
+	#include "helper/fec.h"
+#endif
+#ifdef ENABLE_MESSENGER_LOG
+	#include "helper/msglog.h"
+#endif
+
+#if defined(ENABLE_MESSENGER_LONG) && !defined(ENABLE_MESSENGER_LINK)
+	#error "ENABLE_MESSENGER_LONG needs ENABLE_MESSENGER_LINK"
+#endif
+#if defined(ENABLE_MESSENGER_LOG) && defined(ENABLE_DTMF_CALLING)
+	#error "ENABLE_MESSENGER_LOG keeps the history where ENABLE_DTMF_CALLING keeps its contacts"
+#endif
 
 typedef enum MsgStatus {
 	READY,
@@ -39,7 +56,6 @@ static const uint8_t numberOfNumsAssignedToKey[9] = { 1, 1, 1, 1, 1, 1, 1, 1, 1
 
 char cMessage[TX_MSG_LENGTH];
 char lastcMessage[TX_MSG_LENGTH];
-char rxMessage[MAX_LINES][MAX_RX_MSG_LENGTH + 2];
 uint8_t cIndex = 0;
 uint8_t prevKey = 0, prevLetter = 0;
 KeyboardType keyboardType = UPPERCASE;
@@ -48,29 +64,153 @@ MsgStatus msgStatus = READY;
 
 uint8_t msgFSKBuffer[MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH];
 
+#ifdef ENABLE_MESSENGER_FEC
+// msgFSKBuffer goes out with Reed-Solomon parity after it; the syndromes
+// are worked out as the FIFO words come in
+#define MSG_FSK_PACKET_SIZE (MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH + FEC_PARITY_SIZE)
+
+static FEC_Decoder_t msgFecDecoder;
+
+MSG_FecStats_t gMsgFecStats;
+#else
+#define MSG_FSK_PACKET_SIZE (MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH)
+#endif
+
+// FIFO words per FSK_FIFO_ALMOST_FULL interrupt, REG_5E <2:0>
+#define MSG_FSK_FIFO_THRESHOLD  1
+
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+_Static_assert(MSG_FSK_FIFO_THRESHOLD <= BK4819_IRQ_FIFO_WORDS, "an interrupt record must hold all the words of one FIFO interrupt");
+#endif
+
 uint16_t gErrorsDuringMSG;
 
 uint8_t hasNewMessage = 0;
 
 uint8_t keyTickCounter = 0;
 
+#ifdef ENABLE_MESSENGER_LINK
+// Messages go out as link frames and are sent again from the 10 ms slice
+// until an ACK names them: after MSG_LINK_ACK_TIMEOUT, a little longer on
+// each retry plus some jitter so two stations don't stay in step, or soon
+// after a NACK. Up to MSG_LINK_SLOTS messages can be in flight and an ACK
+// covers them all, so only the ones it misses are sent again. Receivers
+// keep a window of recent sequence numbers per station, a repeat is
+// ACKed again but not shown twice. ACKs and NACKs wait MSG_LINK_REPLY_DELAY
+// too, the sender is still keyed up for a while after its packet, plus a
+// random number of MSG_TX_REPLY_SLOTs: a chat message goes to every station
+// and all of them ACK it, so the replies are spread out and the later ones
+// hear the first on the air and wait for it.
+#define MSG_LINK_SLOTS          4
+#define MSG_LINK_RETRIES        3       // sends after the first
+#define MSG_LINK_ACK_TIMEOUT    250     // 10 ms ticks
+#define MSG_LINK_BACKOFF        100     // added per retry
+#define MSG_LINK_NACK_DELAY     30
+#define MSG_LINK_REPLY_DELAY    50
+#define MSG_LINK_PEERS          4
+
+_Static_assert(MSGLINK_FRAME_SIZE == MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH, "link frames must fill the FSK packet");
+_Static_assert(TX_MSG_LENGTH <= MSGLINK_MAX_PAYLOAD, "messages must fit a link frame");
+
+typedef struct {
+	uint8_t  Tries;         // sends so far, 0 for a free slot
+	uint8_t  Seq;
+	uint16_t Timer;         // 10 ms ticks to the next send
+	int16_t  Line;          // number of the line showing it, -1 for none
+	uint8_t  Length;
+	uint8_t  Payload[TX_MSG_LENGTH];
+} MsgPending_t;
+
+typedef struct {
+	uint16_t Station;
+	uint8_t  Top;           // highest sequence number taken
+	uint8_t  Seen;          // bit i: Top - 1 - i taken as well
+} MsgPeer_t;
+
+typedef struct {
+	uint8_t  Timer;         // 10 ms ticks to sending it, 0 for none
+	uint8_t  Type;
+	uint8_t  Seq;
+	uint8_t  Seen;
+	uint16_t Dst;
+} MsgReply_t;
+
+static MsgPending_t gMsgPending[MSG_LINK_SLOTS];
+static MsgReply_t   gMsgReply;      // a newer one replaces it
+static MsgPeer_t    gMsgPeers[MSG_LINK_PEERS];
+static uint8_t      gMsgPeerCount;
+static uint8_t      gMsgPeerNext;
+static uint16_t     gMsgStation;    // 0 until worked out
+static uint8_t      gMsgSeq;
+
+MSG_LinkStats_t gMsgLinkStats;
+#endif
+
+#ifdef ENABLE_MESSENGER_LONG
+// A message too long for one frame goes out in a single key up as
+// fragments with consecutive sequence numbers. One ACK covers them all and
+// a retry sends only the ones it missed. The receiver puts together one
+// message at a time and drops it when the rest doesn't turn up within
+// MSG_LONG_TIMEOUT; another station's fragments meanwhile go unanswered,
+// so they are sent again later.
+#define MSG_LONG_FRAGMENTS      ((MSG_LONG_LENGTH + MSGLINK_FRAGMENT_DATA - 1) / MSGLINK_FRAGMENT_DATA)
+#define MSG_LONG_TIMEOUT        1500    // 10 ms ticks, past the sender's last retry
+
+_Static_assert(MSG_LONG_FRAGMENTS <= 8, "fragments are tracked in 8 bit masks");
+_Static_assert(MSG_LONG_LENGTH <= 255, "long message offsets are 8 bit");
+
+typedef struct {
+	uint8_t  Tries;         // sends so far, 0 while idle
+	uint8_t  Seq;           // the first fragment's
+	uint8_t  Count;
+	uint8_t  Acked;         // bit i: fragment i
+	uint8_t  Next;          // fragment in msgFSKBuffer while sending
+	uint16_t Timer;
+	int16_t  Line;
+	uint8_t  Length;
+	char     Text[MSG_LONG_LENGTH];
+} MsgLongTx_t;
+
+typedef struct {
+	uint16_t Station;
+	uint8_t  Seq;           // the first fragment's
+	uint8_t  Count;         // 0 while idle
+	uint8_t  Have;          // bit i: fragment i
+	uint8_t  Length;
+	uint16_t Timer;
+	char     Text[MSG_LONG_LENGTH + 1];
+} MsgLongRx_t;
+
+static MsgLongTx_t gMsgLongTx;
+static MsgLongRx_t gMsgLongRx;
+static bool        gMsgLongSending;    // the fragments after Next follow in this key up
+
+static bool longNextFragment(void);
+#endif
+
 // -----------------------------------------------------
 
-void MSG_FSKSendData() {
+// what fskTxStart() changes, put back by fskTxStop()
+static uint16_t msgFskReg59;
+static uint16_t msgSavedCss;
+static uint16_t msgSavedDev;
+static uint16_t msgSavedFilt;
 
-	uint16_t fsk_reg59;
+// sets the modem up for sending and clears its FIFOs; the first packet goes
+// in after they have settled
+static void fskTxStart(void) {
 
 	// REG_51
 	//
 	// <15>  TxCTCSS/CDCSS   0 = disable 1 = Enable
 	//
 	// turn off CTCSS/CDCSS during FFSK
-	const uint16_t css_val = BK4819_ReadRegister(BK4819_REG_51);
+	msgSavedCss = BK4819_ReadRegister(BK4819_REG_51);
 	BK4819_WriteRegister(BK4819_REG_51, 0);
 
 	// set the FM deviation level
-	const uint16_t dev_val = BK4819_ReadRegister(BK4819_REG_40);
-	//UART_printf("\n BANDWIDTH : 0x%.4X", dev_val);
+	msgSavedDev = BK4819_ReadRegister(BK4819_REG_40);
+	//UART_printf("\n BANDWIDTH : 0x%.4X", msgSavedDev);
 	{
 		uint16_t deviation = 850;
 		switch (gEeprom.VfoInfo[gEeprom.TX_VFO].CHANNEL_BANDWIDTH)
@@ -80,7 +220,7 @@ void MSG_FSKSendData() {
 			case BK4819_FILTER_BW_NARROWER: deviation =  750; break;
 		}
 		//BK4819_WriteRegister(0x40, (3u << 12) | (deviation & 0xfff));
-		BK4819_WriteRegister(BK4819_REG_40, (dev_val & 0xf000) | (deviation & 0xfff));
+		BK4819_WriteRegister(BK4819_REG_40, (msgSavedDev & 0xf000) | (deviation & 0xfff));
 	}
 
 	// REG_2B   0
@@ -96,7 +236,7 @@ void MSG_FSKSendData() {
 	//
 	// disable the 300Hz HPF and FM pre-emphasis filter
 	//
-	const uint16_t filt_val = BK4819_ReadRegister(BK4819_REG_2B);
+	msgSavedFilt = BK4819_ReadRegister(BK4819_REG_2B);
 	BK4819_WriteRegister(BK4819_REG_2B, (1u << 2) | (1u << 0));
 
 	// *******************************************
@@ -207,20 +347,20 @@ void MSG_FSKSendData() {
 	//
 	// <2:0> 0 ???
 	//
-	fsk_reg59 = (0u << 15) |   // 0/1     1 = clear TX FIFO
-				(0u << 14) |   // 0/1     1 = clear RX FIFO
-				(0u << 13) |   // 0/1     1 = scramble
-				(0u << 12) |   // 0/1     1 = enable RX
-				(0u << 11) |   // 0/1     1 = enable TX
-				(0u << 10) |   // 0/1     1 = invert data when RX
-				(0u <<  9) |   // 0/1     1 = invert data when TX
-				(0u <<  8) |   // 0/1     ???
-				(15u <<  4) |   // 0 ~ 15  preamble length .. bit toggling
-				(1u <<  3) |   // 0/1     sync length
-				(0u <<  0);    // 0 ~ 7   ???
+	msgFskReg59 = (0u << 15) |   // 0/1     1 = clear TX FIFO
+				  (0u << 14) |   // 0/1     1 = clear RX FIFO
+				  (0u << 13) |   // 0/1     1 = scramble
+				  (0u << 12) |   // 0/1     1 = enable RX
+				  (0u << 11) |   // 0/1     1 = enable TX
+				  (0u << 10) |   // 0/1     1 = invert data when RX
+				  (0u <<  9) |   // 0/1     1 = invert data when TX
+				  (0u <<  8) |   // 0/1     ???
+				  (15u <<  4) |   // 0 ~ 15  preamble length .. bit toggling
+				  (1u <<  3) |   // 0/1     sync length
+				  (0u <<  0);    // 0 ~ 7   ???
 
 	// Set packet length (not including pre-amble and sync bytes that we can't seem to disable)
-	BK4819_WriteRegister(BK4819_REG_5D, ((MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH) << 8));
+	BK4819_WriteRegister(BK4819_REG_5D, (MSG_FSK_PACKET_SIZE << 8));
 
 	// REG_5A
 	//
@@ -254,53 +394,48 @@ void MSG_FSKSendData() {
 //		BK4819_WriteRegister(0x5C, 0xAA30);   // 101010100 0 110000
 //		BK4819_WriteRegister(0x5C, 0x0030);   // 000000000 0 110000
 
-	BK4819_WriteRegister(BK4819_REG_59, (1u << 15) | (1u << 14) | fsk_reg59);   // clear FIFO's
-	BK4819_WriteRegister(BK4819_REG_59, fsk_reg59);
+	BK4819_WriteRegister(BK4819_REG_59, (1u << 15) | (1u << 14) | msgFskReg59);   // clear FIFO's
+	BK4819_WriteRegister(BK4819_REG_59, msgFskReg59);
+}
 
-	SYSTEM_DelayMs(100);
+// loads msgFSKBuffer into the TX FIFO and sends it, FSK_TX_FINISHED comes
+// once it is out
+static void fskTxLoad(bool bNext) {
+	if (bNext) {
+		BK4819_WriteRegister(BK4819_REG_59, (1u << 15) | msgFskReg59);   // clear TX FIFO
+		BK4819_WriteRegister(BK4819_REG_59, msgFskReg59);
+	}
 
 	{	// load the entire packet data into the TX FIFO buffer
 		const uint16_t len_buff = (MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH);
 		for (size_t i = 0, j = 0; i < len_buff; i += 2, j++) {
         	BK4819_WriteRegister(BK4819_REG_5F, (msgFSKBuffer[i + 1] << 8) | msgFSKBuffer[i]);
     	}
-	}
-
-	// enable FSK TX
-	BK4819_WriteRegister(BK4819_REG_59, (1u << 11) | fsk_reg59);
-
-	{
-		// allow up to 310ms for the TX to complete
-		// if it takes any longer then somethings gone wrong, we shut the TX down
-		unsigned int timeout = 1000 / 5;
-
-		while (timeout-- > 0)
-		{
-			SYSTEM_DelayMs(5);
-			if (BK4819_ReadRegister(BK4819_REG_0C) & (1u << 0))
-			{	// we have interrupt flags
-				BK4819_WriteRegister(BK4819_REG_02, 0);
-				if (BK4819_ReadRegister(BK4819_REG_02) & BK4819_REG_02_FSK_TX_FINISHED)
-					timeout = 0;       // TX is complete
-			}
+#ifdef ENABLE_MESSENGER_FEC
+		uint8_t parity[FEC_PARITY_SIZE];
+		FEC_Encode(msgFSKBuffer, sizeof(msgFSKBuffer), parity);
+		for (size_t i = 0; i < FEC_PARITY_SIZE; i += 2) {
+			BK4819_WriteRegister(BK4819_REG_5F, (parity[i + 1] << 8) | parity[i]);
 		}
+#endif
 	}
-	//BK4819_WriteRegister(BK4819_REG_02, 0);
 
-	SYSTEM_DelayMs(100);
+	// enable FSK TX
+	BK4819_WriteRegister(BK4819_REG_59, (1u << 11) | msgFskReg59);
+}
 
+static void fskTxStop(void) {
 	// disable FSK
-	BK4819_WriteRegister(BK4819_REG_59, fsk_reg59);
+	BK4819_WriteRegister(BK4819_REG_59, msgFskReg59);
 
 	// restore FM deviation level
-	BK4819_WriteRegister(BK4819_REG_40, dev_val);
+	BK4819_WriteRegister(BK4819_REG_40, msgSavedDev);
 
 	// restore TX/RX filtering
-	BK4819_WriteRegister(BK4819_REG_2B, filt_val);
+	BK4819_WriteRegister(BK4819_REG_2B, msgSavedFilt);
 
 	// restore the CTCSS/CDCSS setting
-	BK4819_WriteRegister(BK4819_REG_51, css_val);
-
+	BK4819_WriteRegister(BK4819_REG_51, msgSavedCss);
 }
 
 void MSG_EnableRX(const bool enable) {
@@ -497,11 +632,11 @@ void MSG_EnableRX(const bool enable) {
 		// BK4819_WriteRegister(BK4819_REG_5C, 0xAA30);   // 10101010 0 0 110000
 
 		// set the almost full threshold
-		BK4819_WriteRegister(BK4819_REG_5E, (64u << 3) | (1u << 0));  // 0 ~ 127, 0 ~ 7
+		BK4819_WriteRegister(BK4819_REG_5E, (64u << 3) | (MSG_FSK_FIFO_THRESHOLD << 0));  // 0 ~ 127, 0 ~ 7
 
 		{	// packet size .. sync + 14 bytes - size of a single packet
 
-			uint16_t size = (MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH);
+			uint16_t size = MSG_FSK_PACKET_SIZE;
 			// size -= (fsk_reg59 & (1u << 3)) ? 4 : 2;
 			size = (((size + 1) / 2) * 2) + 2;             // round up to even, else FSK RX doesn't work
 			BK4819_WriteRegister(BK4819_REG_5D, (size << 8));
@@ -522,138 +657,1138 @@ void MSG_EnableRX(const bool enable) {
 
 // -----------------------------------------------------
 
-static void moveUP(char (*rxMessages)[MAX_RX_MSG_LENGTH + 2]) {
-    // Shift existing lines up
-	for (size_t i = 0; i + 1 < MAX_LINES; ++i) {
-		strncpy(rxMessages[i], rxMessages[i + 1], sizeof(rxMessages[i]) - 1);
-		rxMessages[i][sizeof(rxMessages[i]) - 1] = '\0';
+// The screen lines are a ring: rxMessage[gMsgViewTop] holds the newest one
+// shown and the rows after it, wrapping round, the older ones from the top
+// of the screen down, so a new line takes one row instead of moving every
+// line up. Lines are numbered as they come, with the log by its sequence
+// numbers, and scrolling back reads in only the line coming into view.
+enum {
+	LINE_RECEIVED = 0,
+	LINE_SENT,
+	LINE_MORE,          // the rest of a wrapped message
+	LINE_UNKNOWN,
+};
+
+static const char linePrefix[] = "<> ?";
+
+static char    rxMessage[MAX_LINES][MAX_RX_MSG_LENGTH + 2];
+static uint8_t gMsgViewTop;
+static uint8_t gMsgLineNext;        // number of the next line
+#ifdef ENABLE_MESSENGER_LOG
+static uint8_t gMsgViewBack;        // lines scrolled back from the newest
+static bool    gMsgViewLoaded;
+#endif
+
+static void renderLine(char *pRow, uint8_t kind, const char *pText, size_t length) {
+	snprintf(pRow, sizeof(rxMessage[0]), "%c %.*s", linePrefix[kind], (int)length, pText);
+}
+
+#ifdef ENABLE_MESSENGER_LOG
+static void viewRow(uint8_t row, uint8_t back) {
+	MSGLOG_Entry_t entry;
+
+	if (!MSGLOG_Read(back, &entry)) {
+		rxMessage[row][0] = '\0';
+		return;
 	}
 
-    // Insert the new line at the last position
-	memset(rxMessages[MAX_LINES - 1], 0, sizeof(rxMessages[MAX_LINES - 1]));
+	renderLine(rxMessage[row], entry.Kind, entry.Text, strlen(entry.Text));
+	if (entry.Mark != 0) {
+		const size_t len = strlen(rxMessage[row]);
+		rxMessage[row][len] = " +!"[entry.Mark];
+		rxMessage[row][len + 1] = '\0';
+	}
+}
+
+// the newest lines from the log, on first use or back from a scroll the
+// log has moved on from
+static void viewLoad(void) {
+	MSGLOG_Entry_t entry;
+
+	if (gMsgViewLoaded) {
+		return;
+	}
+
+	gMsgViewLoaded = true;
+	gMsgViewBack   = 0;
+	gMsgLineNext   = MSGLOG_Read(0, &entry) ? entry.Seq + 1 : 0;
+	for (uint8_t i = 0; i < MAX_LINES; i++) {
+		viewRow((gMsgViewTop + MAX_LINES - i) % MAX_LINES, i);
+	}
+}
+
+static void viewScroll(bool bOlder) {
+	viewLoad();
+
+	if (bOlder) {
+		if (gMsgViewBack + MAX_LINES >= MSGLOG_Count()) {
+			AUDIO_PlayBeep(BEEP_500HZ_60MS_DOUBLE_BEEP_OPTIONAL);
+			return;
+		}
+		gMsgViewBack++;
+		gMsgViewTop = (gMsgViewTop + MAX_LINES - 1) % MAX_LINES;
+		viewRow((gMsgViewTop + 1) % MAX_LINES, gMsgViewBack + MAX_LINES - 1);
+	} else {
+		gMsgViewBack--;
+		gMsgViewTop = (gMsgViewTop + 1) % MAX_LINES;
+		viewRow(gMsgViewTop, gMsgViewBack);
+	}
+	gUpdateDisplay = true;
+}
+#endif
+
+static void addLine(uint8_t kind, const char *pText, size_t length) {
+#ifdef ENABLE_MESSENGER_LOG
+	viewLoad();
+	gMsgLineNext = MSGLOG_Append(kind, pText, length) + 1;
+	if (gMsgViewBack != 0) {
+		// keep the lines being read where they are, until the log ring
+		// has gone past them: then back to the newest, read in afresh
+		if (++gMsgViewBack >= MSGLOG_SLOTS) {
+			gMsgViewBack   = 0;
+			gMsgViewLoaded = false;
+		}
+		return;
+	}
+#else
+	gMsgLineNext++;
+#endif
+	gMsgViewTop = (gMsgViewTop + 1) % MAX_LINES;
+	renderLine(rxMessage[gMsgViewTop], kind, pText, length);
 }
 
-void MSG_Send(const char *txMessage, bool bServiceMessage) {
+#ifdef ENABLE_MESSENGER_DELIVERY_NOTIFICATION
+// appends a delivery mark to a line, in the log as well
+static void markLine(int16_t line, char mark) {
+	if (line < 0) {
+		return;
+	}
 
-	if ( msgStatus != READY ) {
+#ifdef ENABLE_MESSENGER_LOG
+	viewLoad();
+	MSGLOG_Mark(line, (mark == '+') ? 1 : 2);
+	const uint8_t back = gMsgLineNext - 1 - gMsgViewBack - line;
+#else
+	const uint8_t back = gMsgLineNext - 1 - line;
+#endif
+	if (back >= MAX_LINES) {
 		return;
 	}
 
+	char *pRow = rxMessage[(gMsgViewTop + MAX_LINES - back) % MAX_LINES];
+	const size_t len = strlen(pRow);
+	if (len < sizeof(rxMessage[0]) - 1) {
+		pRow[len] = mark;
+		pRow[len + 1] = '\0';
+	}
+	gUpdateDisplay = true;
+}
+#endif
+
+const char *MSG_GetLine(uint8_t row) {
+#ifdef ENABLE_MESSENGER_LOG
+	viewLoad();
+#endif
+	return rxMessage[(gMsgViewTop + 1 + row) % MAX_LINES];
+}
+
+uint8_t MSG_GetScrollBack(void) {
+#ifdef ENABLE_MESSENGER_LOG
+	return gMsgViewBack;
+#else
+	return 0;
+#endif
+}
+
+// Sending never waits in a delay. MSG_Send() puts the message in a queue
+// and the 10 ms slice keys up once the channel has been quiet for a while:
+// MSG_TX_HOLDOFF plus a random backoff, drawn again every time the channel
+// gets busy so stations waiting on the same carrier don't key up together,
+// and longer than the link's reply delay so the ACKs for what was just
+// sent get in first. ACKs and NACKs need a shorter gap, also drawn again on
+// every busy channel, in MSG_TX_REPLY_SLOT steps so that stations queued
+// behind the same carrier don't reply into each other when it drops. Each
+// key up sends whatever is due, back to back, up to MSG_TX_BURST packets;
+// the steps the blocking version waited through are timers of the slice.
+#define MSG_TX_QUEUE_SIZE       256     // bytes
+#define MSG_TX_BURST            8       // packets per key up
+#define MSG_TX_STEP             10      // 10 ms ticks, PA up, modem settling and tail
+#define MSG_TX_TIMEOUT          100     // for FSK_TX_FINISHED
+#define MSG_TX_HOLDOFF          60
+#define MSG_TX_REPLY_GAP        2
+#define MSG_TX_REPLY_SLOT       5       // time for a carrier keyed up a slot earlier to open the squelch
+#define MSG_TX_REPLY_SLOTS      6
+#define MSG_RX_TIMEOUT          100     // a packet that stopped coming in
+
+#ifdef ENABLE_MESSENGER_LINK
+// the reply delay runs from the end of the packet, the sender's backoff
+// only once it has sent its tail and unkeyed
+_Static_assert(MSG_LINK_REPLY_DELAY + MSG_TX_REPLY_SLOT * (MSG_TX_REPLY_SLOTS - 1) <= 2 * MSG_TX_STEP + MSG_TX_HOLDOFF,
+               "replies must be due before the sender's backoff ends");
+#endif
+
+typedef enum {
+	TX_IDLE = 0,
+	TX_KEYED,           // PA coming up
+	TX_SETUP,           // modem set up, FIFOs settling
+	TX_SENDING,         // a packet going out
+	TX_TAIL,            // carrier held after the last one
+	TX_UNKEY,           // modem back to receive
+} MsgTxState_t;
+
+static MsgTxState_t gMsgTxState;
+static uint8_t      gMsgTxTimer;
+static uint8_t      gMsgTxPackets;      // this key up
+static bool         gMsgTxFinished;     // FSK_TX_FINISHED came
+static uint8_t      gMsgTxClear;        // ticks the channel has been quiet
+static uint8_t      gMsgTxBackoff = MSG_TX_HOLDOFF;
+#ifdef ENABLE_MESSENGER_LINK
+static uint8_t      gMsgTxReplyGap = MSG_TX_REPLY_GAP;
+#endif
+static uint8_t      gMsgRxTicks;
+static uint16_t     gMsgRandom;
+
+// xorshift, seeded from RF noise
+static uint16_t msgRandom(void) {
+	if (gMsgRandom == 0) {
+		gMsgRandom = BK4819_ReadRegister(BK4819_REG_67) ^ (BK4819_ReadRegister(BK4819_REG_65) << 9);
+		if (gMsgRandom == 0) {
+			gMsgRandom = 1;
+		}
+	}
+
+	gMsgRandom ^= gMsgRandom << 7;
+	gMsgRandom ^= gMsgRandom >> 9;
+	gMsgRandom ^= gMsgRandom << 8;
+	return gMsgRandom;
+}
+
+#ifdef ENABLE_MESSENGER_LINK
+// 0 .. (MSG_TX_REPLY_SLOTS - 1) slots
+static uint8_t replySlot(void) {
+	return MSG_TX_REPLY_SLOT * (msgRandom() % MSG_TX_REPLY_SLOTS);
+}
+#endif
+
+// the quiet time to wait before keying up, again for every busy channel
+static void txDrawBackoff(void) {
+	gMsgTxBackoff = MSG_TX_HOLDOFF + (msgRandom() & 63);
+#ifdef ENABLE_MESSENGER_LINK
+	gMsgTxReplyGap = MSG_TX_REPLY_GAP + replySlot();
+#endif
+}
+
+static bool channelBusy(void) {
+	return msgStatus == RECEIVING || gCurrentFunction == FUNCTION_TRANSMIT || gCurrentFunction == FUNCTION_MONITOR ||
+	       gCurrentFunction == FUNCTION_INCOMING || gCurrentFunction == FUNCTION_RECEIVE;
+}
+
+static void txKeyUp(void) {
+	msgStatus = SENDING;
+
+	RADIO_SetVfoState(VFO_STATE_NORMAL);
+	BK4819_ToggleGpioOut(BK4819_GPIO5_PIN1_RED, true);
+
+	BK4819_DisableDTMF();
+
+	FUNCTION_Select(FUNCTION_TRANSMIT);
+
+	gMsgTxPackets = 0;
+	gMsgTxState   = TX_KEYED;
+	gMsgTxTimer   = MSG_TX_STEP;
+}
+
+// bEnd false when the transmission was ended for us, the TX timeout
+static void txUnkey(bool bEnd) {
+	if (bEnd) {
+		APP_EndTransmission();
+		if (gEeprom.REPEATER_TAIL_TONE_ELIMINATION == 0) {
+			FUNCTION_Select(FUNCTION_FOREGROUND);
+		} else {
+			gRTTECountdown_10ms = gEeprom.REPEATER_TAIL_TONE_ELIMINATION * 10;
+		}
+		gFlagEndTransmission = false;
+	}
+	RADIO_SetVfoState(VFO_STATE_NORMAL);
+
+	BK4819_ToggleGpioOut(BK4819_GPIO5_PIN1_RED, false);
+
+	MSG_EnableRX(true);
+
+#ifdef ENABLE_MESSENGER_LONG
+	// what didn't fit in the burst goes with the retry
+	gMsgLongSending = false;
+#endif
+	msgStatus     = READY;
+	gMsgTxState   = TX_IDLE;
+	gMsgTxClear   = 0;
+	txDrawBackoff();
+}
+
+bool MSG_IsTransmitting(void) {
+	return gMsgTxState != TX_IDLE;
+}
+
+#ifdef ENABLE_MESSENGER_LINK
+// 16 bits from the station name, or from RF noise without one
+static uint16_t linkStation(void) {
+	if (gMsgStation != 0) {
+		return gMsgStation;
+	}
+
+	uint8_t id[16];
+	EEPROM_ReadBuffer(0x0EB0, id, sizeof(id));
+	const uint16_t noise = BK4819_ReadRegister(BK4819_REG_67) ^ (BK4819_ReadRegister(BK4819_REG_65) << 9);
+	if (id[0] == 0xFF || id[0] == 0) {
+		id[0] = noise & 0xFF;
+		id[1] = noise >> 8;
+		id[2] = BK4819_ReadRegister(BK4819_REG_63) & 0xFF;
+	}
+
+	gMsgStation = CRC_Calculate(id, sizeof(id));
+	if (gMsgStation == 0 || gMsgStation == MSGLINK_BROADCAST) {
+		gMsgStation = 1;
+	}
+
+	// start where a receiver's window from before a reboot won't match
+	gMsgSeq = noise & 0xFF;
+	gMsgRandom = gMsgStation ^ noise;
+	if (gMsgRandom == 0) {
+		gMsgRandom = 1;
+	}
+
+	return gMsgStation;
+}
+
+// 0 .. 63
+static uint8_t linkJitter(void) {
+	return msgRandom() & 63;
+}
+
+static void linkReply(uint8_t type, uint16_t dst, uint8_t seq, uint8_t seen) {
+	gMsgReply.Timer = MSG_LINK_REPLY_DELAY + replySlot();
+	gMsgReply.Type  = type;
+	gMsgReply.Seq   = seq;
+	gMsgReply.Seen  = seen;
+	gMsgReply.Dst   = dst;
+}
+
+static void linkBuildReply(void) {
+	const MSGLINK_Frame_t frame = {
+		.Type     = gMsgReply.Type,
+		.Seq      = gMsgReply.Seq,
+		.Src      = linkStation(),
+		.Dst      = gMsgReply.Dst,
+		.Length   = (gMsgReply.Type == MSGLINK_ACK) ? 1 : 0,
+		.pPayload = &gMsgReply.Seen,
+	};
+
+	gMsgReply.Timer = 0;
+	MSGLINK_Build(msgFSKBuffer, &frame);
+}
+
+static void linkBuildData(MsgPending_t *pSlot) {
+	const MSGLINK_Frame_t frame = {
+		.Type     = MSGLINK_DATA,
+		.Seq      = pSlot->Seq,
+		.Src      = linkStation(),
+		.Dst      = MSGLINK_BROADCAST,
+		.Length   = pSlot->Length,
+		.pPayload = pSlot->Payload,
+	};
+
+	gMsgLinkStats.Sent++;
+	if (pSlot->Tries > 0) {
+		gMsgLinkStats.Retries++;
+	}
+	pSlot->Tries++;
+	pSlot->Timer = MSG_LINK_ACK_TIMEOUT + (pSlot->Tries - 1) * MSG_LINK_BACKOFF + linkJitter();
+
+	MSGLINK_Build(msgFSKBuffer, &frame);
+}
+
+static void linkDelivered(int16_t line) {
+	gMsgLinkStats.Delivered++;
+#ifdef ENABLE_MESSENGER_DELIVERY_NOTIFICATION
+	UART_printf("SVC<RCPT\n");
+	markLine(line, '+');
+	gUpdateStatus = true;
+#else
+	(void)line;
+#endif
+}
+
+static void linkFailed(int16_t line) {
+	gMsgLinkStats.Failed++;
+#ifdef ENABLE_MESSENGER_DELIVERY_NOTIFICATION
+	UART_printf("SVC<FAIL\n");
+	markLine(line, '!');
+#else
+	(void)line;
+#endif
+}
+
+// whether an ACK of top / seen takes in seq
+static bool linkCovers(uint8_t top, uint8_t seen, uint8_t seq) {
+	const uint8_t behind = top - seq;
+
+	return behind == 0 || (behind <= 8 && (seen & (1u << (behind - 1))));
+}
+
+static void linkAcked(uint8_t top, uint8_t seen) {
+	for (size_t i = 0; i < MSG_LINK_SLOTS; ++i) {
+		MsgPending_t *pSlot = &gMsgPending[i];
+
+		if (pSlot->Tries != 0 && linkCovers(top, seen, pSlot->Seq)) {
+			linkDelivered(pSlot->Line);
+			pSlot->Tries = 0;
+		}
+	}
+
+#ifdef ENABLE_MESSENGER_LONG
+	if (gMsgLongTx.Tries != 0) {
+		const uint8_t acked = gMsgLongTx.Acked;
+
+		for (uint8_t i = 0; i < gMsgLongTx.Count; i++) {
+			if (linkCovers(top, seen, gMsgLongTx.Seq + i)) {
+				gMsgLongTx.Acked |= 1u << i;
+			}
+		}
+		if (gMsgLongTx.Acked != acked) {
+			// it is getting through, the retries start over
+			gMsgLongTx.Tries = 1;
+		}
+		if (gMsgLongTx.Acked == (1u << gMsgLongTx.Count) - 1) {
+			linkDelivered(gMsgLongTx.Line);
+			gMsgLongTx.Tries = 0;
+		} else if (gMsgLongTx.Timer > MSG_LINK_NACK_DELAY) {
+			// the ACK comes after the whole burst, what it misses was lost
+			gMsgLongTx.Timer = MSG_LINK_NACK_DELAY + (linkJitter() >> 2);
+		}
+	}
+#endif
+}
+
+static void linkNacked(uint8_t seq) {
+	for (size_t i = 0; i < MSG_LINK_SLOTS; ++i) {
+		MsgPending_t *pSlot = &gMsgPending[i];
+
+		if (pSlot->Tries != 0 && pSlot->Seq == seq && pSlot->Timer > MSG_LINK_NACK_DELAY) {
+			pSlot->Timer = MSG_LINK_NACK_DELAY + (linkJitter() >> 2);
+		}
+	}
+
+#ifdef ENABLE_MESSENGER_LONG
+	if (gMsgLongTx.Tries != 0 && (uint8_t)(seq - gMsgLongTx.Seq) < gMsgLongTx.Count &&
+	    gMsgLongTx.Timer > MSG_LINK_NACK_DELAY) {
+		gMsgLongTx.Timer = MSG_LINK_NACK_DELAY + (linkJitter() >> 2);
+	}
+#endif
+}
+
+static MsgPeer_t *linkPeer(uint16_t station, uint8_t seq) {
+	MsgPeer_t *pPeer;
+
+	for (size_t i = 0; i < gMsgPeerCount; ++i) {
+		if (gMsgPeers[i].Station == station) {
+			return &gMsgPeers[i];
+		}
+	}
+
+	// new station, or one that takes over the oldest entry
+	if (gMsgPeerCount < MSG_LINK_PEERS) {
+		pPeer = &gMsgPeers[gMsgPeerCount++];
+	} else {
+		pPeer = &gMsgPeers[gMsgPeerNext];
+		gMsgPeerNext = (gMsgPeerNext + 1) % MSG_LINK_PEERS;
+	}
+	pPeer->Station = station;
+	pPeer->Top     = seq - 1;
+	pPeer->Seen    = 0;
+	return pPeer;
+}
+
+// false for a sequence number already taken
+static bool linkTake(MsgPeer_t *pPeer, uint8_t seq) {
+	const int8_t ahead = (int8_t)(seq - pPeer->Top);
+
+	if (ahead > 0) {
+		pPeer->Seen = (ahead > 8) ? 0 : (uint8_t)(((pPeer->Seen << 1) | 1u) << (ahead - 1));
+		pPeer->Top  = seq;
+		return true;
+	}
+	if (ahead == 0) {
+		return false;
+	}
+	if (ahead >= -8) {
+		const uint8_t bit = 1u << (-ahead - 1);
+		if (pPeer->Seen & bit) {
+			return false;
+		}
+		pPeer->Seen |= bit;
+		return true;
+	}
+
+	// far behind, the station has restarted
+	pPeer->Top  = seq;
+	pPeer->Seen = 0;
+	return true;
+}
+#endif
+
+#ifdef ENABLE_MESSENGER_LONG
+// builds the first fragment from index on that isn't ACKed yet
+static bool longBuild(uint8_t index) {
+	uint8_t payload[MSGLINK_MAX_PAYLOAD];
+
+	while (index < gMsgLongTx.Count && (gMsgLongTx.Acked & (1u << index))) {
+		index++;
+	}
+	if (index >= gMsgLongTx.Count) {
+		return false;
+	}
+
+	const uint8_t offset = index * MSGLINK_FRAGMENT_DATA;
+	const uint8_t size   = (gMsgLongTx.Length - offset < MSGLINK_FRAGMENT_DATA) ? gMsgLongTx.Length - offset : MSGLINK_FRAGMENT_DATA;
+	const MSGLINK_Frame_t frame = {
+		.Type     = MSGLINK_FRAGMENT,
+		.Seq      = gMsgLongTx.Seq + index,
+		.Src      = linkStation(),
+		.Dst      = MSGLINK_BROADCAST,
+		.Length   = size + 1,
+		.pPayload = payload,
+	};
+
+	payload[0] = (index << 4) | (gMsgLongTx.Count - 1);
+	memcpy(payload + 1, gMsgLongTx.Text + offset, size);
+
+	gMsgLinkStats.Sent++;
+	if (gMsgLongTx.Tries > 1) {
+		gMsgLinkStats.Retries++;
+	}
+	gMsgLongTx.Next = index;
+	MSGLINK_Build(msgFSKBuffer, &frame);
+	return true;
+}
+
+static bool longNextFragment(void) {
+	return longBuild(gMsgLongTx.Next + 1);
+}
+
+// the first fragment not ACKed yet, the rest follow it
+static bool longBurst(void) {
+	gMsgLongTx.Tries++;
+	gMsgLongTx.Timer = MSG_LINK_ACK_TIMEOUT + (gMsgLongTx.Tries - 1) * MSG_LINK_BACKOFF + linkJitter();
+
+	gMsgLongSending = longBuild(0);
+	return gMsgLongSending;
+}
+
+// gMsgLongTx.Text holds the message, station ID in front
+static void longStart(uint8_t length, int16_t line) {
+	linkStation();      // also seeds gMsgSeq
+	gMsgLongTx.Length = length;
+	gMsgLongTx.Count  = (gMsgLongTx.Length + MSGLINK_FRAGMENT_DATA - 1) / MSGLINK_FRAGMENT_DATA;
+	gMsgLongTx.Seq    = gMsgSeq;
+	gMsgLongTx.Acked  = 0;
+	gMsgLongTx.Tries  = 0;
+	gMsgLongTx.Line   = line;
+	gMsgSeq += gMsgLongTx.Count;
+}
+#endif
+
+// the station name from the settings, trailing spaces cut; pId gets 17 bytes
+static size_t stationId(char *pId) {
+	size_t id_len = 0;
+
+	EEPROM_ReadBuffer(0x0EB0, pId, 16);
+	pId[16] = '\0';
+
+	while (id_len < 16 && pId[id_len] != '\0' && (uint8_t)pId[id_len] != 0xFF) {
+		id_len++;
+	}
+	while (id_len > 0 && pId[id_len - 1] == ' ') {
+		id_len--;
+	}
+	return id_len;
+}
+
+// Queue entries are a header, then the payload as it goes on air:
+//
+//   0        MSG_TX_SERVICE / MSG_TX_LONG / MSG_TX_LINE
+//   1        number of the line showing it, with MSG_TX_LINE
+//   2        payload length
+//   3...     payload, station ID in front
+//
+// The indexes are 8 bit and go round the 256 bytes by themselves.
+enum {
+	MSG_TX_SERVICE = 1u << 0,
+	MSG_TX_LONG    = 1u << 1,
+	MSG_TX_LINE    = 1u << 2,
+};
+
+_Static_assert(MSG_TX_QUEUE_SIZE == 256, "queue indexes wrap as uint8_t");
+
+static uint8_t  gMsgTxQueue[MSG_TX_QUEUE_SIZE];
+static uint8_t  gMsgTxQueueHead;
+static uint16_t gMsgTxQueueUsed;
+
+static uint8_t queuePeek(uint8_t offset) {
+	return gMsgTxQueue[(uint8_t)(gMsgTxQueueHead + offset)];
+}
+
+static void queuePut(uint8_t byte) {
+	gMsgTxQueue[(uint8_t)(gMsgTxQueueHead + gMsgTxQueueUsed)] = byte;
+	gMsgTxQueueUsed++;
+}
+
+// copies out the payload of the oldest entry and drops it
+static void queueTake(void *pDst, uint8_t length) {
+	uint8_t *pOut = pDst;
+
+	for (uint8_t i = 0; i < length; i++) {
+		pOut[i] = queuePeek(3 + i);
+	}
+	gMsgTxQueueHead += 3 + length;
+	gMsgTxQueueUsed -= 3 + length;
+}
+
+bool MSG_Send(const char *txMessage, bool bServiceMessage) {
+
+	char station_id[17] = {0};
+	const size_t id_len = bServiceMessage ? 0 : stationId(station_id);
+	const size_t id_part = id_len ? id_len + 1 : 0;     // and a '#'
 	const size_t user_len = strnlen(txMessage, TX_MSG_LENGTH);
-	if ( user_len > 0 && (TX_freq_check(gCurrentVfo->pTX->Frequency) == 0) ) {
-		char prefixed[TX_MSG_LENGTH] = {0};
-		const char *payload = txMessage;
+	size_t max_len = bServiceMessage ? TX_MSG_LENGTH : TX_MSG_LENGTH - 1;
+	uint8_t flags = bServiceMessage ? MSG_TX_SERVICE : MSG_TX_LINE;
+
+#ifdef ENABLE_MESSENGER_LONG
+	// with the station ID in front it takes more than one frame
+	const size_t text_len = bServiceMessage ? user_len : strnlen(txMessage, MSG_LONG_LENGTH);
+	const bool bLong = id_part + text_len > max_len;
+	if (bLong) {
+		flags  |= MSG_TX_LONG;
+		max_len = MSG_LONG_LENGTH;
+	}
+#else
+	const size_t text_len = user_len;
+#endif
+
+	const size_t length = id_part + ((text_len < max_len - id_part) ? text_len : max_len - id_part);
 
+	if (user_len == 0 || TX_freq_check(gCurrentVfo->pTX->Frequency) != 0 ||
+	    3 + length > MSG_TX_QUEUE_SIZE - (size_t)gMsgTxQueueUsed) {
 		if (!bServiceMessage) {
-			char station_id[17] = {0};
-			EEPROM_ReadBuffer(0x0EB0, station_id, 16);
-			station_id[16] = '\0';
+			AUDIO_PlayBeep(BEEP_500HZ_60MS_DOUBLE_BEEP_OPTIONAL);
+		}
+		return false;
+	}
 
-			size_t id_len = 0;
-			while (id_len < 16 && station_id[id_len] != '\0' && (uint8_t)station_id[id_len] != 0xFF) {
-				id_len++;
-			}
-			while (id_len > 0 && station_id[id_len - 1] == ' ') {
-				id_len--;
-			}
+	if (!bServiceMessage) {
+		// shown straight away, a delivery mark follows
+		addLine(LINE_SENT, txMessage, user_len);
+#ifdef ENABLE_MESSENGER_LONG
+		// the rest wrapped, as it is shown on the other side
+		for (size_t i = user_len; bLong && i < text_len; i += MAX_MSG_LENGTH) {
+			addLine(LINE_MORE, txMessage + i, strnlen(txMessage + i, MAX_MSG_LENGTH));
+		}
+#endif
+	}
 
-			if (id_len > 0) {
-				size_t pos = 0;
-				const size_t max_len = TX_MSG_LENGTH - 1;
-				const size_t copy_id = (id_len < max_len) ? id_len : max_len;
-				memcpy(prefixed, station_id, copy_id);
-				pos = copy_id;
-				if (pos < max_len) {
-					prefixed[pos++] = '#';
-				}
-				if (pos < max_len) {
-					const size_t copy_msg = (user_len < (max_len - pos)) ? user_len : (max_len - pos);
-					memcpy(prefixed + pos, txMessage, copy_msg);
-				}
-				payload = prefixed;
-			}
+	queuePut(flags);
+	queuePut((uint8_t)(gMsgLineNext - 1));
+	queuePut((uint8_t)length);
+	for (size_t i = 0; i < length; i++) {
+		queuePut((i < id_len) ? station_id[i] : (i < id_part) ? '#' : txMessage[i - id_part]);
+	}
+
+	if (!bServiceMessage) {
+		memset(lastcMessage, 0, sizeof(lastcMessage));
+		memcpy(lastcMessage, txMessage, user_len);
+		cIndex = 0;
+		prevKey = 0;
+		prevLetter = 0;
+		memset(cMessage, 0, sizeof(cMessage));
+		if (gScreenToDisplay == DISPLAY_MSG) {
+			gUpdateDisplay = true;
 		}
+	}
 
-		const size_t msg_len = strnlen(payload, TX_MSG_LENGTH);
+	return true;
+}
 
-		msgStatus = SENDING;
+// the oldest queued message into msgFSKBuffer, once there is a slot for it
+static bool queueDispatch(bool bBuild) {
+	if (gMsgTxQueueUsed == 0) {
+		return false;
+	}
 
-		RADIO_SetVfoState(VFO_STATE_NORMAL);
-		BK4819_ToggleGpioOut(BK4819_GPIO5_PIN1_RED, true);
+	const uint8_t flags  = queuePeek(0);
+	const uint8_t length = queuePeek(2);
+#ifdef ENABLE_MESSENGER_LINK
+	const int16_t line   = (flags & MSG_TX_LINE) ? queuePeek(1) : -1;
+#endif
+
+#ifdef ENABLE_MESSENGER_LONG
+	if (flags & MSG_TX_LONG) {
+		if (gMsgLongTx.Tries != 0) {
+			// the last one is still on its way
+			return false;
+		}
+		if (bBuild) {
+			queueTake(gMsgLongTx.Text, length);
+			longStart(length, line);
+			longBurst();
+		}
+		return true;
+	}
+#endif
+
+#ifdef ENABLE_MESSENGER_LINK
+	if (!(flags & MSG_TX_SERVICE)) {
+		MsgPending_t *pSlot = NULL;
+
+		for (size_t i = 0; i < MSG_LINK_SLOTS; ++i) {
+			if (gMsgPending[i].Tries == 0) {
+				pSlot = &gMsgPending[i];
+				break;
+			}
+		}
+		if (pSlot == NULL) {
+			// every slot waits for an ACK
+			return false;
+		}
+		if (bBuild) {
+			linkStation();      // also seeds gMsgSeq
+			pSlot->Seq    = gMsgSeq++;
+			pSlot->Length = length;
+			pSlot->Line   = line;
+			queueTake(pSlot->Payload, length);
+			linkBuildData(pSlot);
+		}
+		return true;
+	}
+#endif
 
+	if (bBuild) {
 		memset(msgFSKBuffer, 0, sizeof(msgFSKBuffer));
 
-		// ? ToDo
 		// first 20 byte sync, msg type and ID
 		msgFSKBuffer[0] = 'M';
 		msgFSKBuffer[1] = 'S';
 
 		// next 20 for msg
-		memcpy(msgFSKBuffer + 2, payload, msg_len);
-
-		// CRC ? ToDo
+		queueTake(msgFSKBuffer + 2, length);
 
 		msgFSKBuffer[MAX_RX_MSG_LENGTH - 1] = '\0';
 		msgFSKBuffer[MAX_RX_MSG_LENGTH + 0] = 'I';
 		msgFSKBuffer[MAX_RX_MSG_LENGTH + 1] = 'D';
 		msgFSKBuffer[MAX_RX_MSG_LENGTH + 2] = '0';
 		msgFSKBuffer[(MSG_HEADER_LENGTH + MAX_RX_MSG_LENGTH) - 1] = '#';
+	}
+	return true;
+}
 
-		BK4819_DisableDTMF();
+// Builds the next packet due into msgFSKBuffer, most urgent first: an ACK
+// or NACK, the fragments of a long message, retries, then the oldest queued
+// message. With bBuild false it only tells whether there is one.
+static bool txNext(bool bBuild) {
+#ifdef ENABLE_MESSENGER_LINK
+	if (gMsgReply.Timer == 1) {
+		if (bBuild) {
+			linkBuildReply();
+		}
+		return true;
+	}
+#endif
 
-		//RADIO_SetTxParameters();
-		FUNCTION_Select(FUNCTION_TRANSMIT);
-		//SYSTEM_DelayMs(500);
-		//BK4819_PlayRogerNormal(98);
-		SYSTEM_DelayMs(100);
+#ifdef ENABLE_MESSENGER_LONG
+	if (bBuild && gMsgLongSending) {
+		if (longNextFragment()) {
+			return true;
+		}
+		gMsgLongSending = false;
+	}
+	if (gMsgLongTx.Tries != 0 && gMsgLongTx.Timer == 0 && gMsgLongTx.Tries <= MSG_LINK_RETRIES) {
+		return !bBuild || longBurst();
+	}
+#endif
 
-		//BK4819_ExitTxMute();
-		
-		MSG_FSKSendData();
+#ifdef ENABLE_MESSENGER_LINK
+	for (size_t i = 0; i < MSG_LINK_SLOTS; ++i) {
+		MsgPending_t *pSlot = &gMsgPending[i];
 
-		SYSTEM_DelayMs(100);
+		if (pSlot->Tries != 0 && pSlot->Timer == 0 && pSlot->Tries <= MSG_LINK_RETRIES) {
+			if (bBuild) {
+				linkBuildData(pSlot);
+			}
+			return true;
+		}
+	}
+#endif
 
-		//APP_EndTransmission(true);
-		APP_EndTransmission();
-		if (gEeprom.REPEATER_TAIL_TONE_ELIMINATION == 0) {
-			FUNCTION_Select(FUNCTION_FOREGROUND);
-		} else {
-			gRTTECountdown_10ms = gEeprom.REPEATER_TAIL_TONE_ELIMINATION * 10;
+	return queueDispatch(bBuild);
+}
+
+static uint8_t validate_char(uint8_t rchar) {
+	if ( (rchar == 0x1b) || (rchar >= 32 && rchar <= 127) ) {
+		return rchar;
+	}
+	return 32;
+}
+
+static void notifyReceived(void) {
+	if ( gScreenToDisplay != DISPLAY_MSG ) {
+		hasNewMessage = 1;
+		gUpdateStatus = true;
+		gUpdateDisplay = true;
+#ifdef ENABLE_MESSENGER_NOTIFICATION
+		gPlayMSGRing = true;
+#endif
+	}
+	else {
+		gUpdateDisplay = true;
+	}
+}
+
+#ifdef ENABLE_MESSENGER_LONG
+static void longDeliver(void) {
+	MsgLongRx_t *pRx = &gMsgLongRx;
+
+	for (uint8_t i = 0; i < pRx->Length; i++) {
+		pRx->Text[i] = validate_char(pRx->Text[i]);
+	}
+	pRx->Text[pRx->Length] = '\0';
+
+	gMsgLinkStats.Received++;
+#ifdef ENABLE_MESSENGER_UART
+	UART_printf("SMS< %s\n", pRx->Text);
+#endif
+
+	// wrapped, the start scrolls off if it takes more than MAX_LINES
+	for (uint8_t i = 0; i < pRx->Length; i += MAX_MSG_LENGTH) {
+		addLine(i ? LINE_MORE : LINE_RECEIVED, pRx->Text + i, strnlen(pRx->Text + i, MAX_MSG_LENGTH));
+	}
+	notifyReceived();
+
+	pRx->Count = 0;
+}
+
+static void longReceive(const MSGLINK_Frame_t *pFrame) {
+	MsgLongRx_t  *pRx   = &gMsgLongRx;
+	const uint8_t index = pFrame->pPayload[0] >> 4;
+	const uint8_t count = (pFrame->pPayload[0] & 15) + 1;
+	const uint8_t size  = pFrame->Length - 1;
+
+	if (pFrame->Length == 0 || index >= count || count > MSG_LONG_FRAGMENTS || size > MSGLINK_FRAGMENT_DATA ||
+	    (index + 1 < count && size != MSGLINK_FRAGMENT_DATA)) {
+		gMsgLinkStats.BadFrames++;
+		return;
+	}
+	if (pRx->Count != 0 && pRx->Station != pFrame->Src) {
+		return;
+	}
+
+	MsgPeer_t *pPeer = linkPeer(pFrame->Src, pFrame->Seq);
+
+	if (linkTake(pPeer, pFrame->Seq)) {
+		const uint8_t first = pFrame->Seq - index;
+
+		if (pRx->Count != 0 && (pRx->Seq != first || pRx->Count != count)) {
+			// the sender has given up on the one before
+			gMsgLinkStats.Incomplete++;
+			pRx->Count = 0;
+		}
+		if (pRx->Count == 0) {
+			pRx->Station = pFrame->Src;
+			pRx->Seq     = first;
+			pRx->Count   = count;
+			pRx->Have    = 0;
 		}
-		gFlagEndTransmission = false;
-		RADIO_SetVfoState(VFO_STATE_NORMAL);
 
-		BK4819_ToggleGpioOut(BK4819_GPIO5_PIN1_RED, false);
+		memcpy(pRx->Text + index * MSGLINK_FRAGMENT_DATA, pFrame->pPayload + 1, size);
+		pRx->Have |= 1u << index;
+		pRx->Timer = MSG_LONG_TIMEOUT;
+		if (index + 1 == count) {
+			pRx->Length = index * MSGLINK_FRAGMENT_DATA + size;
+		}
+		if (pRx->Have == (1u << count) - 1) {
+			longDeliver();
+		}
+	} else {
+		gMsgLinkStats.Duplicates++;
+	}
 
-		MSG_EnableRX(true);
-		if (!bServiceMessage) {
-			moveUP(rxMessage);
-			snprintf(rxMessage[MAX_LINES - 1], sizeof(rxMessage[MAX_LINES - 1]), "> %.*s", (int)user_len, txMessage);
-			memset(lastcMessage, 0, sizeof(lastcMessage));
-			memcpy(lastcMessage, txMessage, user_len);
-			cIndex = 0;
-			prevKey = 0;
-			prevLetter = 0;
-			memset(cMessage, 0, sizeof(cMessage));
-			if (gScreenToDisplay == DISPLAY_MSG) {
-				gUpdateDisplay = true;
+	// one ACK after the last fragment, each one restarts the reply delay
+	linkReply(MSGLINK_ACK, pFrame->Src, pPeer->Top, pPeer->Seen);
+}
+#endif
+
+#ifdef ENABLE_MESSENGER_LINK
+// false if msgFSKBuffer doesn't hold a link frame
+static bool linkReceive(void) {
+	MSGLINK_Frame_t frame;
+	const MSGLINK_Result_t result = MSGLINK_Parse(msgFSKBuffer, gFSKWriteIndex, &frame);
+	const uint16_t own = linkStation();
+
+	if (result == MSGLINK_NOT_LINK) {
+		return false;
+	}
+
+	if (result == MSGLINK_BAD_CRC) {
+		gMsgLinkStats.BadFrames++;
+		// ask for it again; if the header is damaged as well the NACK
+		// goes nowhere or costs the sender one early retry
+		if (frame.Type == MSGLINK_DATA && frame.Src != own && frame.Src != MSGLINK_BROADCAST) {
+			linkReply(MSGLINK_NACK, frame.Src, frame.Seq, 0);
+		}
+#ifdef ENABLE_MESSENGER_LONG
+		// an ACK for the fragments before it already tells what is missing
+		if (frame.Type == MSGLINK_FRAGMENT && frame.Src != own && frame.Src != MSGLINK_BROADCAST &&
+		    !(gMsgReply.Timer != 0 && gMsgReply.Type == MSGLINK_ACK && gMsgReply.Dst == frame.Src)) {
+			linkReply(MSGLINK_NACK, frame.Src, frame.Seq, 0);
+		}
+#endif
+		return true;
+	}
+
+	if (frame.Src == own || (frame.Dst != own && frame.Dst != MSGLINK_BROADCAST)) {
+		return true;
+	}
+
+	switch (frame.Type) {
+		case MSGLINK_DATA: {
+			MsgPeer_t *pPeer = linkPeer(frame.Src, frame.Seq);
+
+			if (linkTake(pPeer, frame.Seq)) {
+				char text[TX_MSG_LENGTH + 1];
+				const uint8_t len = (frame.Length < TX_MSG_LENGTH) ? frame.Length : TX_MSG_LENGTH;
+
+				for (uint8_t i = 0; i < len; i++) {
+					text[i] = validate_char(frame.pPayload[i]);
+				}
+				text[len] = '\0';
+
+				gMsgLinkStats.Received++;
+				addLine(LINE_RECEIVED, text, len);
+#ifdef ENABLE_MESSENGER_UART
+				UART_printf("SMS< %s\n", text);
+#endif
+				notifyReceived();
+			} else {
+				gMsgLinkStats.Duplicates++;
 			}
+
+			// a repeat is ACKed again, the last ACK may have been lost
+			linkReply(MSGLINK_ACK, frame.Src, pPeer->Top, pPeer->Seen);
+			break;
+		}
+
+		case MSGLINK_ACK:
+			linkAcked(frame.Seq, frame.Length ? frame.pPayload[0] : 0);
+			break;
+
+		case MSGLINK_NACK:
+			linkNacked(frame.Seq);
+			break;
+
+#ifdef ENABLE_MESSENGER_LONG
+		case MSGLINK_FRAGMENT:
+			longReceive(&frame);
+			break;
+#endif
+	}
+
+	return true;
+}
+
+static void linkTimeSlice(void) {
+	for (size_t i = 0; i < MSG_LINK_SLOTS; ++i) {
+		if (gMsgPending[i].Tries != 0 && gMsgPending[i].Timer != 0) {
+			gMsgPending[i].Timer--;
+		}
+	}
+	if (gMsgReply.Timer > 1) {
+		gMsgReply.Timer--;
+	}
+#ifdef ENABLE_MESSENGER_LONG
+	if (gMsgLongTx.Tries != 0 && gMsgLongTx.Timer != 0) {
+		gMsgLongTx.Timer--;
+	}
+	if (gMsgLongRx.Count != 0 && --gMsgLongRx.Timer == 0) {
+		gMsgLinkStats.Incomplete++;
+		gMsgLongRx.Count = 0;
+	}
+
+	if (gMsgLongTx.Tries > MSG_LINK_RETRIES && gMsgLongTx.Timer == 0) {
+		linkFailed(gMsgLongTx.Line);
+		gMsgLongTx.Tries = 0;
+	}
+#endif
+
+	for (size_t i = 0; i < MSG_LINK_SLOTS; ++i) {
+		MsgPending_t *pSlot = &gMsgPending[i];
+
+		if (pSlot->Tries > MSG_LINK_RETRIES && pSlot->Timer == 0) {
+			linkFailed(pSlot->Line);
+			pSlot->Tries = 0;
+		}
+	}
+}
+#endif
+
+static void txLoad(bool bNext) {
+	gMsgTxFinished = false;
+	fskTxLoad(bNext);
+	gMsgTxPackets++;
+	gMsgTxState = TX_SENDING;
+	gMsgTxTimer = MSG_TX_TIMEOUT;
+}
+
+static void txStep(void) {
+	if (gCurrentFunction != FUNCTION_TRANSMIT) {
+		// the TX timeout got there first
+		if (gMsgTxState != TX_KEYED && gMsgTxState != TX_UNKEY) {
+			fskTxStop();
+		}
+		txUnkey(false);
+		return;
+	}
+
+	if (gMsgTxState == TX_SENDING) {
+		if (!gMsgTxFinished && --gMsgTxTimer != 0) {
+			return;
+		}
+		if (gMsgTxPackets < MSG_TX_BURST && txNext(true)) {
+			txLoad(true);
+		} else {
+			gMsgTxState = TX_TAIL;
+			gMsgTxTimer = MSG_TX_STEP;
 		}
+		return;
+	}
+
+	if (--gMsgTxTimer != 0) {
+		return;
+	}
+
+	switch (gMsgTxState) {
+		case TX_KEYED:
+			fskTxStart();
+			gMsgTxState = TX_SETUP;
+			gMsgTxTimer = MSG_TX_STEP;
+			break;
+
+		case TX_SETUP:
+			if (txNext(true)) {
+				txLoad(false);
+			} else {
+				gMsgTxState = TX_TAIL;
+				gMsgTxTimer = MSG_TX_STEP;
+			}
+			break;
+
+		case TX_TAIL:
+			fskTxStop();
+			gMsgTxState = TX_UNKEY;
+			gMsgTxTimer = MSG_TX_STEP;
+			break;
+
+		default:
+			txUnkey(true);
+			break;
+	}
+}
+
+void MSG_TimeSlice10ms(void) {
+#ifdef ENABLE_MESSENGER_LINK
+	linkTimeSlice();
+#endif
+
+	if (msgStatus != RECEIVING) {
+		gMsgRxTicks = 0;
+	} else if (++gMsgRxTicks >= MSG_RX_TIMEOUT) {
+		// RX_FINISHED never came, don't hold the channel busy for it
 		msgStatus = READY;
+	}
 
-	} else {
-		AUDIO_PlayBeep(BEEP_500HZ_60MS_DOUBLE_BEEP_OPTIONAL);
+	if (gMsgTxState != TX_IDLE) {
+		txStep();
+		return;
+	}
+
+	if (channelBusy()) {
+		if (gMsgTxClear != 0) {
+			txDrawBackoff();
+		}
+		gMsgTxClear = 0;
+		return;
+	}
+	if (gMsgTxClear < 255) {
+		gMsgTxClear++;
+	}
+
+	if (!txNext(false)) {
+		return;
+	}
+
+	if (gCurrentFunction == FUNCTION_POWER_SAVE) {
+		// listen before talking, the receiver dozes in power save
+		FUNCTION_Select(FUNCTION_FOREGROUND);
+		gBatterySaveCountdown_10ms = battery_save_count_10ms;
+		gMsgTxClear = 0;
+		return;
+	}
+
+#ifdef ENABLE_MESSENGER_LINK
+	if (gMsgTxClear < ((gMsgReply.Timer == 1) ? gMsgTxReplyGap : gMsgTxBackoff)) {
+		return;
+	}
+#else
+	if (gMsgTxClear < gMsgTxBackoff) {
+		return;
+	}
+#endif
+
+	if (TX_freq_check(gCurrentVfo->pTX->Frequency) == 0) {
+		txKeyUp();
 	}
 }
 
-static uint8_t validate_char(uint8_t rchar) {
-	if ( (rchar == 0x1b) || (rchar >= 32 && rchar <= 127) ) {
-		return rchar;
+static void storeByte(const uint8_t byte) {
+#ifdef ENABLE_MESSENGER_FEC
+	// the chip hands over a couple of bytes more than were sent
+	if (msgFecDecoder.Count < MSG_FSK_PACKET_SIZE) {
+		FEC_DecodeByte(&msgFecDecoder, byte);
+	}
+#endif
+	if (gFSKWriteIndex < sizeof(msgFSKBuffer)) {
+		msgFSKBuffer[gFSKWriteIndex++] = byte;
 	}
-	return 32;
 }
 
+#ifdef ENABLE_MESSENGER_FEC
+static void fecCorrect(void) {
+	// a packet cut short (or from a station without FEC) is taken as it is
+	const int8_t wrong = (msgFecDecoder.Count == MSG_FSK_PACKET_SIZE) ?
+		FEC_DecodeEnd(&msgFecDecoder, msgFSKBuffer, sizeof(msgFSKBuffer)) : -1;
+
+	if (wrong == 0) {
+		gMsgFecStats.Clean++;
+	} else if (wrong > 0) {
+		gMsgFecStats.Corrected++;
+		gMsgFecStats.Bytes += wrong;
+	} else {
+		gMsgFecStats.Failed++;
+	}
+}
+#endif
+
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+void MSG_StorePacket(const uint16_t interrupt_bits, const uint16_t *pFifo, const uint8_t fifo_words) {
+#else
 void MSG_StorePacket(const uint16_t interrupt_bits) {
+#endif
 
 	//const uint16_t rx_sync_flags   = BK4819_ReadRegister(BK4819_REG_0B);
 
@@ -661,26 +1796,39 @@ void MSG_StorePacket(const uint16_t interrupt_bits) {
 	const bool rx_fifo_almost_full = (interrupt_bits & BK4819_REG_02_FSK_FIFO_ALMOST_FULL) ? true : false;
 	const bool rx_finished         = (interrupt_bits & BK4819_REG_02_FSK_RX_FINISHED) ? true : false;
 
+	if (interrupt_bits & BK4819_REG_02_FSK_TX_FINISHED) {
+		gMsgTxFinished = true;
+	}
+
 	//UART_printf("\nMSG : S%i, F%i, E%i | %0.16b", rx_sync, rx_fifo_almost_full, rx_finished, interrupt_bits);
 
 	if (rx_sync) {
 		gFSKWriteIndex = 0;
 		memset(msgFSKBuffer, 0, sizeof(msgFSKBuffer));
+#ifdef ENABLE_MESSENGER_FEC
+		FEC_DecodeStart(&msgFecDecoder);
+#endif
 		msgStatus = RECEIVING;
 	}
 
 	if (rx_fifo_almost_full && msgStatus == RECEIVING) {
 
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+		// the words were drained from the chip when the interrupt was queued
+		for (uint8_t i = 0; i < fifo_words; i++) {
+			const uint16_t word = pFifo[i];
+#else
 		const uint16_t count = BK4819_ReadRegister(BK4819_REG_5E) & (7u << 0);  // almost full threshold
 		for (uint16_t i = 0; i < count; i++) {
 			const uint16_t word = BK4819_ReadRegister(BK4819_REG_5F);
-			if (gFSKWriteIndex < sizeof(msgFSKBuffer))
-				msgFSKBuffer[gFSKWriteIndex++] = validate_char((word >> 0) & 0xff);
-			if (gFSKWriteIndex < sizeof(msgFSKBuffer))
-				msgFSKBuffer[gFSKWriteIndex++] = validate_char((word >> 8) & 0xff);
+#endif
+			storeByte((word >> 0) & 0xff);
+			storeByte((word >> 8) & 0xff);
 		}
 
+#ifndef ENABLE_BK4819_IRQ_QUEUE
 		SYSTEM_DelayMs(10);
+#endif
 
 	}
 
@@ -692,6 +1840,28 @@ void MSG_StorePacket(const uint16_t interrupt_bits) {
 		BK4819_WriteRegister(BK4819_REG_59, (1u << 12) | fsk_reg59);
 		msgStatus = READY;
 
+#ifdef ENABLE_MESSENGER_FEC
+		fecCorrect();
+#endif
+
+#ifdef ENABLE_MESSENGER_LINK
+		if (linkReceive()) {
+			gFSKWriteIndex = 0;
+			return;
+		}
+		if (msgFSKBuffer[0] != 'M' || msgFSKBuffer[1] != 'S') {
+			// noise, or a link frame damaged beyond recognition
+			gMsgLinkStats.BadFrames++;
+			gFSKWriteIndex = 0;
+			return;
+		}
+#endif
+
+		// the older format has no CRC, show what arrived as text
+		for (size_t i = 0; i < gFSKWriteIndex; i++) {
+			msgFSKBuffer[i] = validate_char(msgFSKBuffer[i]);
+		}
+
 		if (gFSKWriteIndex > 2) {
 
 			// If there's three 0x1b bytes, then it's a service message
@@ -700,35 +1870,25 @@ void MSG_StorePacket(const uint16_t interrupt_bits) {
 				// If the next 4 bytes are "RCVD", then it's a delivery notification
 				if (msgFSKBuffer[5] == 'R' && msgFSKBuffer[6] == 'C' && msgFSKBuffer[7] == 'V' && msgFSKBuffer[8] == 'D') {
 					UART_printf("SVC<RCPT\n");
-					rxMessage[MAX_LINES - 1][strlen(rxMessage[MAX_LINES - 1])] = '+';
+					markLine((uint8_t)(gMsgLineNext - 1), '+');
 					gUpdateStatus = true;
 					gUpdateDisplay = true;
 				}
 			#endif
 			} else {
-				moveUP(rxMessage);
 				if (msgFSKBuffer[0] != 'M' || msgFSKBuffer[1] != 'S') {
-					snprintf(rxMessage[MAX_LINES - 1], TX_MSG_LENGTH + 2, "? unknown msg format!");
+					addLine(LINE_UNKNOWN, "unknown msg format!", 19);
 				}
 				else
 				{
-					snprintf(rxMessage[MAX_LINES - 1], TX_MSG_LENGTH + 2, "< %s", &msgFSKBuffer[2]);
+					const char *text = (const char *)&msgFSKBuffer[2];
+					addLine(LINE_RECEIVED, text, strnlen(text, MAX_MSG_LENGTH));
 					#ifdef ENABLE_MESSENGER_UART
-					UART_printf("SMS%s\n", rxMessage[MAX_LINES - 1]);
+					UART_printf("SMS< %.*s\n", MAX_MSG_LENGTH, text);
 					#endif
 				}			
 
-				if ( gScreenToDisplay != DISPLAY_MSG ) {
-					hasNewMessage = 1;
-					gUpdateStatus = true;
-					gUpdateDisplay = true;
-			#ifdef ENABLE_MESSENGER_NOTIFICATION
-					gPlayMSGRing = true;
-			#endif
-				}
-				else {
-					gUpdateDisplay = true;
-				}
+				notifyReceived();
 			}
 		}
 
@@ -744,6 +1904,19 @@ void MSG_StorePacket(const uint16_t interrupt_bits) {
 
 void MSG_Init() {
 	memset(rxMessage, 0, sizeof(rxMessage));
+#ifdef ENABLE_MESSENGER_LOG
+	MSGLOG_Clear();
+	gMsgViewBack   = 0;
+	gMsgViewLoaded = true;
+#endif
+#ifdef ENABLE_MESSENGER_LINK
+	for (size_t i = 0; i < MSG_LINK_SLOTS; ++i) {
+		gMsgPending[i].Line = -1;
+	}
+#endif
+#ifdef ENABLE_MESSENGER_LONG
+	gMsgLongTx.Line = -1;
+#endif
 	memset(cMessage, 0, sizeof(cMessage));
 	memset(lastcMessage, 0, sizeof(lastcMessage));
 	hasNewMessage = 0;
@@ -897,12 +2070,22 @@ void  MSG_ProcessKeys(KEY_Code_t Key, bool bKeyPressed, bool bKeyHeld) {
 				processBackspace();
 				break;
 			case KEY_UP:
+#ifdef ENABLE_MESSENGER_LOG
+				// back towards the newest line first
+				if (gMsgViewBack != 0) {
+					viewScroll(false);
+					break;
+				}
+#endif
 				memset(cMessage, 0, sizeof(cMessage));
 				memcpy(cMessage, lastcMessage, TX_MSG_LENGTH);
 				cIndex = strlen(cMessage);
 				break;
-			/*case KEY_DOWN:
-				break;*/
+#ifdef ENABLE_MESSENGER_LOG
+			case KEY_DOWN:
+				viewScroll(true);
+				break;
+#endif
 			case KEY_MENU:
 			case KEY_PTT:
 				// Send message
@@ -23,6 +23,11 @@ enum {
 };
 
 #define MAX_LINES 6
+
+#ifdef ENABLE_MESSENGER_LONG
+// longest message, station ID included; it goes as up to 6 link fragments
+#define MSG_LONG_LENGTH 240
+#endif
 #define NEXT_CHAR_DELAY 100 // 10ms tick
 
 //const uint8_t TX_MSG_LENGTH = 30;
@@ -31,7 +36,6 @@ enum {
 extern KeyboardType keyboardType;
 extern uint16_t gErrorsDuringMSG;
 extern char cMessage[TX_MSG_LENGTH];
-extern char rxMessage[MAX_LINES][MAX_RX_MSG_LENGTH + 2];
 extern uint8_t hasNewMessage;
 extern uint8_t keyTickCounter;
 uint8_t MSG_GetPrevKey(void);
@@ -40,12 +44,50 @@ bool MSG_IsChoosingChar(void);
 #define MSG_KEY_CHARS_MAX 4
 uint8_t MSG_GetKeyChars(uint8_t key, char out[MSG_KEY_CHARS_MAX]);
 void MSG_TimeoutInput(void);
+// row 0 is the top of the screen
+const char *MSG_GetLine(uint8_t row);
+// lines scrolled back through the history, 0 showing the newest
+uint8_t MSG_GetScrollBack(void);
 
 void MSG_EnableRX(const bool enable);
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+void MSG_StorePacket(const uint16_t interrupt_bits, const uint16_t *pFifo, const uint8_t fifo_words);
+#else
 void MSG_StorePacket(const uint16_t interrupt_bits);
+#endif
 void MSG_Init();
 void MSG_ProcessKeys(KEY_Code_t Key, bool bKeyPressed, bool bKeyHeld);
-void MSG_Send(const char *txMessage, bool bServiceMessage);
+// queues the message, false (and a beep for the user's own) if it can't go
+bool MSG_Send(const char *txMessage, bool bServiceMessage);
+// sends what is queued or due once the channel is free, keyed up meanwhile
+void MSG_TimeSlice10ms(void);
+bool MSG_IsTransmitting(void);
+
+#ifdef ENABLE_MESSENGER_LINK
+typedef struct {
+	uint16_t Sent;          // data frames, retries included
+	uint16_t Retries;
+	uint16_t Delivered;     // ACKed
+	uint16_t Failed;        // given up on
+	uint16_t Received;      // new messages taken
+	uint16_t Duplicates;    // repeats of messages already taken
+	uint16_t BadFrames;     // failed the CRC or unrecognisable
+	uint16_t Incomplete;    // long messages given up on half received
+} MSG_LinkStats_t;
+
+extern MSG_LinkStats_t gMsgLinkStats;
+#endif
+
+#ifdef ENABLE_MESSENGER_FEC
+typedef struct {
+	uint16_t Clean;         // packets that came in without an error
+	uint16_t Corrected;     // packets put right
+	uint16_t Bytes;         // bytes put right in them
+	uint16_t Failed;        // too damaged, or cut short
+} MSG_FecStats_t;
+
+extern MSG_FecStats_t gMsgFecStats;
+#endif
 
 #endif
 
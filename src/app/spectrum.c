@@ -32,6 +32,19 @@
 #include "driver/eeprom.h"
 #endif
 
+#if defined(ENABLE_SPECTRUM_STREAM) || defined(ENABLE_SPECTRUM_ADAPTIVE_SETTLE)
+#include "ARMCM0.h"
+#endif
+#ifdef ENABLE_FREQ_BLACKLIST
+#include "helper/blacklist.h"
+#endif
+#ifdef ENABLE_RSSI_LUT
+#include "helper/rssi.h"
+#endif
+#ifdef ENABLE_SPECTRUM_STREAM
+#include "app/uart.h"
+#endif
+
 struct FrequencyBandInfo
 {
     uint32_t lower;
@@ -60,13 +73,21 @@ bool lockAGC = false;
 State currentState = SPECTRUM, previousState = SPECTRUM;
 
 PeakInfo peak;
+#ifdef ENABLE_SPECTRUM_STATS
+SpectrumStats_t gSpectrumStats;
+#endif
 ScanInfo scanInfo;
 KeyboardState kbd = {KEY_INVALID, KEY_INVALID, 0};
 
-#ifdef ENABLE_SCAN_RANGES
+#if defined(ENABLE_SCAN_RANGES) && !defined(ENABLE_FREQ_BLACKLIST)
 static uint16_t blacklistFreqs[15];
 static uint8_t blacklistFreqsIdx;
 #endif
+#if defined(ENABLE_FREQ_BLACKLIST) || defined(ENABLE_SPECTRUM_TRACES)
+// A key whose press acts when it comes up again, because held long enough
+// it does something else instead: SIDE1 and MENU
+static KEY_Code_t keyOnRelease = KEY_INVALID;
+#endif
 
 const char *bwOptions[] = {"25", "12.5", "6.25"};
 const uint8_t modulationTypeTuneSteps[] = {100, 50, 10};
@@ -82,12 +103,87 @@ SpectrumSettings settings = {.stepsCount = STEPS_64,
                              .listenBw = BK4819_FILTER_BW_WIDE,
                              .modulationType = false,
                              .dbMin = -130,
-                             .dbMax = -50};
+                             .dbMax = -50,
+#ifdef ENABLE_SPECTRUM_TRACES
+                             .traceView = TRACE_LIVE,
+                             .traceAvgShift = 3,
+                             .traceHoldDecay = 5,
+#endif
+};
 
 uint32_t fMeasure = 0;
 uint32_t currentFreq, tempFreq;
 uint16_t rssiHistory[128];
 int vfo;
+
+#ifdef ENABLE_SCAN_RANGES
+// display bin of scan step i is (i * rssiBinStep) >> 16 when there are more
+// than 128 steps, set once per sweep by InitScan()
+static uint32_t rssiBinStep;
+#endif
+
+#ifdef ENABLE_SPECTRUM_TRACES
+// Traces kept next to the live rssiHistory[], one entry per display bin and
+// updated once per finished sweep. Hold traces are in 1 dB units (rssi / 2),
+// the average is the same scaled by 256 so small steps don't round away.
+static uint16_t traceAvg[128];
+static uint8_t traceMax[128];
+static uint8_t traceMin[128];
+static bool tracePrimed;
+static uint8_t traceDecayTicks;
+static const char *const traceNames[] = {"", "AVG", "MAX", "MIN"};
+
+// MENU held steps what the trace on screen is built with: the weight of a
+// new sweep in the average, 1/2 to 1/32, or for the holds the 40 ms ticks
+// per dB of decay, 25, 5 and 1 dB/s and then none
+#define TRACE_AVG_SHIFT_MIN 1
+#define TRACE_AVG_SHIFT_MAX 5
+static const uint8_t traceHoldDecaySteps[] = {1, 5, 25, 0};
+
+static uint8_t GetTraceHoldDecayStep()
+{
+    uint8_t i = 0;
+
+    while (i < ARRAY_SIZE(traceHoldDecaySteps) - 1 && traceHoldDecaySteps[i] != settings.traceHoldDecay)
+        i++;
+    return i;
+}
+#endif
+
+#ifdef ENABLE_SPECTRUM_WATERFALL
+// Waterfall history, newest row at waterfallHead - 1. A row holds one 2 bit
+// intensity per display column, four columns to a byte, and is the peak
+// hold of every sweep finished during WATERFALL_ROW_TICKS x 40 ms, so the
+// 16 rows span about two seconds whatever the sweep rate.
+#define WATERFALL_ROWS      16
+#define WATERFALL_ROW_BYTES (128 / 4)
+#define WATERFALL_ROW_TICKS 3
+
+static uint8_t waterfall[WATERFALL_ROWS][WATERFALL_ROW_BYTES];
+static uint8_t waterfallPending[WATERFALL_ROW_BYTES];
+static uint8_t waterfallHead;
+static uint8_t waterfallCount;
+static uint8_t waterfallSweeps;
+static uint8_t waterfallTicks;
+static bool waterfallMode = false;
+#endif
+
+#ifdef ENABLE_SPECTRUM_ADAPTIVE_SETTLE
+// Learned time from retune to a valid measurement, per band and scan step
+// in SETTLE_UNIT_US. GetRssi() sleeps that long before its first glitch
+// poll, then nudges the entry toward what the step actually needed.
+#define SETTLE_UNIT_US  10
+#define SETTLE_POLL_US  25
+
+static uint8_t settleModel[BAND_N_ELEM][S_STEP_100_0kHz + 1];
+static bool scanRetuned;
+#endif
+
+#ifdef ENABLE_SPECTRUM_RATE
+static uint16_t stepsMeasured;
+static uint16_t stepsPerSecond;
+#endif
+
 uint8_t freqInputIndex = 0;
 uint8_t freqInputDotIndex = 0;
 KEY_Code_t freqInputArr[10];
@@ -141,6 +237,20 @@ static void LoadSettings()
     {
         settings.listenBw = BK4819_FILTER_BW_WIDE;
     }
+
+#ifdef ENABLE_SPECTRUM_TRACES
+    // 0x1FF2: average shift in the high nibble, hold decay step in the low
+    // one, each left at its default while never saved (0xF)
+    if ((Data[2] >> 4) >= TRACE_AVG_SHIFT_MIN && (Data[2] >> 4) <= TRACE_AVG_SHIFT_MAX)
+    {
+        settings.traceAvgShift = Data[2] >> 4;
+    }
+
+    if ((Data[2] & 0x0F) < ARRAY_SIZE(traceHoldDecaySteps))
+    {
+        settings.traceHoldDecay = traceHoldDecaySteps[Data[2] & 0x0F];
+    }
+#endif
 }
 
 static void SaveSettings()
@@ -150,11 +260,23 @@ static void SaveSettings()
     EEPROM_ReadBuffer(0x1FF0, Data, 8);
 
     Data[3] = (settings.scanStepIndex << 4) | (settings.stepsCount << 2) | settings.listenBw;
+#ifdef ENABLE_SPECTRUM_TRACES
+    Data[2] = (settings.traceAvgShift << 4) | GetTraceHoldDecayStep();
+#endif
 
     EEPROM_WriteBuffer(0x1FF0, Data);
 }
 #endif
 
+#ifdef ENABLE_RSSI_LUT
+static uint8_t DBm2S(int dbm)
+{
+    // the same scale as the main screen, but S9 reaches up to -63 dBm here
+    if (dbm > -67 && dbm <= -63)
+        return 9;
+    return RSSI_DBmToSLevel(dbm);
+}
+#else
 static uint8_t DBm2S(int dbm)
 {
     uint8_t i = 0;
@@ -168,6 +290,7 @@ static uint8_t DBm2S(int dbm)
     }
     return i;
 }
+#endif
 
 static int Rssi2DBm(uint16_t rssi)
 {
@@ -450,13 +573,57 @@ uint8_t GetBWRegValueForScan()
     return scanStepBWRegValues[settings.scanStepIndex];
 }
 
+#ifdef ENABLE_SPECTRUM_ADAPTIVE_SETTLE
+static bool IsSettled() { return (BK4819_ReadRegister(0x63) & 0b11111111) < 255; }
+
+static void WaitSettled()
+{
+    uint8_t *pModel = &settleModel[FREQUENCY_GetBand(scanInfo.f)][settings.scanStepIndex];
+    const uint32_t start = SysTick->VAL;
+
+    if (*pModel)
+        SYSTICK_DelayUs(*pModel * SETTLE_UNIT_US);
+
+    if (IsSettled())
+    {
+        // valid on the first poll, maybe we waited too long: probe shorter
+        if (*pModel)
+            *pModel -= (*pModel >> 4) + 1;
+        return;
+    }
+
+    do
+    {
+        SYSTICK_DelayUs(SETTLE_POLL_US);
+    } while (!IsSettled());
+
+    // SysTick counts down and wraps every 10 ms, far longer than a settle
+    const uint32_t now = SysTick->VAL;
+    int32_t taken = (start >= now ? start - now : start + SysTick->LOAD + 1 - now) / (48 * SETTLE_UNIT_US);
+    if (taken > 255)
+        taken = 255;
+    if (taken > *pModel)
+        *pModel += (taken - *pModel + 3) >> 2;
+}
+#endif
+
 uint16_t GetRssi()
 {
-    // SYSTICK_DelayUs(800);
-    // testing autodelay based on Glitch value
-    while ((BK4819_ReadRegister(0x63) & 0b11111111) >= 255)
+#ifdef ENABLE_SPECTRUM_ADAPTIVE_SETTLE
+    if (scanRetuned)
     {
-        SYSTICK_DelayUs(100);
+        scanRetuned = false;
+        WaitSettled();
+    }
+    else
+#endif
+    {
+        // SYSTICK_DelayUs(800);
+        // testing autodelay based on Glitch value
+        while ((BK4819_ReadRegister(0x63) & 0b11111111) >= 255)
+        {
+            SYSTICK_DelayUs(100);
+        }
     }
     uint16_t rssi = BK4819_GetRSSI();
 #ifdef ENABLE_AM_FIX
@@ -534,6 +701,10 @@ static void InitScan()
 
     scanInfo.scanStep = GetScanStep();
     scanInfo.measurementsCount = GetStepsCount();
+#ifdef ENABLE_SCAN_RANGES
+    if (scanInfo.measurementsCount > 128)
+        rssiBinStep = ((uint32_t)ARRAY_SIZE(rssiHistory) << 16) / scanInfo.measurementsCount;
+#endif
 }
 
 static void ResetBlacklist()
@@ -543,15 +714,41 @@ static void ResetBlacklist()
         if (rssiHistory[i] == RSSI_MAX_VALUE)
             rssiHistory[i] = 0;
     }
-#ifdef ENABLE_SCAN_RANGES
+#if defined(ENABLE_SCAN_RANGES) && !defined(ENABLE_FREQ_BLACKLIST)
     memset(blacklistFreqs, 0, sizeof(blacklistFreqs));
     blacklistFreqsIdx = 0;
 #endif
 }
 
+#ifdef ENABLE_SPECTRUM_WATERFALL
+static void ResetWaterfall()
+{
+    memset(waterfall, 0, sizeof(waterfall));
+    memset(waterfallPending, 0, sizeof(waterfallPending));
+    waterfallHead = 0;
+    waterfallCount = 0;
+    waterfallSweeps = 0;
+    waterfallTicks = 0;
+}
+#endif
+
+#ifdef ENABLE_SPECTRUM_TRACES
+static void ResetTraces()
+{
+    tracePrimed = false;
+    traceDecayTicks = 0;
+}
+#endif
+
 static void RelaunchScan()
 {
     InitScan();
+#ifdef ENABLE_SPECTRUM_TRACES
+    ResetTraces();
+#endif
+#ifdef ENABLE_SPECTRUM_WATERFALL
+    ResetWaterfall();
+#endif
     ResetPeak();
     ToggleRX(false);
 #ifdef SPECTRUM_AUTOMATIC_SQUELCH
@@ -606,7 +803,7 @@ static void SetRssiHistory(uint16_t idx, uint16_t rssi)
 #ifdef ENABLE_SCAN_RANGES
     if (scanInfo.measurementsCount > 128)
     {
-        uint8_t i = (uint32_t)ARRAY_SIZE(rssiHistory) * 1000 / scanInfo.measurementsCount * idx / 1000;
+        uint8_t i = ((uint32_t)idx * rssiBinStep) >> 16;
         if (rssiHistory[i] < rssi || isListening)
             rssiHistory[i] = rssi;
         rssiHistory[(i + 1) % 128] = 0;
@@ -622,6 +819,75 @@ static void Measure()
     SetRssiHistory(scanInfo.i, rssi);
 }
 
+#ifdef ENABLE_SPECTRUM_TRACES
+// Fold the finished sweep into the average and hold traces. Blacklisted
+// bins keep their old values.
+static void UpdateTraces()
+{
+    const uint8_t bins = scanInfo.measurementsCount > 128 ? 128 : scanInfo.measurementsCount;
+    const uint8_t shift = settings.traceAvgShift;
+
+    for (uint8_t i = 0; i < bins; ++i)
+    {
+        if (rssiHistory[i] == RSSI_MAX_VALUE)
+            continue;
+
+        const uint8_t live = rssiHistory[i] >> 1;
+
+        if (!tracePrimed)
+        {
+            traceAvg[i] = live << 8;
+            traceMax[i] = live;
+            traceMin[i] = live;
+            continue;
+        }
+
+        traceAvg[i] += ((int32_t)(live << 8) - traceAvg[i]) >> shift;
+        if (live > traceMax[i])
+            traceMax[i] = live;
+        if (live < traceMin[i])
+            traceMin[i] = live;
+    }
+
+    tracePrimed = true;
+}
+
+// Every traceHoldDecay x 40 ms the holds let go by 1 dB, so a signal that
+// went away fades out instead of sticking until the next relaunch.
+static void DecayTraces()
+{
+    if (!settings.traceHoldDecay || ++traceDecayTicks < settings.traceHoldDecay)
+        return;
+
+    traceDecayTicks = 0;
+    for (uint8_t i = 0; i < 128; ++i)
+    {
+        if (traceMax[i])
+            traceMax[i]--;
+        if (traceMin[i] < 255)
+            traceMin[i]++;
+    }
+}
+
+static uint16_t GetTraceRssi(TraceType trace, uint8_t i)
+{
+    if (rssiHistory[i] == RSSI_MAX_VALUE || !tracePrimed)
+        return rssiHistory[i];
+
+    switch (trace)
+    {
+    case TRACE_AVG:
+        return (traceAvg[i] >> 8) << 1;
+    case TRACE_MAX:
+        return traceMax[i] << 1;
+    case TRACE_MIN:
+        return traceMin[i] << 1;
+    default:
+        return rssiHistory[i];
+    }
+}
+#endif
+
 // Update things by keypress
 
 static uint16_t dbm2rssi(int dBm)
@@ -877,7 +1143,9 @@ static void UpdateFreqInput(KEY_Code_t key)
 
 static void Blacklist()
 {
-#ifdef ENABLE_SCAN_RANGES
+#ifdef ENABLE_FREQ_BLACKLIST
+    BLACKLIST_Add(peak.f);
+#elif defined(ENABLE_SCAN_RANGES)
     blacklistFreqs[blacklistFreqsIdx++ % ARRAY_SIZE(blacklistFreqs)] = peak.i;
 #endif
 
@@ -887,7 +1155,7 @@ static void Blacklist()
     ResetScanStats();
 }
 
-#ifdef ENABLE_SCAN_RANGES
+#if defined(ENABLE_SCAN_RANGES) && !defined(ENABLE_FREQ_BLACKLIST)
 static bool IsBlacklisted(uint16_t idx)
 {
     if (blacklistFreqsIdx)
@@ -914,55 +1182,103 @@ uint8_t Rssi2PX(uint16_t rssi, uint8_t pxMin, uint8_t pxMax)
     return ((dbm - DB_MIN) * PX_RANGE + DB_RANGE / 2) / DB_RANGE + pxMin;
 }
 
+#ifdef ENABLE_SPECTRUM_WATERFALL
+// the waterfall takes the rows right above the ticks
+static uint8_t GetSpectrumEndY()
+{
+    return waterfallMode ? DrawingEndY - WATERFALL_ROWS - 1 : DrawingEndY;
+}
+#else
+static uint8_t GetSpectrumEndY() { return DrawingEndY; }
+#endif
+
+#ifdef ENABLE_RSSI_LUT
+static RSSI_Scale_t spectrumScale;
+
+// once per frame, the table is only rebuilt when something changed
+static void UpdateSpectrumScale()
+{
+    RSSI_ScaleSet(&spectrumScale, settings.dbMin, settings.dbMax,
+                  dBmCorrTable[gRxVfo->Band], GetSpectrumEndY());
+}
+
+uint8_t Rssi2Y(uint16_t rssi)
+{
+    return spectrumScale.PxRange - RSSI_ScalePx(&spectrumScale, rssi);
+}
+#else
 uint8_t Rssi2Y(uint16_t rssi)
 {
-    return DrawingEndY - Rssi2PX(rssi, 0, DrawingEndY);
+    const uint8_t endY = GetSpectrumEndY();
+    return endY - Rssi2PX(rssi, 0, endY);
 }
+#endif
 
 #ifdef ENABLE_FEAT_F4HWN
+    // right edge (exclusive) of bar i out of bars
+    static uint8_t GetBarEndX(uint8_t i, uint8_t bars, uint16_t steps)
+    {
+        uint8_t x;
+#ifdef ENABLE_SCAN_RANGES
+        if (gScanRangeStart && bars > 1)
+        {
+            // Total width units = (bars - 1) full bars + 2 half bars = bars
+            // First bar: half width, middle bars: full width, last bar: half width
+            // Scale: 128 pixels / (bars - 1) = pixels per full bar
+            uint16_t fullWidth = 128 * 2 / (bars - 1);  // x2 for precision
+
+            if (i == 0)
+            {
+                x = fullWidth / 4;  // half of half (because fullWidth is x2)
+            }
+            else
+            {
+                // Position = half + (i-1) full bars + current bar
+                x = fullWidth / 4 + (uint16_t)i * fullWidth / 2;
+                if (i == bars - 1) x = 128;  // Last bar ends at screen edge
+            }
+        }
+        else
+#endif
+        {
+            uint8_t shift_graph = 64 / steps + 1;
+            x = i * 128 / bars + shift_graph;
+        }
+        return x;
+    }
+
     static void DrawSpectrum()
     {
         uint16_t steps = GetStepsCount();
         // max bars at 128 to correctly draw larger numbers of samples
         uint8_t bars = (steps > 128) ? 128 : steps;
+        const uint8_t endY = GetSpectrumEndY();
 
         uint8_t ox = 0;
         for (uint8_t i = 0; i < bars; ++i)
         {
-            uint16_t rssi = rssiHistory[(bars>128) ? i >> settings.stepsCount : i];
-            
-#ifdef ENABLE_SCAN_RANGES
-            uint8_t x;
-            if (gScanRangeStart && bars > 1)
-            {
-                // Total width units = (bars - 1) full bars + 2 half bars = bars
-                // First bar: half width, middle bars: full width, last bar: half width
-                // Scale: 128 pixels / (bars - 1) = pixels per full bar
-                uint16_t fullWidth = 128 * 2 / (bars - 1);  // x2 for precision
-                
-                if (i == 0)
-                {
-                    x = fullWidth / 4;  // half of half (because fullWidth is x2)
-                }
-                else
-                {
-                    // Position = half + (i-1) full bars + current bar
-                    x = fullWidth / 4 + (uint16_t)i * fullWidth / 2;
-                    if (i == bars - 1) x = 128;  // Last bar ends at screen edge
-                }
-            }
-            else
+            uint8_t idx = (bars>128) ? i >> settings.stepsCount : i;
+#ifdef ENABLE_SPECTRUM_TRACES
+            uint16_t rssi = GetTraceRssi(settings.traceView, idx);
+#else
+            uint16_t rssi = rssiHistory[idx];
 #endif
-            {
-                uint8_t shift_graph = 64 / steps + 1;
-                x = i * 128 / bars + shift_graph;
-            }
+            uint8_t x = GetBarEndX(i, bars, steps);
 
             if (rssi != RSSI_MAX_VALUE)
             {
+#ifdef ENABLE_SPECTRUM_TRACES
+                // max hold as a dot over the live bars
+                uint8_t holdY = settings.traceView == TRACE_LIVE && tracePrimed
+                                    ? Rssi2Y(traceMax[idx] << 1) : endY;
+#endif
                 for (uint8_t xx = ox; xx < x; xx++)
                 {
-                    DrawVLine(Rssi2Y(rssi), DrawingEndY, xx);
+                    DrawVLine(Rssi2Y(rssi), endY, xx);
+#ifdef ENABLE_SPECTRUM_TRACES
+                    if (holdY < endY)
+                        DrawPixel(xx, holdY);
+#endif
                 }
             }
             ox = x;
@@ -973,13 +1289,164 @@ uint8_t Rssi2Y(uint16_t rssi)
     {
         for (uint8_t x = 0; x < 128; ++x)
         {
+#ifdef ENABLE_SPECTRUM_TRACES
+            uint16_t rssi = GetTraceRssi(settings.traceView, x >> settings.stepsCount);
+#else
             uint16_t rssi = rssiHistory[x >> settings.stepsCount];
+#endif
             if (rssi != RSSI_MAX_VALUE)
             {
-                DrawVLine(Rssi2Y(rssi), DrawingEndY, x);
+                DrawVLine(Rssi2Y(rssi), GetSpectrumEndY(), x);
+            }
+        }
+    }
+#endif
+
+#ifdef ENABLE_SPECTRUM_WATERFALL
+static void ToggleWaterfall()
+{
+    waterfallMode = !waterfallMode;
+    ResetWaterfall();
+    redrawScreen = true;
+}
+
+#endif
+
+#ifdef ENABLE_SPECTRUM_TRACES
+// MENU steps through the live, average, max-hold and min-hold traces, then
+// (with the waterfall built in) the live trace over the waterfall.
+static void NextTraceView()
+{
+#ifdef ENABLE_SPECTRUM_WATERFALL
+    if (waterfallMode)
+    {
+        ToggleWaterfall();
+        return;
+    }
+    if (settings.traceView == TRACE_MIN)
+    {
+        settings.traceView = TRACE_LIVE;
+        ToggleWaterfall();
+        return;
+    }
+#endif
+    settings.traceView = settings.traceView == TRACE_MIN ? TRACE_LIVE : settings.traceView + 1;
+    redrawScreen = true;
+}
+
+static void NextTraceSetting()
+{
+    switch (settings.traceView)
+    {
+    case TRACE_AVG:
+        settings.traceAvgShift = settings.traceAvgShift >= TRACE_AVG_SHIFT_MAX
+                                     ? TRACE_AVG_SHIFT_MIN
+                                     : settings.traceAvgShift + 1;
+        break;
+    case TRACE_MAX:
+    case TRACE_MIN:
+        settings.traceHoldDecay =
+            traceHoldDecaySteps[(GetTraceHoldDecayStep() + 1) % ARRAY_SIZE(traceHoldDecaySteps)];
+        traceDecayTicks = 0;
+        break;
+    default:
+        return;
+    }
+    redrawScreen = true;
+}
+#endif
+
+#ifdef ENABLE_SPECTRUM_WATERFALL
+// Quantize the finished sweep and peak hold it into the pending row: level
+// 0 is the bottom quarter of the dbMin..dbMax window, 3 the top quarter.
+static void RecordWaterfall()
+{
+    uint8_t *row = waterfallPending;
+    const int dbRange = settings.dbMax - settings.dbMin;
+    const uint16_t t1 = dbm2rssi(settings.dbMin + dbRange / 4);
+    const uint16_t t2 = dbm2rssi(settings.dbMin + dbRange / 2);
+    const uint16_t t3 = dbm2rssi(settings.dbMax - dbRange / 4);
+
+#ifdef ENABLE_FEAT_F4HWN
+    uint16_t steps = GetStepsCount();
+    uint8_t bars = (steps > 128) ? 128 : steps;
+#else
+    uint8_t bars = 128 >> settings.stepsCount;
+#endif
+
+    uint8_t ox = 0;
+    for (uint8_t i = 0; i < bars; ++i)
+    {
+        uint16_t rssi = rssiHistory[i];
+#ifdef ENABLE_FEAT_F4HWN
+        uint8_t x = GetBarEndX(i, bars, steps);
+#else
+        uint8_t x = (i + 1) << settings.stepsCount;
+#endif
+        if (x > 128)
+            x = 128;
+
+        if (rssi != RSSI_MAX_VALUE && rssi >= t1)
+        {
+            uint8_t level = 1 + (rssi >= t2) + (rssi >= t3);
+            for (uint8_t xx = ox; xx < x; xx++)
+            {
+                uint8_t shift = (xx & 3) << 1;
+                if (level > ((row[xx >> 2] >> shift) & 3))
+                    row[xx >> 2] = (row[xx >> 2] & ~(3 << shift)) | (level << shift);
             }
         }
+        ox = x;
+    }
+
+    if (waterfallSweeps < 255)
+        waterfallSweeps++;
+}
+
+// Called every 40 ms. A period without a finished sweep (listening) adds no
+// row; the new row shows up with the next sweep's redraw.
+static void UpdateWaterfall()
+{
+    if (++waterfallTicks < WATERFALL_ROW_TICKS || !waterfallSweeps)
+        return;
+
+    memcpy(waterfall[waterfallHead], waterfallPending, WATERFALL_ROW_BYTES);
+    memset(waterfallPending, 0, sizeof(waterfallPending));
+    waterfallHead = (waterfallHead + 1) % WATERFALL_ROWS;
+    if (waterfallCount < WATERFALL_ROWS)
+        waterfallCount++;
+    waterfallSweeps = 0;
+    waterfallTicks = 0;
+}
+
+// Newest row on top. The four levels are drawn as 2x2 ordered dither
+// (none, 1/4, 1/2, all pixels set) straight into the frame buffer, so the
+// cost is fixed at one pass over WATERFALL_ROWS x 128 pixels.
+static void DrawWaterfall()
+{
+    static const uint8_t dither[2][2] = {{0, 2}, {2, 1}};
+
+    if (!Spectrum_IsDisplayReady())
+        return;
+
+    uint8_t *buffer = u8g2_GetBufferPtr(gUiCtx.lcd);
+    const uint8_t y0 = DrawingEndY - WATERFALL_ROWS;
+
+    for (uint8_t r = 0; r < waterfallCount; ++r)
+    {
+        const uint8_t *row = waterfall[(waterfallHead + WATERFALL_ROWS - 1 - r) % WATERFALL_ROWS];
+        const uint8_t y = y0 + r;
+        const uint8_t mask = 1u << (y & 7);
+        uint8_t *page = buffer + (y >> 3) * UI_W;
+
+        for (uint8_t x = 0; x < 128; ++x)
+        {
+            uint8_t level = (row[x >> 2] >> ((x & 3) << 1)) & 3;
+            if (level > dither[y & 1][x & 1])
+                page[x] |= mask;
+        }
     }
+}
 #endif
 
 static void DrawStatus()
@@ -1202,7 +1669,21 @@ static void OnKeyDown(uint8_t key)
             UpdateCurrentFreq(false);
         break;
     case KEY_SIDE1:
+#ifdef ENABLE_FREQ_BLACKLIST
+        // held down: forget all blacklisted frequencies, once per hold
+        if (kbd.counter == 3)
+        {
+            keyOnRelease = KEY_SIDE1;
+        }
+        else if (keyOnRelease == KEY_SIDE1)
+        {
+            keyOnRelease = KEY_INVALID;
+            BLACKLIST_Clear();
+            ResetBlacklist();
+        }
+#else
         Blacklist();
+#endif
         break;
     case KEY_STAR:
         UpdateRssiTriggerLevel(true);
@@ -1236,6 +1717,20 @@ static void OnKeyDown(uint8_t key)
         TuneToPeak();
         break;
     case KEY_MENU:
+#ifdef ENABLE_SPECTRUM_TRACES
+        // held down: step the setting of the trace shown, once per hold
+        if (kbd.counter == 3)
+        {
+            keyOnRelease = KEY_MENU;
+        }
+        else if (keyOnRelease == KEY_MENU)
+        {
+            keyOnRelease = KEY_INVALID;
+            NextTraceSetting();
+        }
+#elif defined(ENABLE_SPECTRUM_WATERFALL)
+        ToggleWaterfall();
+#endif
         break;
     case KEY_EXIT:
         if (menuState)
@@ -1257,6 +1752,28 @@ static void OnKeyDown(uint8_t key)
     }
 }
 
+#if defined(ENABLE_FREQ_BLACKLIST) || defined(ENABLE_SPECTRUM_TRACES)
+// the short press of a key OnKeyDown left for its release
+static void OnKeyUp(KEY_Code_t key)
+{
+    switch (key)
+    {
+#ifdef ENABLE_FREQ_BLACKLIST
+    case KEY_SIDE1:
+        Blacklist();
+        break;
+#endif
+#ifdef ENABLE_SPECTRUM_TRACES
+    case KEY_MENU:
+        NextTraceView();
+        break;
+#endif
+    default:
+        break;
+    }
+}
+#endif
+
 static void OnKeyDownFreqInput(uint8_t key)
 {
     switch (key)
@@ -1400,12 +1917,43 @@ static void RenderStatus()
 
 static void RenderSpectrum()
 {
+#ifdef ENABLE_RSSI_LUT
+    UpdateSpectrumScale();
+#endif
     DrawTicks();
     DrawArrow(128u * peak.i / GetStepsCount());
     DrawSpectrum();
+#ifdef ENABLE_SPECTRUM_WATERFALL
+    if (waterfallMode)
+        DrawWaterfall();
+#endif
     DrawRssiTriggerLevel();
     DrawF(peak.f);
     DrawNums();
+#ifdef ENABLE_SPECTRUM_TRACES
+    if (settings.traceView != TRACE_LIVE && Spectrum_IsDisplayReady())
+    {
+        UI_SetFont(UI_FONT_5_TR);
+        if (settings.traceView == TRACE_AVG)
+            UI_DrawStringf(UI_TEXT_ALIGN_LEFT, 0, 0, 14, true, false, false,
+                           "AVG 1/%u", 1u << settings.traceAvgShift);
+        else if (settings.traceHoldDecay)
+            UI_DrawStringf(UI_TEXT_ALIGN_LEFT, 0, 0, 14, true, false, false,
+                           "%s %udB/s", traceNames[settings.traceView], 25u / settings.traceHoldDecay);
+        else
+            UI_DrawStringf(UI_TEXT_ALIGN_LEFT, 0, 0, 14, true, false, false,
+                           "%s HOLD", traceNames[settings.traceView]);
+    }
+#endif
+#ifdef ENABLE_SPECTRUM_RATE
+    // measured scan steps per second, under the modulation and frequency
+    if (!isListening && Spectrum_IsDisplayReady())
+    {
+        UI_SetFont(UI_FONT_5_TR);
+        UI_DrawStringf(UI_TEXT_ALIGN_RIGHT, 0, 127, 18, true, false, false,
+                       "%u ST/S", stepsPerSecond);
+    }
+#endif
 }
 
 static void RenderStill()
@@ -1521,6 +2069,14 @@ bool HandleUserInput()
     else
     {
         kbd.counter = 0;
+#if defined(ENABLE_FREQ_BLACKLIST) || defined(ENABLE_SPECTRUM_TRACES)
+        if (keyOnRelease != KEY_INVALID)
+        {
+            if (currentState == SPECTRUM)
+                OnKeyUp(keyOnRelease);
+            keyOnRelease = KEY_INVALID;
+        }
+#endif
     }
 
     if (kbd.counter == 3 || kbd.counter == 16)
@@ -1542,18 +2098,55 @@ bool HandleUserInput()
     return true;
 }
 
+#ifdef ENABLE_SPECTRUM_STREAM
+// the glitch and noise readings cost a bus read each, so only when asked for
+static void StreamSample()
+{
+    uint8_t noise = 0, glitch = 0;
+
+    if (gUART_StreamFields & UART_STREAM_NOISE)
+        noise = BK4819_GetExNoiceIndicator();
+    if (gUART_StreamFields & UART_STREAM_GLITCH)
+        glitch = BK4819_GetGlitchIndicator();
+
+    UART_StreamSample(scanInfo.i, scanInfo.f, scanInfo.scanStep, scanInfo.rssi, noise, glitch);
+}
+#endif
+
 static void Scan()
 {
     if (rssiHistory[scanInfo.i] != RSSI_MAX_VALUE
-#ifdef ENABLE_SCAN_RANGES
+#ifdef ENABLE_FREQ_BLACKLIST
+        && !BLACKLIST_Contains(scanInfo.f)
+#elif defined(ENABLE_SCAN_RANGES)
         && !IsBlacklisted(scanInfo.i)
 #endif
     )
     {
         SetF(scanInfo.f);
+#ifdef ENABLE_SPECTRUM_ADAPTIVE_SETTLE
+        scanRetuned = true;
+#endif
         Measure();
         UpdateScanInfo();
+#ifdef ENABLE_SPECTRUM_RATE
+        stepsMeasured++;
+#endif
+#ifdef ENABLE_SPECTRUM_STATS
+        gSpectrumStats.Steps++;
+#endif
+#ifdef ENABLE_SPECTRUM_STREAM
+        if (gUART_StreamFields)
+            StreamSample();
+#endif
     }
+#ifdef ENABLE_FREQ_BLACKLIST
+    else if (scanInfo.measurementsCount <= 128 && scanInfo.i < ARRAY_SIZE(rssiHistory))
+    {
+        // stored entries show as blacklisted bins in any view
+        rssiHistory[scanInfo.i] = RSSI_MAX_VALUE;
+    }
+#endif
 }
 
 static void NextScanStep()
@@ -1577,6 +2170,21 @@ static void UpdateScan()
         memset(&rssiHistory[scanInfo.measurementsCount], 0,
                sizeof(rssiHistory) - scanInfo.measurementsCount * sizeof(rssiHistory[0]));
 
+#ifdef ENABLE_SPECTRUM_STATS
+    gSpectrumStats.Sweeps++;
+#endif
+
+#ifdef ENABLE_SPECTRUM_STREAM
+    UART_StreamFlush(true);
+#endif
+#ifdef ENABLE_SPECTRUM_TRACES
+    UpdateTraces();
+#endif
+#ifdef ENABLE_SPECTRUM_WATERFALL
+    if (waterfallMode)
+        RecordWaterfall();
+#endif
+
     redrawScreen = true;
     preventKeypress = false;
 
@@ -1669,11 +2277,31 @@ static void Tick()
     }
 #endif
 
-#ifdef ENABLE_SCAN_RANGES
+#if defined(ENABLE_SPECTRUM_WATERFALL) || defined(ENABLE_SPECTRUM_TRACES)
+    if (gNextTimeslice40ms)
+    {
+        gNextTimeslice40ms = false;
+#ifdef ENABLE_SPECTRUM_TRACES
+        DecayTraces();
+#endif
+#ifdef ENABLE_SPECTRUM_WATERFALL
+        if (waterfallMode && currentState == SPECTRUM)
+            UpdateWaterfall();
+#endif
+    }
+#endif
+
+#if defined(ENABLE_SCAN_RANGES) || defined(ENABLE_SPECTRUM_RATE)
     if (gNextTimeslice_500ms)
     {
         gNextTimeslice_500ms = false;
 
+#ifdef ENABLE_SPECTRUM_RATE
+        stepsPerSecond = stepsMeasured * 2;
+        stepsMeasured = 0;
+#endif
+
+#ifdef ENABLE_SCAN_RANGES
         // if a lot of steps then it takes long time
         // we don't want to wait for whole scan
         // listening has it's own timer
@@ -1689,9 +2317,16 @@ static void Tick()
             redrawScreen = true;
             preventKeypress = false;
         }
+#endif
     }
 #endif
 
+#ifdef ENABLE_SPECTRUM_STREAM
+    // the main loop is not running, take the stream start/stop here
+    if (UART_IsCommandAvailable())
+        UART_HandleCommand();
+#endif
+
     if (!preventKeypress)
     {
         HandleUserInput();
@@ -40,6 +40,7 @@
 
 static const uint8_t DrawingEndY = 50;
 
+#ifndef ENABLE_RSSI_LUT
 static const uint8_t U8RssiMap[] = {
     121,
     115,
@@ -52,6 +53,7 @@ static const uint8_t U8RssiMap[] = {
     73,
     63,
 };
+#endif
 
 static const uint16_t scanStepValues[] = {
     1,
@@ -141,6 +143,16 @@ typedef enum ScanStep
     S_STEP_100_0kHz,
 } ScanStep;
 
+#ifdef ENABLE_SPECTRUM_TRACES
+typedef enum TraceType
+{
+    TRACE_LIVE,
+    TRACE_AVG,
+    TRACE_MAX,
+    TRACE_MIN,
+} TraceType;
+#endif
+
 typedef struct SpectrumSettings
 {
     uint32_t frequencyChangeStep;
@@ -154,6 +166,11 @@ typedef struct SpectrumSettings
     int dbMax;
     ModulationMode_t modulationType;
     bool backlightState;
+#ifdef ENABLE_SPECTRUM_TRACES
+    TraceType traceView;
+    uint8_t traceAvgShift;  // average weight of a new sweep: 1 / 2^shift
+    uint8_t traceHoldDecay; // 40 ms ticks per 1 dB of hold decay, 0 = hold forever
+#endif
 } SpectrumSettings;
 
 typedef struct KeyboardState
@@ -180,6 +197,15 @@ typedef struct PeakInfo
     uint16_t i;
 } PeakInfo;
 
+#ifdef ENABLE_SPECTRUM_STATS
+typedef struct {
+    uint32_t Sweeps;    // sweeps finished, each one a redraw
+    uint32_t Steps;     // frequencies tuned and measured
+} SpectrumStats_t;
+
+extern SpectrumStats_t gSpectrumStats;
+#endif
+
 void APP_RunSpectrum(void);
 
 #endif /* ifndef SPECTRUM_H */
@@ -38,6 +38,9 @@
 #include "driver/gpio.h"
 #include "driver/uart.h"
 #include "functions.h"
+#ifdef ENABLE_PROFILER
+    #include "helper/profiler.h"
+#endif
 #include "misc.h"
 #include "settings.h"
 #include "version.h"
@@ -110,6 +113,95 @@ typedef struct {
     } Data;
 } REPLY_051D_t;
 
+#ifdef ENABLE_UART_FAST_EEPROM
+// Fast EEPROM transfer for programming software. 0x0604 moves the session to
+// a faster baud rate (the reply still goes out at the old one), 0x0606 streams
+// a whole range back in CRC'd chunks, and 0x0608 writes whole 32-byte pages
+// with the layout of 0x051D. Its reply is sent before the pages are burned,
+// so the host can have the next frame on the wire during the write cycles,
+// and a failed burn is flagged in the next reply. An empty 0x0608 burns
+// nothing and reports the last frame: the host ends a transfer with one.
+// The rate falls back to 115200 when the session times out.
+#define FAST_MAX_BAUD       921600U
+#define FAST_READ_CHUNK     240U
+#define FAST_WRITE_MAX      224U    // 7 pages, the most a 256 byte frame holds
+
+#define FAST_OK             0x00
+#define FAST_REJECTED       0x01    // not whole pages, too long or out of range
+#define FAST_LOCKED         0x02
+#define FAST_BURN_FAILED    0x80    // the previous frame did not burn in
+
+typedef struct {
+    Header_t Header;
+    uint32_t Timestamp;
+    uint32_t Baud;
+} CMD_0604_t;
+
+typedef struct {
+    Header_t Header;
+    struct {
+        uint32_t Baud;      // 0 if refused, the rate stays as it was
+        uint16_t MaxRead;   // data bytes per 0x0607 chunk
+        uint8_t  MaxWrite;  // data bytes per 0x0608
+        uint8_t  PageSize;
+    } Data;
+} REPLY_0604_t;
+
+typedef struct {
+    Header_t Header;
+    uint16_t Offset;
+    uint16_t Size;
+    uint32_t Timestamp;
+} CMD_0606_t;
+
+typedef struct {
+    Header_t Header;
+    struct {
+        uint16_t Offset;
+        uint8_t  Size;
+        uint8_t  Padding;
+        uint16_t Crc;       // of Data
+        uint8_t  Data[FAST_READ_CHUNK];
+    } Data;
+} REPLY_0607_t;
+
+typedef struct {
+    Header_t Header;
+    struct {
+        uint16_t Offset;
+        uint8_t  Status;
+        uint8_t  Padding;
+    } Data;
+} REPLY_0609_t;
+#endif
+
+#ifdef ENABLE_UART_EEPROM_CRC
+// Block CRCs for incremental sync: the host compares them with its image and
+// writes only the blocks that differ. CRC-16/XMODEM of each block, from the
+// CRC unit, sent as a run of 0x060B replies.
+#define CRC_BLOCK_MAX       128U
+#define CRC_PER_REPLY       120U
+
+typedef struct {
+    Header_t Header;
+    uint16_t Offset;
+    uint16_t Size;
+    uint8_t  BlockSize; // multiple of 8, up to CRC_BLOCK_MAX
+    uint8_t  Padding[3];
+    uint32_t Timestamp;
+} CMD_060A_t;
+
+typedef struct {
+    Header_t Header;
+    struct {
+        uint16_t Offset;    // of the first block
+        uint8_t  BlockSize;
+        uint8_t  Count;
+        uint16_t Crc[CRC_PER_REPLY];
+    } Data;
+} REPLY_060B_t;
+#endif
+
 #ifdef ENABLE_EXTRA_UART_CMD
 typedef struct {
     Header_t Header;
@@ -171,6 +263,48 @@ static bool     bIsEncrypted = true;
 
 static bool sendScreenData = false;
 
+#ifdef ENABLE_UART_FAST_EEPROM
+static uint32_t gFastBaud;          // 0 while at UART_DEFAULT_BAUD
+static bool     gFastBurnFailed;
+#endif
+
+#ifdef ENABLE_SPECTRUM_STREAM
+// Spectrum stream frame, sent raw (no obfuscation) like the screen dump:
+// the header, then per sample one byte per selected field holding the
+// signed delta to the previous sample in the frame, or STREAM_ESCAPE and
+// the absolute value (2 bytes for RSSI, 1 for noise/glitch). The delta
+// base is 0 at the start of every frame, so frames decode on their own.
+// Samples in a frame are consecutive scan steps; a CRC of everything after
+// the marker closes the frame.
+#define STREAM_MARKER       0xEEAB
+#define STREAM_ESCAPE       0x80
+#define STREAM_MAX_SAMPLES  64
+#define STREAM_MAX_PAYLOAD  192
+#define STREAM_SAMPLE_MAX   7       // RSSI, noise and glitch all escaped
+
+typedef struct __attribute__((__packed__)) {
+    uint16_t Marker;
+    uint8_t  Seq;
+    uint8_t  Fields;        // UART_STREAM_* of the samples, plus UART_STREAM_LAST
+    uint16_t Sweep;
+    uint16_t Index;         // scan step of the first sample
+    uint32_t Frequency;     // of the first sample, 10 Hz units
+    uint16_t Step;          // between samples, 10 Hz units
+    uint8_t  Count;
+    uint8_t  Length;        // payload bytes
+} StreamHeader_t;
+
+static struct __attribute__((__packed__)) {
+    StreamHeader_t Header;
+    uint8_t        Payload[STREAM_MAX_PAYLOAD + 2];
+} gStreamFrame;
+
+uint8_t         gUART_StreamFields;
+static uint8_t  gStreamSeq;
+static uint16_t gStreamSweep;
+static uint16_t gStreamPrev[3];
+#endif
+
 static void SendReply(void *pReply, uint16_t Size)
 {
     Header_t Header;
@@ -335,10 +469,233 @@ static void CMD_051D(const uint8_t *pBuffer)
 
         if (bReloadEeprom)
             SETTINGS_InitEEPROM();
+#ifdef ENABLE_CHANNEL_INDEX
+        else
+            SETTINGS_RefreshChannelIndex(pCmd->Offset, pCmd->Size);
+#endif
+    }
+
+    SendReply(&Reply, sizeof(Reply));
+}
+
+#ifdef ENABLE_UART_FAST_EEPROM
+// switch the baud rate for the rest of the session
+static void CMD_0604(const uint8_t *pBuffer)
+{
+    const CMD_0604_t *pCmd = (const CMD_0604_t *)pBuffer;
+    REPLY_0604_t      Reply;
+    const bool        bOk = pCmd->Timestamp == Timestamp && pCmd->Baud >= UART_DEFAULT_BAUD && pCmd->Baud <= FAST_MAX_BAUD;
+
+    if (bOk)
+        gSerialConfigCountDown_500ms = 12; // 6 sec
+
+    Reply.Header.ID     = 0x0605;
+    Reply.Header.Size   = sizeof(Reply.Data);
+    Reply.Data.Baud     = bOk ? pCmd->Baud : 0;
+    Reply.Data.MaxRead  = FAST_READ_CHUNK;
+    Reply.Data.MaxWrite = FAST_WRITE_MAX;
+    Reply.Data.PageSize = EEPROM_PAGE_SIZE;
+
+    SendReply(&Reply, sizeof(Reply));
+
+    if (bOk) {
+        UART_SetBaudRate(pCmd->Baud);
+        gFastBaud = (pCmd->Baud == UART_DEFAULT_BAUD) ? 0 : pCmd->Baud;
+    }
+}
+
+// read a range of any length, sent back as a run of 0x0607 chunks
+static void CMD_0606(const uint8_t *pBuffer)
+{
+    const CMD_0606_t *pCmd = (const CMD_0606_t *)pBuffer;
+    REPLY_0607_t      Reply;
+    uint16_t          Offset = pCmd->Offset;
+    uint16_t          End;
+    bool              bLocked = false;
+
+    if (pCmd->Timestamp != Timestamp || Offset >= 0x2000)
+        return;
+
+    #ifdef ENABLE_FMRADIO
+        gFmRadioCountdown_500ms = fm_radio_countdown_500ms;
+    #endif
+
+    End = (pCmd->Size > 0x2000 - Offset) ? 0x2000 : Offset + pCmd->Size;
+
+    if (bHasCustomAesKey)
+        bLocked = gIsLocked;
+
+    while (Offset < End) {
+        const uint16_t Left = End - Offset;
+        const uint8_t  Size = (Left > FAST_READ_CHUNK) ? FAST_READ_CHUNK : Left;
+
+        gSerialConfigCountDown_500ms = 12; // 6 sec
+
+        Reply.Header.ID    = 0x0607;
+        Reply.Header.Size  = Size + 6;
+        Reply.Data.Offset  = Offset;
+        Reply.Data.Size    = Size;
+        Reply.Data.Padding = 0;
+
+        if (bLocked)
+            memset(Reply.Data.Data, 0, Size);
+        else
+            EEPROM_ReadBuffer(Offset, Reply.Data.Data, Size);
+
+        Reply.Data.Crc = CRC_Calculate(Reply.Data.Data, Size);
+
+        SendReply(&Reply, Size + 10);
+        Offset += Size;
     }
+}
+
+// write whole pages, acknowledged before they are burned
+static void CMD_0608(uint8_t *pBuffer)
+{
+    CMD_051D_t    *pCmd = (CMD_051D_t *)pBuffer;
+    REPLY_0609_t   Reply;
+    const uint16_t End  = pCmd->Offset + pCmd->Size;
+    bool           bIsLocked;
+
+    if (pCmd->Timestamp != Timestamp)
+        return;
+
+    gSerialConfigCountDown_500ms = 12; // 6 sec
+
+    #ifdef ENABLE_FMRADIO
+        gFmRadioCountdown_500ms = fm_radio_countdown_500ms;
+    #endif
+
+    bIsLocked = bHasCustomAesKey ? gIsLocked : bHasCustomAesKey;
+
+    Reply.Header.ID    = 0x0609;
+    Reply.Header.Size  = sizeof(Reply.Data);
+    Reply.Data.Offset  = pCmd->Offset;
+    Reply.Data.Padding = 0;
+
+    if (bIsLocked)
+        Reply.Data.Status = FAST_LOCKED;
+    else if (((pCmd->Offset | pCmd->Size) & (EEPROM_PAGE_SIZE - 1)) || pCmd->Size > FAST_WRITE_MAX ||
+             pCmd->Header.Size < pCmd->Size + 8u || End > 0x2000)
+        Reply.Data.Status = FAST_REJECTED;
+    else
+        Reply.Data.Status = FAST_OK;
+
+    if (gFastBurnFailed)
+        Reply.Data.Status |= FAST_BURN_FAILED;
+    gFastBurnFailed = false;
 
     SendReply(&Reply, sizeof(Reply));
+
+    // an empty frame only asks how the last one went
+    if ((Reply.Data.Status & ~FAST_BURN_FAILED) != FAST_OK || pCmd->Size == 0)
+        return;
+
+    // the lock screen password stays as it is unless the host may change it,
+    // it sits inside one page so a frame holding it starts at or before it
+    if (bIsInLockScreen && !pCmd->bAllowPassword && pCmd->Offset < 0x0EA0 && End > 0x0E98)
+        EEPROM_ReadBuffer(0x0E98, &pCmd->Data[0x0E98 - pCmd->Offset], 8);
+
+    if (!EEPROM_WritePages(pCmd->Offset, pCmd->Data, pCmd->Size))
+        gFastBurnFailed = true;
+
+    if (pCmd->Offset < 0x0F40 && End > 0x0F30 && !gIsLocked)
+        SETTINGS_InitEEPROM();
+#ifdef ENABLE_CHANNEL_INDEX
+    else
+        SETTINGS_RefreshChannelIndex(pCmd->Offset, pCmd->Size);
+#endif
+}
+#endif
+
+#ifdef ENABLE_UART_EEPROM_CRC
+// CRCs of the blocks covering a range, in 0x060B replies
+static void CMD_060A(const uint8_t *pBuffer)
+{
+    const CMD_060A_t *pCmd = (const CMD_060A_t *)pBuffer;
+    REPLY_060B_t      Reply;
+    uint16_t          Offset = pCmd->Offset;
+    uint16_t          End;
+    bool              bLocked = false;
+
+    if (pCmd->Timestamp != Timestamp || Offset >= 0x2000)
+        return;
+    if (pCmd->BlockSize == 0 || (pCmd->BlockSize & 7) || pCmd->BlockSize > CRC_BLOCK_MAX)
+        return;
+
+    #ifdef ENABLE_FMRADIO
+        gFmRadioCountdown_500ms = fm_radio_countdown_500ms;
+    #endif
+
+    End = (pCmd->Size > 0x2000 - Offset) ? 0x2000 : Offset + pCmd->Size;
+
+    if (bHasCustomAesKey)
+        bLocked = gIsLocked;
+
+    while (Offset < End) {
+        uint8_t Count = 0;
+
+        gSerialConfigCountDown_500ms = 12; // 6 sec
+
+        Reply.Header.ID      = 0x060B;
+        Reply.Data.Offset    = Offset;
+        Reply.Data.BlockSize = pCmd->BlockSize;
+
+        while (Offset < End && Count < CRC_PER_REPLY) {
+            const uint16_t Left = End - Offset;
+            const uint8_t  Size = (Left > pCmd->BlockSize) ? pCmd->BlockSize : Left;
+            uint8_t        Block[CRC_BLOCK_MAX];
+
+            // like 0x051B, a locked radio shows zeros
+            if (bLocked)
+                memset(Block, 0, Size);
+            else
+                EEPROM_ReadBuffer(Offset, Block, Size);
+
+            Reply.Data.Crc[Count++] = CRC_Calculate(Block, Size);
+            Offset += Size;
+        }
+
+        Reply.Data.Count  = Count;
+        Reply.Header.Size = 4 + Count * 2;
+
+        SendReply(&Reply, 8 + Count * 2);
+    }
 }
+#endif
+
+#ifdef ENABLE_UART_TX_QUEUE
+// TX queue statistics, optionally clearing them afterwards
+static void CMD_060C(const uint8_t *pBuffer)
+{
+    typedef struct __attribute__((__packed__)) {
+        Header_t header;
+        uint8_t  reset;
+    } CMD_060C_t;
+
+    const CMD_060C_t *cmd = (const CMD_060C_t *)pBuffer;
+
+    struct __attribute__((__packed__)) {
+        Header_t       header;
+        struct __attribute__((__packed__)) {
+            uint16_t       queueSize;
+            uint8_t        padding[2];
+            UART_TxStats_t stats;
+        } data;
+    } reply;
+
+    reply.header.ID      = 0x060D;
+    reply.header.Size    = sizeof(reply.data);
+    reply.data.queueSize = UART_TX_QUEUE_SIZE;
+    memset(reply.data.padding, 0, sizeof(reply.data.padding));
+    memcpy(&reply.data.stats, &gUART_TxStats, sizeof(reply.data.stats));
+
+    if (cmd->reset)
+        memset(&gUART_TxStats, 0, sizeof(gUART_TxStats));
+
+    SendReply(&reply, sizeof(reply));
+}
+#endif
 
 #ifdef ENABLE_EXTRA_UART_CMD
 // read RSSI
@@ -490,158 +847,389 @@ static void CMD_0602_WriteBK4819Reg(const uint8_t *pBuffer)
 }
 #endif
 
-#if defined(ENABLE_MESSENGER) || defined(ENABLE_MESSENGER_UART)
-void remove(char cstring[], char letter) {
-    for(int i = 0; cstring[i] != '\0'; i++) {
-        if(cstring[i] == letter) cstring[i] = '\0';
-    } 
-}
-bool findchar(uint8_t start, char letter) {
-    for(int i = start; UART_DMA_Buffer[i] != '\0'; i++) {
-        if(UART_DMA_Buffer[i] == letter) return true;
-    } 
-	return false;
-}
+#ifdef ENABLE_PROFILER
+// profiler report, optionally clearing the table afterwards
+static void CMD_0603_ReadProfiler(const uint8_t *pBuffer)
+{
+    typedef struct __attribute__((__packed__)) {
+        Header_t header;
+        uint8_t  reset;
+    } CMD_0603_t;
 
-uint8_t txtStart = 0;
-bool newTxtMsg = false;
+    const CMD_0603_t *cmd = (const CMD_0603_t *)pBuffer;
 
+    struct __attribute__((__packed__)) {
+        Header_t header;
+        struct __attribute__((__packed__)) {
+            uint32_t         cyclesPerSlice;
+            uint8_t          count;
+            uint8_t          padding[3];
+            PROFILER_Entry_t entries[PROFILER_PROBE_COUNT];
+        } data;
+    } reply;
+
+    reply.header.ID           = 0x0603;
+    reply.header.Size         = sizeof(reply.data);
+    reply.data.cyclesPerSlice = PROFILER_CYCLES_PER_SLICE;
+    reply.data.count          = PROFILER_PROBE_COUNT;
+    memset(reply.data.padding, 0, sizeof(reply.data.padding));
+    memcpy(reply.data.entries, gProfilerTable, sizeof(reply.data.entries));
+
+    if (cmd->reset)
+        PROFILER_Reset();
+
+    SendReply(&reply, sizeof(reply));
+}
 #endif
 
-bool UART_IsCommandAvailable(void)
-{
-    uint16_t Index;
-    uint16_t TailIndex;
-    uint16_t Size;
-    uint16_t CRC;
-    uint16_t CommandLength;
-    uint16_t DmaLength = DMA_CH0->ST & 0xFFFU;
+// Frames are parsed a byte at a time as the DMA brings them in, so every
+// byte is looked at once however the frame is split across calls. Payload
+// bytes are de-obfuscated and CRC'd on the way into UART_Command; the ring
+// itself is never copied or cleared.
+typedef enum {
+    PARSE_IDLE,             // looking for 0xAB (or the 'S' of "SMS:")
+    PARSE_MARKER,           // 0xCD
+    PARSE_SIZE_LO,
+    PARSE_SIZE_HI,
+    PARSE_PAYLOAD,          // Size bytes, then the CRC
+    PARSE_FOOTER_DC,
+    PARSE_FOOTER_BA,
+#if defined(ENABLE_MESSENGER) || defined(ENABLE_MESSENGER_UART)
+    PARSE_SMS_PREFIX,       // rest of "SMS:"
+    PARSE_SMS_TEXT,         // up to the end of the line
+#endif
+} ParseState_t;
 
-    while (1)
-    {
-        if (gUART_WriteIndex == DmaLength)
-            return false;
+static struct {
+    ParseState_t State;
+    uint16_t     Size;
+    uint16_t     Index;     // payload bytes so far, prefix characters for SMS
+    uint16_t     Crc;
+} gParser;
 
 #if defined(ENABLE_MESSENGER) || defined(ENABLE_MESSENGER_UART)
+#ifdef ENABLE_MESSENGER_LONG
+static char gSmsLine[MSG_LONG_LENGTH + 1];
+#else
+static char gSmsLine[TX_MSG_LENGTH + 1];
+#endif
+#endif
 
-		if ( UART_DMA_Buffer[gUART_WriteIndex] == 'S' && UART_DMA_Buffer[gUART_WriteIndex + 1] == 'M' && UART_DMA_Buffer[ gUART_WriteIndex + 2] == 'S' && UART_DMA_Buffer[gUART_WriteIndex + 3] == ':') {
-			txtStart = gUART_WriteIndex;
-			newTxtMsg = true;
-			//UART_printf("1:%s\r\n", &UART_DMA_Buffer[txtStart]);
-		}
-
-		if (findchar(txtStart, '\n') && newTxtMsg) {
-			//UART_printf("2:%s\r\n", &UART_DMA_Buffer[txtStart]);
-			char txMessage[TX_MSG_LENGTH + 4];
-			memset(txMessage, 0, sizeof(txMessage));
-			snprintf(txMessage, (TX_MSG_LENGTH + 4), "%s", &UART_DMA_Buffer[txtStart + 4]);
-
-			remove(txMessage, '\n');
-			remove(txMessage, '\r');      
-
-			if (strlen(txMessage) > 0) {        
-				MSG_Send(txMessage, false);
-				UART_printf("SMS>%s\r\n", txMessage);
-				gUpdateDisplay = true;
-			}
-			newTxtMsg = false;
-			txtStart = 0;
-			memset(UART_DMA_Buffer, 0, sizeof(UART_DMA_Buffer));
-			gUART_WriteIndex = 0;
-			return false;			
-		}
-		
-		while (gUART_WriteIndex != DmaLength && UART_DMA_Buffer[gUART_WriteIndex] != 0xABU && UART_DMA_Buffer[gUART_WriteIndex] != 'S')
-			gUART_WriteIndex = DMA_INDEX(gUART_WriteIndex, 1);
-#else  
-		while (gUART_WriteIndex != DmaLength && UART_DMA_Buffer[gUART_WriteIndex] != 0xABU)
-			gUART_WriteIndex = DMA_INDEX(gUART_WriteIndex, 1);
-#endif
-
-        if (gUART_WriteIndex == DmaLength)
-            return false;
-
-        if (gUART_WriteIndex < DmaLength)
-            CommandLength = DmaLength - gUART_WriteIndex;
-        else
-            CommandLength = (DmaLength + sizeof(UART_DMA_Buffer)) - gUART_WriteIndex;
+// CRC-16/XMODEM a nibble at a time, the same as the CRC unit computes
+static uint16_t CrcUpdate(uint16_t Crc, uint8_t Byte)
+{
+    static const uint16_t Table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
 
-        if (CommandLength < 8)
-            return 0;
+    Crc = (Crc << 4) ^ Table[(Crc >> 12) ^ (Byte >> 4)];
+    Crc = (Crc << 4) ^ Table[(Crc >> 12) ^ (Byte & 0x0F)];
+    return Crc;
+}
 
-        if (UART_DMA_Buffer[DMA_INDEX(gUART_WriteIndex, 1)] == 0xCD)
-            break;
+static void ParseIdle(uint8_t Byte)
+{
+    gParser.State = PARSE_IDLE;
 
-        gUART_WriteIndex = DMA_INDEX(gUART_WriteIndex, 1);
+    if (Byte == 0xAB)
+        gParser.State = PARSE_MARKER;
+#if defined(ENABLE_MESSENGER) || defined(ENABLE_MESSENGER_UART)
+    else if (Byte == 'S')
+    {
+        gParser.State = PARSE_SMS_PREFIX;
+        gParser.Index = 1;
     }
+#endif
+}
+
+static void ParsePayload(uint8_t Byte)
+{
+    const uint16_t i = gParser.Index++;
 
-    Index = DMA_INDEX(gUART_WriteIndex, 2);
-    Size  = (UART_DMA_Buffer[DMA_INDEX(Index, 1)] << 8) | UART_DMA_Buffer[Index];
+    UART_Command.Buffer[i] = Byte;
 
-    if ((Size + 8u) > sizeof(UART_DMA_Buffer))
+    // the raw command ID decides whether this frame and the ones after it
+    // are obfuscated, so the first two bytes are decoded together
+    if (i == 1)
     {
-        gUART_WriteIndex = DmaLength;
-        return false;
-    }
+        const uint16_t ID = UART_Command.Buffer[0] | (Byte << 8);
+
+        if (ID == 0x0514)
+            bIsEncrypted = false;
+        if (ID == 0x6902)
+            bIsEncrypted = true;
 
-    if (CommandLength < (Size + 8))
-        return false;
+        if (bIsEncrypted)
+        {
+            UART_Command.Buffer[0] ^= Obfuscation[0];
+            UART_Command.Buffer[1] ^= Obfuscation[1];
+        }
+        gParser.Crc = CrcUpdate(CrcUpdate(0, UART_Command.Buffer[0]), UART_Command.Buffer[1]);
+    }
+    else if (i > 1)
+    {
+        if (bIsEncrypted)
+            UART_Command.Buffer[i] ^= Obfuscation[i % 16];
+        if (i < gParser.Size)
+            gParser.Crc = CrcUpdate(gParser.Crc, UART_Command.Buffer[i]);
+    }
 
-    Index     = DMA_INDEX(Index, 2);
-    TailIndex = DMA_INDEX(Index, Size + 2);
+    if (gParser.Index == gParser.Size + 2u)
+        gParser.State = PARSE_FOOTER_DC;
+}
 
-    if (UART_DMA_Buffer[TailIndex] != 0xDC || UART_DMA_Buffer[DMA_INDEX(TailIndex, 1)] != 0xBA)
+#if defined(ENABLE_MESSENGER) || defined(ENABLE_MESSENGER_UART)
+static void ParseSms(uint8_t Byte)
+{
+    if (gParser.State == PARSE_SMS_PREFIX)
     {
-        gUART_WriteIndex = DmaLength;
-        return false;
+        if (Byte != "SMS:"[gParser.Index])
+        {
+            ParseIdle(Byte);
+            return;
+        }
+        if (++gParser.Index == 4)
+        {
+            gParser.State = PARSE_SMS_TEXT;
+            gParser.Index = 0;
+        }
+        return;
     }
 
-    if (TailIndex < Index)
+    if (Byte != '\r' && Byte != '\n')
     {
-        const uint16_t ChunkSize = sizeof(UART_DMA_Buffer) - Index;
-        memcpy(UART_Command.Buffer, UART_DMA_Buffer + Index, ChunkSize);
-        memcpy(UART_Command.Buffer + ChunkSize, UART_DMA_Buffer, TailIndex);
+        // longer lines are cut to what a message holds
+        if (gParser.Index < sizeof(gSmsLine) - 1)
+            gSmsLine[gParser.Index++] = Byte;
+        return;
     }
+
+    gParser.State = PARSE_IDLE;
+    if (gParser.Index == 0)
+        return;
+
+    gSmsLine[gParser.Index] = 0;
+    if (MSG_Send(gSmsLine, false))
+        UART_printf("SMS>%s\r\n", gSmsLine);
     else
-        memcpy(UART_Command.Buffer, UART_DMA_Buffer + Index, TailIndex - Index);
+        UART_printf("SVC<BUSY\r\n");     // queue full or no TX here, send it again later
+    gUpdateDisplay = true;
+}
+#endif
+
+bool UART_IsCommandAvailable(void)
+{
+    const uint16_t DmaLength = DMA_CH0->ST & 0xFFFU;
 
-    TailIndex = DMA_INDEX(TailIndex, 2);
-    if (TailIndex < gUART_WriteIndex)
+#ifdef ENABLE_UART_FAST_EEPROM
+    // the session timed out, go back to the rate a fresh host expects
+    if (gFastBaud && !SerialConfigInProgress())
     {
-        memset(UART_DMA_Buffer + gUART_WriteIndex, 0, sizeof(UART_DMA_Buffer) - gUART_WriteIndex);
-        memset(UART_DMA_Buffer, 0, TailIndex);
+        UART_SetBaudRate(UART_DEFAULT_BAUD);
+        gFastBaud = 0;
     }
-    else
-        memset(UART_DMA_Buffer + gUART_WriteIndex, 0, TailIndex - gUART_WriteIndex);
+#endif
 
-    gUART_WriteIndex = TailIndex;
+    while (gUART_WriteIndex != DmaLength)
+    {
+        const uint8_t Byte = UART_DMA_Buffer[gUART_WriteIndex];
 
-    if (UART_Command.Header.ID == 0x0514)
-        bIsEncrypted = false;
+        gUART_WriteIndex = DMA_INDEX(gUART_WriteIndex, 1);
 
-    if (UART_Command.Header.ID == 0x6902)
-        bIsEncrypted = true;
+        switch (gParser.State)
+        {
+            case PARSE_IDLE:
+                ParseIdle(Byte);
+                break;
 
-    if (bIsEncrypted)
-    {
-        unsigned int i;
-        for (i = 0; i < (Size + 2u); i++)
-            UART_Command.Buffer[i] ^= Obfuscation[i % 16];
+            case PARSE_MARKER:
+                if (Byte == 0xCD)
+                    gParser.State = PARSE_SIZE_LO;
+                else
+                    ParseIdle(Byte);
+                break;
+
+            case PARSE_SIZE_LO:
+                gParser.Size  = Byte;
+                gParser.State = PARSE_SIZE_HI;
+                break;
+
+            case PARSE_SIZE_HI:
+                gParser.Size |= Byte << 8;
+                gParser.Index = 0;
+                // too long for the ring (and UART_Command), or no room for a header
+                if ((gParser.Size + 8u) > sizeof(UART_DMA_Buffer) || gParser.Size < sizeof(Header_t))
+                    gParser.State = PARSE_IDLE;
+                else
+                    gParser.State = PARSE_PAYLOAD;
+                break;
+
+            case PARSE_PAYLOAD:
+                ParsePayload(Byte);
+                break;
+
+            case PARSE_FOOTER_DC:
+                if (Byte == 0xDC)
+                    gParser.State = PARSE_FOOTER_BA;
+                else
+                    ParseIdle(Byte);
+                break;
+
+            case PARSE_FOOTER_BA:
+                if (Byte != 0xBA)
+                {
+                    ParseIdle(Byte);
+                    break;
+                }
+                gParser.State = PARSE_IDLE;
+                if (gParser.Crc == (UART_Command.Buffer[gParser.Size] | (UART_Command.Buffer[gParser.Size + 1] << 8)))
+                    return true;
+                break;
+
+#if defined(ENABLE_MESSENGER) || defined(ENABLE_MESSENGER_UART)
+            case PARSE_SMS_PREFIX:
+            case PARSE_SMS_TEXT:
+                ParseSms(Byte);
+                break;
+#endif
+        }
     }
-    
-    CRC = UART_Command.Buffer[Size] | (UART_Command.Buffer[Size + 1] << 8);
 
-    return (CRC_Calculate(UART_Command.Buffer, Size) != CRC) ? false : true;
+    return false;
 }
 
-void sendScreenBuffer(const void* buffer, uint32_t size) {
+#ifdef ENABLE_UART_TX_QUEUE
+// Frames go out straight from the frame buffer. One that comes while the
+// previous frame is still on the wire waits here for the 10 ms slice to
+// send it; the frames drawn in between are merged into it.
+static const void *gScreenPending;
+static uint16_t    gScreenPendingSize;
+
+void UART_SendPendingScreen(void)
+{
     const uint16_t screenDumpIdByte = 0xEDAB;
+
+    if (gScreenPending == NULL || UART_TxInPlaceBusy())
+        return;
+
+    if (!sendScreenData || UART_SendInPlace(&screenDumpIdByte, 2, gScreenPending, gScreenPendingSize))
+        gScreenPending = NULL;
+}
+#endif
+
+void sendScreenBuffer(const void* buffer, uint32_t size) {
     if (sendScreenData) {
+#ifdef ENABLE_UART_TX_QUEUE
+        gScreenPending     = buffer;
+        gScreenPendingSize = size;
+        UART_SendPendingScreen();
+#else
+        const uint16_t screenDumpIdByte = 0xEDAB;
         UART_Send(&screenDumpIdByte, 2);
         UART_Send(buffer, size);
+#endif
     }
 }
 
+#ifdef ENABLE_SPECTRUM_STREAM
+static uint8_t *StreamPutDelta(uint8_t *p, uint16_t value, uint16_t *pPrev, bool wide)
+{
+    const int16_t delta = (int16_t)(value - *pPrev);
+
+    *pPrev = value;
+    if (delta > -128 && delta < 128) {
+        *p++ = (uint8_t)delta;
+        return p;
+    }
+
+    *p++ = STREAM_ESCAPE;
+    *p++ = value & 0xFF;
+    if (wide)
+        *p++ = value >> 8;
+    return p;
+}
+
+void UART_StreamSample(uint16_t index, uint32_t frequency, uint16_t step, uint16_t rssi, uint8_t noise, uint8_t glitch)
+{
+    StreamHeader_t *pHeader = &gStreamFrame.Header;
+    uint8_t        *p;
+
+    if (!gUART_StreamFields)
+        return;
+
+    // a full frame or a skipped (blacklisted) step starts a new frame; a full
+    // frame is held until here so the last one of a sweep carries the flag
+    if (pHeader->Count && (index != pHeader->Index + pHeader->Count ||
+                           pHeader->Count == STREAM_MAX_SAMPLES ||
+                           pHeader->Length > STREAM_MAX_PAYLOAD - STREAM_SAMPLE_MAX))
+        UART_StreamFlush(false);
+
+    if (pHeader->Count == 0) {
+        pHeader->Index     = index;
+        pHeader->Frequency = frequency;
+        pHeader->Step      = step;
+        pHeader->Length    = 0;
+        memset(gStreamPrev, 0, sizeof(gStreamPrev));
+    }
+
+    p = gStreamFrame.Payload + pHeader->Length;
+    if (gUART_StreamFields & UART_STREAM_RSSI)
+        p = StreamPutDelta(p, rssi, &gStreamPrev[0], true);
+    if (gUART_StreamFields & UART_STREAM_NOISE)
+        p = StreamPutDelta(p, noise, &gStreamPrev[1], false);
+    if (gUART_StreamFields & UART_STREAM_GLITCH)
+        p = StreamPutDelta(p, glitch, &gStreamPrev[2], false);
+
+    pHeader->Length = p - gStreamFrame.Payload;
+    pHeader->Count++;
+}
+
+void UART_StreamFlush(bool endOfSweep)
+{
+    StreamHeader_t *pHeader = &gStreamFrame.Header;
+    uint16_t        crc;
+
+    if (!gUART_StreamFields || (pHeader->Count == 0 && !endOfSweep))
+        return;
+
+    if (pHeader->Count == 0)
+        pHeader->Length = 0;
+
+    pHeader->Marker = STREAM_MARKER;
+    pHeader->Seq    = gStreamSeq++;
+    pHeader->Fields = gUART_StreamFields | (endOfSweep ? UART_STREAM_LAST : 0);
+    pHeader->Sweep  = gStreamSweep;
+
+    crc = CRC_Calculate(&pHeader->Seq, sizeof(*pHeader) - sizeof(pHeader->Marker) + pHeader->Length);
+    gStreamFrame.Payload[pHeader->Length]     = crc & 0xFF;
+    gStreamFrame.Payload[pHeader->Length + 1] = crc >> 8;
+
+    UART_Send(&gStreamFrame, sizeof(*pHeader) + pHeader->Length + 2);
+
+    pHeader->Count = 0;
+    if (endOfSweep)
+        gStreamSweep++;
+}
+
+// start the spectrum stream with the given sample fields (RSSI if none)
+static void CMD_0A05_StartStream(const uint8_t *pBuffer)
+{
+    typedef struct __attribute__((__packed__)) {
+        Header_t header;
+        uint8_t  fields;
+    } CMD_0A05_t;
+
+    const CMD_0A05_t *cmd = (const CMD_0A05_t *)pBuffer;
+    const uint8_t fields = cmd->header.Size ? cmd->fields & (UART_STREAM_RSSI | UART_STREAM_NOISE | UART_STREAM_GLITCH) : 0;
+
+    gUART_StreamFields = fields ? fields : UART_STREAM_RSSI;
+    gStreamFrame.Header.Count = 0;
+    gStreamSeq = 0;
+    gStreamSweep = 0;
+}
+#endif
+
 void UART_HandleCommand(void)
 {
     switch (UART_Command.Header.ID)
@@ -685,6 +1273,9 @@ void UART_HandleCommand(void)
 #endif
     
         case 0x05DD: // reset
+            #ifdef ENABLE_EEPROM_WRITE_CACHE
+                EEPROM_Flush();
+            #endif
             #if defined(ENABLE_OVERLAY)
                 overlay_FLASH_RebootToBootloader();
             #else
@@ -700,6 +1291,34 @@ void UART_HandleCommand(void)
         case 0x0602:
             CMD_0602_WriteBK4819Reg(UART_Command.Buffer);
             break;
+#endif
+#ifdef ENABLE_PROFILER
+        case 0x0603:
+            CMD_0603_ReadProfiler(UART_Command.Buffer);
+            break;
+#endif
+#ifdef ENABLE_UART_FAST_EEPROM
+        case 0x0604:
+            CMD_0604(UART_Command.Buffer);
+            break;
+
+        case 0x0606:
+            CMD_0606(UART_Command.Buffer);
+            break;
+
+        case 0x0608:
+            CMD_0608(UART_Command.Buffer);
+            break;
+#endif
+#ifdef ENABLE_UART_EEPROM_CRC
+        case 0x060A:
+            CMD_060A(UART_Command.Buffer);
+            break;
+#endif
+#ifdef ENABLE_UART_TX_QUEUE
+        case 0x060C:
+            CMD_060C(UART_Command.Buffer);
+            break;
 #endif
         case 0x0A03:
             sendScreenData = true;
@@ -707,6 +1326,14 @@ void UART_HandleCommand(void)
         case 0x0A04:
             sendScreenData = false;
             break;            
+#ifdef ENABLE_SPECTRUM_STREAM
+        case 0x0A05:
+            CMD_0A05_StartStream(UART_Command.Buffer);
+            break;
+        case 0x0A06:
+            gUART_StreamFields = 0;
+            break;
+#endif
         
     }
     #ifdef ENABLE_FEAT_F4HWN_SCREENSHOT
@@ -18,11 +18,28 @@
 #define APP_UART_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 bool UART_IsCommandAvailable(void);
 void UART_HandleCommand(void);
 
 void sendScreenBuffer(const void* buffer, uint32_t size);
+#ifdef ENABLE_UART_TX_QUEUE
+void UART_SendPendingScreen(void);
+#endif
+
+#ifdef ENABLE_SPECTRUM_STREAM
+// sample fields selected by command 0x0A05, 0 while the stream is off
+#define UART_STREAM_RSSI    0x01
+#define UART_STREAM_NOISE   0x02
+#define UART_STREAM_GLITCH  0x04
+#define UART_STREAM_LAST    0x80    // frame flag: last frame of the sweep
+
+extern uint8_t gUART_StreamFields;
+
+void UART_StreamSample(uint16_t index, uint32_t frequency, uint16_t step, uint16_t rssi, uint8_t noise, uint8_t glitch);
+void UART_StreamFlush(bool endOfSweep);
+#endif
 
 #endif
 
@@ -39,6 +39,33 @@ static uint16_t gBK4819_GpioOutState;
 
 bool gRxIdleMode;
 
+// Shadow copy of the BK4819 register file. Writes that would not change the
+// chip state are dropped, and reads of plain configuration registers (the
+// read-modify-write helpers) are answered from RAM instead of the bus.
+static uint16_t gShadowRegs[0x80];
+static uint32_t gShadowValid[0x80 / 32];
+
+// Registers that must always go out on the bus: status/indicator registers
+// the chip updates by itself, FIFOs, indexed tables and write-to-act strobes
+//
+//   0x00 soft reset        0x02 interrupt status/clear     0x06, 0x08, 0x09 indexed
+//   0x0A ~ 0x0F status     0x59 FIFO clear strobes          0x5E, 0x5F FSK FIFO
+//   0x60 ~ 0x6F indicators 0x7E AGC index read back in auto mode
+//
+static const uint32_t gShadowVolatile[0x80 / 32] = {
+    0x0000FF45,     // 0x00 ~ 0x1F
+    0x00000000,     // 0x20 ~ 0x3F
+    0xC2000000,     // 0x40 ~ 0x5F
+    0x4000FFFF,     // 0x60 ~ 0x7F
+};
+
+#ifdef ENABLE_BK4819_BUS_STATS
+    BK4819_BusStats_t gBK4819_BusStats;
+    #define BUS_STATS_INC(field) (gBK4819_BusStats.field++)
+#else
+    #define BUS_STATS_INC(field)
+#endif
+
 #ifdef ENABLE_DTMF
 static const uint8_t DTMF_TONE1_GAIN = 65;
 static const uint8_t DTMF_TONE2_GAIN = 93;
@@ -103,6 +130,8 @@ static inline uint16_t scale_freq(const uint16_t freq)
 
 void BK4819_Init(void)
 {
+    BK4819_InvalidateShadow();
+
     GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_BK4819_SCN);
     GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_BK4819_SCL);
     GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_BK4819_SDA);
@@ -177,6 +206,7 @@ void BK4819_Init(void)
     BK4819_WriteRegister(BK4819_REG_3F, 0);
 }
 
+#ifndef ENABLE_SIMULATOR
 static uint16_t BK4819_ReadU16(void)
 {
     unsigned int i;
@@ -201,7 +231,7 @@ static uint16_t BK4819_ReadU16(void)
     return Value;
 }
 
-uint16_t BK4819_ReadRegister(BK4819_REGISTER_t Register)
+static uint16_t BK4819_BusRead(BK4819_REGISTER_t Register)
 {
     uint16_t Value;
 
@@ -223,7 +253,7 @@ uint16_t BK4819_ReadRegister(BK4819_REGISTER_t Register)
     return Value;
 }
 
-void BK4819_WriteRegister(BK4819_REGISTER_t Register, uint16_t Data)
+static void BK4819_BusWrite(BK4819_REGISTER_t Register, uint16_t Data)
 {
     GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_BK4819_SCN);
     GPIO_ClearBit(&GPIOC->DATA, GPIOC_PIN_BK4819_SCL);
@@ -246,6 +276,66 @@ void BK4819_WriteRegister(BK4819_REGISTER_t Register, uint16_t Data)
     GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_BK4819_SCL);
     GPIO_SetBit(&GPIOC->DATA, GPIOC_PIN_BK4819_SDA);
 }
+#else
+// provided by the register model in sim/bk4819.c
+uint16_t BK4819_BusRead(BK4819_REGISTER_t Register);
+void     BK4819_BusWrite(BK4819_REGISTER_t Register, uint16_t Data);
+#endif
+
+static inline bool BK4819_IsVolatile(BK4819_REGISTER_t Register)
+{
+    return (Register >= 0x80) || (gShadowVolatile[Register >> 5] & (1u << (Register & 31u)));
+}
+
+static inline bool BK4819_IsShadowValid(BK4819_REGISTER_t Register)
+{
+    return gShadowValid[Register >> 5] & (1u << (Register & 31u));
+}
+
+void BK4819_InvalidateShadow(void)
+{
+    for (unsigned int i = 0; i < ARRAY_SIZE(gShadowValid); i++)
+        gShadowValid[i] = 0;
+}
+
+uint16_t BK4819_ReadRegister(BK4819_REGISTER_t Register)
+{
+    if (BK4819_IsVolatile(Register)) {
+        BUS_STATS_INC(Reads);
+        return BK4819_BusRead(Register);
+    }
+
+    if (BK4819_IsShadowValid(Register)) {
+        BUS_STATS_INC(ReadHits);
+        return gShadowRegs[Register];
+    }
+
+    BUS_STATS_INC(Reads);
+    gShadowRegs[Register] = BK4819_BusRead(Register);
+    gShadowValid[Register >> 5] |= 1u << (Register & 31u);
+
+    return gShadowRegs[Register];
+}
+
+void BK4819_WriteRegister(BK4819_REGISTER_t Register, uint16_t Data)
+{
+    if (Register == BK4819_REG_00) {
+        // soft reset puts every register back to its power-on value
+        BK4819_InvalidateShadow();
+    }
+    else if (!BK4819_IsVolatile(Register)) {
+        if (BK4819_IsShadowValid(Register) && gShadowRegs[Register] == Data) {
+            BUS_STATS_INC(WritesSkipped);
+            return;
+        }
+
+        gShadowRegs[Register] = Data;
+        gShadowValid[Register >> 5] |= 1u << (Register & 31u);
+    }
+
+    BUS_STATS_INC(Writes);
+    BK4819_BusWrite(Register, Data);
+}
 
 void BK4819_WriteU8(uint8_t Data)
 {
@@ -1685,6 +1775,72 @@ uint8_t BK4819_GetCTCType(void)
     return (BK4819_ReadRegister(BK4819_REG_0C) >> 10) & 3u;
 }
 
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+// Single producer / single consumer ring of interrupt records. Only the
+// producer moves gIrqHead and only the consumer moves gIrqTail, so either
+// side may run from an interrupt without locking.
+static BK4819_IrqEvent_t gIrqQueue[BK4819_IRQ_QUEUE_SIZE];
+static volatile uint8_t  gIrqHead;
+static volatile uint8_t  gIrqTail;
+uint16_t                 gBK4819_IrqDropped;
+
+void BK4819_PollInterrupts(void)
+{
+    while (BK4819_ReadRegister(BK4819_REG_0C) & 1u) {
+        const uint8_t      next   = (gIrqHead + 1) & (BK4819_IRQ_QUEUE_SIZE - 1);
+        BK4819_IrqEvent_t *pEvent = &gIrqQueue[gIrqHead];
+        uint16_t           flags;
+
+        BK4819_WriteRegister(BK4819_REG_02, 0);
+        flags = BK4819_ReadRegister(BK4819_REG_02);
+
+        if (next == gIrqTail) {
+            // consumer is behind, the request is acknowledged and lost but
+            // its FIFO words still have to go or the next ones come in late
+            if (flags & BK4819_REG_02_FSK_FIFO_ALMOST_FULL)
+                for (uint8_t count = BK4819_ReadRegister(BK4819_REG_5E) & 7u; count; count--)
+                    BK4819_ReadRegister(BK4819_REG_5F);
+            gBK4819_IrqDropped++;
+            continue;
+        }
+
+        pEvent->Flags     = flags;
+        pEvent->Code      = 0xFF;
+        pEvent->FifoWords = 0;
+
+        // read what the chip only holds until the next request right away
+        if (flags & BK4819_REG_02_DTMF_5TONE_FOUND)
+            pEvent->Code = BK4819_GetDTMF_5TONE_Code();
+
+        if (flags & BK4819_REG_02_FSK_FIFO_ALMOST_FULL) {
+            // almost full threshold, which users keep within BK4819_IRQ_FIFO_WORDS;
+            // words past what the record holds are read and dropped all the same
+            const uint8_t count = BK4819_ReadRegister(BK4819_REG_5E) & 7u;
+
+            for (uint8_t i = 0; i < count; i++) {
+                const uint16_t word = BK4819_ReadRegister(BK4819_REG_5F);
+
+                if (i < BK4819_IRQ_FIFO_WORDS)
+                    pEvent->Fifo[pEvent->FifoWords++] = word;
+            }
+        }
+
+        gIrqHead = next;
+    }
+}
+
+bool BK4819_GetInterrupt(BK4819_IrqEvent_t *pEvent)
+{
+    if (gIrqTail == gIrqHead)
+        return false;
+
+    *pEvent  = gIrqQueue[gIrqTail];
+    gIrqTail = (gIrqTail + 1) & (BK4819_IRQ_QUEUE_SIZE - 1);
+
+    return true;
+}
+#endif
+
 void BK4819_SendFSKData(uint16_t *pData)
 {
     unsigned int i;
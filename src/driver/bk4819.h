@@ -65,9 +65,36 @@ typedef enum BK4819_CssScanResult_t BK4819_CssScanResult_t;
 // radio is asleep, not listening
 extern bool gRxIdleMode;
 
+#ifdef ENABLE_BK4819_BUS_STATS
+typedef struct {
+    uint32_t Reads;          // register reads that went out on the bus
+    uint32_t ReadHits;       // register reads answered from the shadow copy
+    uint32_t Writes;         // register writes that went out on the bus
+    uint32_t WritesSkipped;  // register writes dropped as unchanged
+} BK4819_BusStats_t;
+
+extern BK4819_BusStats_t gBK4819_BusStats;
+#endif
+
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+#define BK4819_IRQ_QUEUE_SIZE   16  // power of two
+#define BK4819_IRQ_FIFO_WORDS   4
+
+// one interrupt request, decoded as soon as it was seen on REG_0C
+typedef struct {
+    uint16_t Flags;                             // REG_02
+    uint8_t  Code;                              // DTMF / 5-tone code, 0xFF if none
+    uint8_t  FifoWords;                         // FSK RX words drained with it
+    uint16_t Fifo[BK4819_IRQ_FIFO_WORDS];
+} BK4819_IrqEvent_t;
+
+extern uint16_t gBK4819_IrqDropped;
+#endif
+
 void     BK4819_Init(void);
 uint16_t BK4819_ReadRegister(BK4819_REGISTER_t Register);
 void     BK4819_WriteRegister(BK4819_REGISTER_t Register, uint16_t Data);
+void     BK4819_InvalidateShadow(void);
 void     BK4819_SetRegValue(RegisterSpec s, uint16_t v);
 void     BK4819_WriteU8(uint8_t Data);
 void     BK4819_WriteU16(uint16_t Data);
@@ -159,6 +186,11 @@ uint8_t  BK4819_GetCDCSSCodeType(void);
 uint8_t  BK4819_GetCTCShift(void);
 uint8_t  BK4819_GetCTCType(void);
 
+#ifdef ENABLE_BK4819_IRQ_QUEUE
+void     BK4819_PollInterrupts(void);
+bool     BK4819_GetInterrupt(BK4819_IrqEvent_t *pEvent);
+#endif
+
 void     BK4819_SendFSKData(uint16_t *pData);
 void     BK4819_PrepareFSKReceive(void);
 
@@ -14,6 +14,7 @@
  *     limitations under the License.
  */
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -21,7 +22,9 @@
 #include "driver/i2c.h"
 #include "driver/system.h"
 
-void EEPROM_ReadBuffer(uint16_t Address, void *pBuffer, uint8_t Size)
+#define EEPROM_SIZE         0x2000U
+
+static void EEPROM_BusRead(uint16_t Address, void *pBuffer, uint8_t Size)
 {
     I2C_Start();
 
@@ -39,9 +42,69 @@ void EEPROM_ReadBuffer(uint16_t Address, void *pBuffer, uint8_t Size)
     I2C_Stop();
 }
 
+#if defined(ENABLE_EEPROM_WRITE_CACHE) || defined(ENABLE_UART_FAST_EEPROM)
+
+#define EEPROM_ACK_POLLS    400U    // ~25 us each, well past the 5 ms write cycle
+
+// Instead of sleeping through a page write cycle we poll the chip: it does
+// not ACK its address until the cycle is over.
+static bool gWriteCycle;            // a page write may still be burning in
+
+static bool EEPROM_IsReady(void)
+{
+    bool bAck;
+
+    I2C_Start();
+    bAck = I2C_Write(0xA0) == 0;
+    I2C_Stop();
+
+    return bAck;
+}
+
+static void EEPROM_WaitReady(void)
+{
+    if (!gWriteCycle)
+        return;
+
+    for (unsigned int i = 0; i < EEPROM_ACK_POLLS && !EEPROM_IsReady(); i++) {}
+
+    gWriteCycle = false;
+}
+
+// a NACK means the previous write cycle is still running and nothing was sent
+static bool EEPROM_BurnPage(uint16_t Address, const uint8_t *pData)
+{
+    bool bAck;
+
+    I2C_Start();
+    bAck = I2C_Write(0xA0) == 0;
+    if (bAck) {
+        I2C_Write((Address >> 8) & 0xFF);
+        I2C_Write((Address >> 0) & 0xFF);
+        I2C_WriteBuffer(pData, EEPROM_PAGE_SIZE);
+    }
+    I2C_Stop();
+
+    gWriteCycle = true;
+
+    return bAck;
+}
+
+#endif
+
+#ifndef ENABLE_EEPROM_WRITE_CACHE
+
+void EEPROM_ReadBuffer(uint16_t Address, void *pBuffer, uint8_t Size)
+{
+#ifdef ENABLE_UART_FAST_EEPROM
+    EEPROM_WaitReady();
+#endif
+    EEPROM_BusRead(Address, pBuffer, Size);
+}
+
 void EEPROM_WriteBuffer(uint16_t Address, const void *pBuffer)
 {
-    if (pBuffer == NULL || Address >= 0x2000)
+    if (pBuffer == NULL || Address >= EEPROM_SIZE)
         return;
 
 
@@ -61,3 +124,231 @@ void EEPROM_WriteBuffer(uint16_t Address, const void *pBuffer)
     // give the EEPROM time to burn the data in (apparently takes 5ms)
     SYSTEM_DelayMs(8);
 }
+
+#else
+
+// Write-back cache. Writes land in whole-page slots and are burned in as
+// single 32-byte page writes from EEPROM_TimeSlice10ms(), one page per slice,
+// without waiting out the write cycle. Reads see cached data, and a read
+// that falls inside one cached page never touches the bus.
+
+#define EEPROM_CACHE_PAGES  8U
+
+typedef struct {
+    uint16_t Address;               // page aligned
+    uint8_t  Stamp;                 // last use, for picking a victim
+    bool     bValid : 1;
+    bool     bDirty : 1;
+    uint8_t  Data[EEPROM_PAGE_SIZE];
+} EEPROM_Page_t;
+
+static EEPROM_Page_t gPages[EEPROM_CACHE_PAGES];
+static uint8_t gStamp;
+
+#define EEPROM_BURN_TRIES   8U      // a write cycle is 5 ms, this waits ~100 ms
+
+uint16_t gEepromLostPages;
+
+// on a NACK the page stays dirty for the next slice
+static bool EEPROM_WritePage(EEPROM_Page_t *pPage)
+{
+    const bool bAck = EEPROM_BurnPage(pPage->Address, pPage->Data);
+
+    if (bAck)
+        pPage->bDirty = false;
+
+    return bAck;
+}
+
+// For evictions and flushes, which can't leave it for later: wait out the
+// write cycle and try again. A page the chip still refuses is given up so a
+// missing or dead EEPROM can't hang a flush, but it is counted.
+static void EEPROM_WritePageNow(EEPROM_Page_t *pPage)
+{
+    for (unsigned int i = 0; i < EEPROM_BURN_TRIES; i++) {
+        EEPROM_WaitReady();
+        if (EEPROM_WritePage(pPage))
+            return;
+    }
+
+    pPage->bDirty = false;
+    gEepromLostPages++;
+}
+
+static EEPROM_Page_t *EEPROM_FindPage(uint16_t Address)
+{
+    for (unsigned int i = 0; i < EEPROM_CACHE_PAGES; i++)
+        if (gPages[i].bValid && gPages[i].Address == Address)
+            return &gPages[i];
+    return NULL;
+}
+
+static EEPROM_Page_t *EEPROM_OldestDirty(void)
+{
+    EEPROM_Page_t *pOldest = NULL;
+
+    for (unsigned int i = 0; i < EEPROM_CACHE_PAGES; i++) {
+        EEPROM_Page_t *pPage = &gPages[i];
+        if (pPage->bDirty && (pOldest == NULL || (uint8_t)(gStamp - pPage->Stamp) > (uint8_t)(gStamp - pOldest->Stamp)))
+            pOldest = pPage;
+    }
+
+    return pOldest;
+}
+
+static EEPROM_Page_t *EEPROM_LoadPage(uint16_t Address)
+{
+    EEPROM_Page_t *pVictim = NULL;
+
+    // prefer an empty or clean slot, oldest first
+    for (unsigned int i = 0; i < EEPROM_CACHE_PAGES; i++) {
+        EEPROM_Page_t *pPage = &gPages[i];
+        if (pPage->bDirty)
+            continue;
+        if (!pPage->bValid) {
+            pVictim = pPage;
+            break;
+        }
+        if (pVictim == NULL || (uint8_t)(gStamp - pPage->Stamp) > (uint8_t)(gStamp - pVictim->Stamp))
+            pVictim = pPage;
+    }
+
+    // cache full of unwritten data, burn the oldest page in now
+    if (pVictim == NULL) {
+        pVictim = EEPROM_OldestDirty();
+        EEPROM_WritePageNow(pVictim);
+    }
+
+    EEPROM_WaitReady();
+    EEPROM_BusRead(Address, pVictim->Data, EEPROM_PAGE_SIZE);
+    pVictim->Address = Address;
+    pVictim->bValid  = true;
+    pVictim->bDirty  = false;
+
+    return pVictim;
+}
+
+void EEPROM_ReadBuffer(uint16_t Address, void *pBuffer, uint8_t Size)
+{
+    uint8_t       *pData = (uint8_t *)pBuffer;
+    const uint16_t End   = Address + Size;
+
+    if (Size == 0)
+        return;
+
+    const uint16_t First = Address & ~(EEPROM_PAGE_SIZE - 1);
+    EEPROM_Page_t *pPage = EEPROM_FindPage(First);
+
+    if (pPage != NULL && End <= First + EEPROM_PAGE_SIZE) {
+        memcpy(pData, pPage->Data + (Address - First), Size);
+        return;
+    }
+
+    EEPROM_WaitReady();
+    EEPROM_BusRead(Address, pData, Size);
+
+    for (unsigned int i = 0; i < EEPROM_CACHE_PAGES; i++) {
+        pPage = &gPages[i];
+        if (!pPage->bValid || pPage->Address >= End || pPage->Address + EEPROM_PAGE_SIZE <= Address)
+            continue;
+
+        const uint16_t From = (pPage->Address > Address) ? pPage->Address : Address;
+        const uint16_t To   = (pPage->Address + EEPROM_PAGE_SIZE < End) ? pPage->Address + EEPROM_PAGE_SIZE : End;
+        memcpy(pData + (From - Address), pPage->Data + (From - pPage->Address), To - From);
+    }
+}
+
+void EEPROM_WriteBuffer(uint16_t Address, const void *pBuffer)
+{
+    const uint8_t *pData = (const uint8_t *)pBuffer;
+    unsigned int   Done  = 0;
+
+    if (pBuffer == NULL || Address >= EEPROM_SIZE)
+        return;
+
+    // callers write 8 aligned bytes, but cope with a block straddling two pages
+    while (Done < 8) {
+        const uint16_t At     = Address + Done;
+        const uint16_t Page   = At & ~(EEPROM_PAGE_SIZE - 1);
+        const uint16_t Offset = At - Page;
+        unsigned int   Count  = EEPROM_PAGE_SIZE - Offset;
+        EEPROM_Page_t *pPage;
+
+        if (Count > 8 - Done)
+            Count = 8 - Done;
+
+        pPage = EEPROM_FindPage(Page);
+        if (pPage == NULL)
+            pPage = EEPROM_LoadPage(Page);
+
+        pPage->Stamp = ++gStamp;
+
+        if (memcmp(pPage->Data + Offset, pData + Done, Count) != 0) {
+            memcpy(pPage->Data + Offset, pData + Done, Count);
+            pPage->bDirty = true;
+        }
+
+        Done += Count;
+    }
+}
+
+void EEPROM_TimeSlice10ms(void)
+{
+    EEPROM_Page_t *pPage;
+
+    if (gWriteCycle) {
+        if (!EEPROM_IsReady())
+            return;
+        gWriteCycle = false;
+    }
+
+    pPage = EEPROM_OldestDirty();
+    if (pPage != NULL)
+        EEPROM_WritePage(pPage);
+}
+
+void EEPROM_Flush(void)
+{
+    EEPROM_Page_t *pPage;
+
+    while ((pPage = EEPROM_OldestDirty()) != NULL)
+        EEPROM_WritePageNow(pPage);
+
+    EEPROM_WaitReady();
+}
+
+#endif
+
+#ifdef ENABLE_UART_FAST_EEPROM
+// Whole pages straight to the chip, for bulk transfers. Pages that already
+// hold the data are skipped, and the last write cycle is left running: the
+// next EEPROM access waits for it, the caller can do other work meanwhile.
+bool EEPROM_WritePages(uint16_t Address, const void *pBuffer, uint16_t Size)
+{
+    const uint8_t *pData = (const uint8_t *)pBuffer;
+
+    if (((Address | Size) & (EEPROM_PAGE_SIZE - 1)) || Address + Size > EEPROM_SIZE)
+        return false;
+
+    for (; Size; Address += EEPROM_PAGE_SIZE, pData += EEPROM_PAGE_SIZE, Size -= EEPROM_PAGE_SIZE) {
+        uint8_t Current[EEPROM_PAGE_SIZE];
+
+        EEPROM_WaitReady();
+        EEPROM_BusRead(Address, Current, EEPROM_PAGE_SIZE);
+        if (memcmp(Current, pData, EEPROM_PAGE_SIZE) != 0 && !EEPROM_BurnPage(Address, pData))
+            return false;
+
+#ifdef ENABLE_EEPROM_WRITE_CACHE
+        // the chip has taken the new data, a cached copy is clean from here
+        // on; one the chip refused stays as it was
+        EEPROM_Page_t *pPage = EEPROM_FindPage(Address);
+        if (pPage != NULL) {
+            memcpy(pPage->Data, pData, EEPROM_PAGE_SIZE);
+            pPage->bDirty = false;
+        }
+#endif
+    }
+
+    return true;
+}
+#endif
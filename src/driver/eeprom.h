@@ -17,10 +17,26 @@
 #ifndef DRIVER_EEPROM_H
 #define DRIVER_EEPROM_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#define EEPROM_PAGE_SIZE    32U
+
 void EEPROM_ReadBuffer(uint16_t Address, void *pBuffer, uint8_t Size);
 void EEPROM_WriteBuffer(uint16_t Address, const void *pBuffer);
 
+#ifdef ENABLE_EEPROM_WRITE_CACHE
+// pages the chip never took, given up on by an eviction or a flush
+extern uint16_t gEepromLostPages;
+
+void EEPROM_TimeSlice10ms(void);
+void EEPROM_Flush(void);
+#endif
+
+#ifdef ENABLE_UART_FAST_EEPROM
+// Address and Size in whole pages
+bool EEPROM_WritePages(uint16_t Address, const void *pBuffer, uint16_t Size);
+#endif
+
 #endif
 
@@ -6,10 +6,215 @@
 #include "spi.h"
 #include "dp32g030/gpio.h"
 #include "dp32g030/spi.h"
+#ifdef ENABLE_LCD_DMA
+#include <string.h>
+#include "ARMCM0.h"
+#include "dp32g030/dma.h"
+#include "dp32g030/irq.h"
+#endif
 
 u8g2_t u8g2;
 
+#ifdef ENABLE_LCD_DMA
+// The byte stream u8g2 produces is queued as segments that DMA_CH1 plays out
+// into SPI0->WDR while the CPU gets on with the next frame. HandlerDMA starts
+// the next segment on each transfer-complete, and flips the A0 line between
+// command and data only after the SPI FIFO has drained.
+//
+// Frame buffer bytes are sent in place, or from a copy with
+// ENABLE_LCD_DMA_DOUBLE_BUFFER so drawing may resume at once; without it
+// UI_UpdateDisplay waits for the frame to go out before anything draws
+// again. Anything else (commands, the tiles of u8x8_ClearDisplay on the
+// stack) is copied into the segment itself.
+#define LCD_DMA_SEGMENTS    16      // power of two
+#define LCD_DMA_INLINE      8
+#define LCD_DMA_HSREQ       DMA_CH_MOD_MD_SEL_BITS_HSREQ_MS0    // SPI0 TX request line
+
+typedef struct {
+    const uint8_t *pData;
+    uint8_t        Length;
+    bool           bData;
+    uint8_t        Inline[LCD_DMA_INLINE];
+} LCD_DMA_Segment_t;
+
+static LCD_DMA_Segment_t gLcdSegments[LCD_DMA_SEGMENTS];
+static volatile uint8_t  gLcdHead;          // written by the main loop only
+static volatile uint8_t  gLcdTail;          // written by HandlerDMA only
+static volatile bool     gLcdBusy;
+static LCD_DMA_Segment_t *gLcdPending;      // claimed, still being filled
+static bool              gLcdDataMode;      // A0 level u8g2 asked for
+static bool              gLcdA0;            // A0 level on the pin
+#ifdef ENABLE_LCD_DMA_DOUBLE_BUFFER
+static uint8_t           gLcdFrame[128 * 64 / 8];
+#endif
+
+void HandlerDMA(void);
+
+static void LCD_DMA_SetA0(bool bData)
+{
+    if (bData) {
+        GPIO_SetBit(&GPIOB->DATA, GPIOB_PIN_ST7565_A0);
+    } else {
+        GPIO_ClearBit(&GPIOB->DATA, GPIOB_PIN_ST7565_A0);
+    }
+    gLcdA0 = bData;
+}
+
+// Called with gLcdBusy set, from HandlerDMA or with interrupts masked.
+static void LCD_DMA_StartSegment(void)
+{
+    const LCD_DMA_Segment_t *pSegment;
+
+    if (gLcdTail == gLcdHead) {
+        gLcdBusy = false;
+        return;
+    }
+
+    pSegment = &gLcdSegments[gLcdTail];
+
+    if (pSegment->bData != gLcdA0) {
+        // at most a FIFO's worth of bytes, ~40 us at this SCK
+        while ((SPI0->FIFOST & SPI_FIFOST_TFE_MASK) != SPI_FIFOST_TFE_BITS_EMPTY) {}
+        SPI_WaitForUndocumentedTxFifoStatusBit();
+        LCD_DMA_SetA0(pSegment->bData);
+    }
+
+    DMA_CH1->MSADDR = (uint32_t)(uintptr_t)pSegment->pData;
+    DMA_CH1->CTR = 0
+        | DMA_CH_CTR_CH_EN_BITS_ENABLE
+        | (((pSegment->Length - 1U) << DMA_CH_CTR_LENGTH_SHIFT) & DMA_CH_CTR_LENGTH_MASK)
+        | DMA_CH_CTR_LOOP_BITS_DISABLE
+        | DMA_CH_CTR_PRI_BITS_LOW
+        ;
+}
+
+void HandlerDMA(void)
+{
+    if ((DMA_INTST & DMA_INTST_CH1_TC_INTST_MASK) == 0) {
+        return;
+    }
+
+    DMA_INTST = DMA_INTST_CH1_TC_INTST_BITS_SET;
+    gLcdTail = (gLcdTail + 1) & (LCD_DMA_SEGMENTS - 1);
+    LCD_DMA_StartSegment();
+}
+
+// Runs the transfer-complete handling from here rather than waiting for
+// the interrupt, so a caller with interrupts masked doesn't wait forever.
+static void LCD_DMA_Poll(void)
+{
+    const uint32_t Primask = __get_PRIMASK();
+
+    __disable_irq();
+    HandlerDMA();
+    __set_PRIMASK(Primask);
+}
+
+static void LCD_DMA_Publish(void)
+{
+    if (gLcdPending == NULL) {
+        return;
+    }
+
+    gLcdPending = NULL;
+    gLcdHead = (gLcdHead + 1) & (LCD_DMA_SEGMENTS - 1);
+
+    __disable_irq();
+    if (!gLcdBusy) {
+        gLcdBusy = true;
+        LCD_DMA_StartSegment();
+    }
+    __enable_irq();
+}
+
+static LCD_DMA_Segment_t *LCD_DMA_Claim(void)
+{
+    LCD_DMA_Segment_t *pSegment;
+
+    // one slot stays free so a full ring is not mistaken for an empty one
+    while (((gLcdHead + 1) & (LCD_DMA_SEGMENTS - 1)) == gLcdTail)
+        LCD_DMA_Poll();
+
+    pSegment = &gLcdSegments[gLcdHead];
+    pSegment->pData  = pSegment->Inline;
+    pSegment->Length = 0;
+    pSegment->bData  = gLcdDataMode;
+    gLcdPending = pSegment;
+
+    return pSegment;
+}
+
+static void LCD_DMA_Send(const uint8_t *pData, uint8_t Size)
+{
+    const uint8_t *pFrame = u8g2_GetBufferPtr(&u8g2);
+
+    if (pData >= pFrame && pData + Size <= pFrame + 8 * u8g2_GetBufferTileHeight(&u8g2) * u8g2_GetBufferTileWidth(&u8g2)) {
+        LCD_DMA_Segment_t *pSegment;
+
+        LCD_DMA_Publish();
+        pSegment = LCD_DMA_Claim();
+#ifdef ENABLE_LCD_DMA_DOUBLE_BUFFER
+        pSegment->pData = gLcdFrame + (pData - pFrame);
+        memcpy(gLcdFrame + (pData - pFrame), pData, Size);
+#else
+        pSegment->pData = pData;
+#endif
+        pSegment->Length = Size;
+        LCD_DMA_Publish();
+        return;
+    }
+
+    while (Size > 0) {
+        if (gLcdPending == NULL || gLcdPending->bData != gLcdDataMode || gLcdPending->Length == LCD_DMA_INLINE) {
+            LCD_DMA_Publish();
+            LCD_DMA_Claim();
+        }
+        gLcdPending->Inline[gLcdPending->Length++] = *pData++;
+        Size--;
+    }
+}
+
+void U8G2_HAL_WaitIdle(void)
+{
+    LCD_DMA_Publish();
+    while (gLcdBusy)
+        LCD_DMA_Poll();
+    while ((SPI0->FIFOST & SPI_FIFOST_TFE_MASK) != SPI_FIFOST_TFE_BITS_EMPTY) {}
+    SPI_WaitForUndocumentedTxFifoStatusBit();
+}
+
+static void LCD_DMA_Init(void)
+{
+    DMA_CH1->MDADDR = (uint32_t)(uintptr_t)&SPI0->WDR;
+    DMA_CH1->MOD = 0
+        // Source
+        | DMA_CH_MOD_MS_ADDMOD_BITS_INCREMENT
+        | DMA_CH_MOD_MS_SIZE_BITS_8BIT
+        | DMA_CH_MOD_MS_SEL_BITS_SRAM
+        // Destination
+        | DMA_CH_MOD_MD_ADDMOD_BITS_NONE
+        | DMA_CH_MOD_MD_SIZE_BITS_8BIT
+        | LCD_DMA_HSREQ
+        ;
+    DMA_INTST = DMA_INTST_CH1_TC_INTST_BITS_SET;
+    DMA_INTEN |= DMA_INTEN_CH1_TC_INTEN_BITS_ENABLE;
+    DMA_CTR = (DMA_CTR & ~DMA_CTR_DMAEN_MASK) | DMA_CTR_DMAEN_BITS_ENABLE;
+
+    SPI0->CR |= SPI_CR_TXDMAEN_MASK;
+    NVIC_EnableIRQ((IRQn_Type)DP32_DMA_IRQn);
+
+    gLcdA0 = (GPIOB->DATA & (1U << GPIOB_PIN_ST7565_A0)) != 0;
+}
+#endif
+
 uint8_t u8x8_gpio_and_delay_cb(__attribute__((unused)) u8x8_t* u8g2, uint8_t msg, uint8_t arg_int, __attribute__((unused)) void* arg_ptr) {
+#ifdef ENABLE_LCD_DMA
+    // the init sequence mixes bytes with reset pulses and delays
+    if (msg == U8X8_MSG_DELAY_MILLI || msg == U8X8_MSG_GPIO_RESET) {
+        U8G2_HAL_WaitIdle();
+    }
+#endif
+
     switch (msg)
     {
     case U8X8_MSG_DELAY_MILLI:			// delay arg_int * 1 milli second
@@ -36,10 +241,15 @@ uint8_t u8x8_gpio_and_delay_cb(__attribute__((unused)) u8x8_t* u8g2, uint8_t msg
 }
 
 uint8_t u8x8_hw_spi_cb(u8x8_t* u8g2, uint8_t msg, uint8_t arg_int, void* arg_ptr) {
+#ifndef ENABLE_LCD_DMA
     uint8_t* data;
+#endif
     
     switch (msg) {
     case U8X8_MSG_BYTE_SEND: // write data to display
+#ifdef ENABLE_LCD_DMA
+        LCD_DMA_Send((const uint8_t *)arg_ptr, arg_int);
+#else
         data = (uint8_t *)arg_ptr;
         while (arg_int > 0) {
             while ((SPI0->FIFOST & SPI_FIFOST_TFF_MASK) != SPI_FIFOST_TFF_BITS_NOT_FULL) {}
@@ -47,16 +257,26 @@ uint8_t u8x8_hw_spi_cb(u8x8_t* u8g2, uint8_t msg, uint8_t arg_int, void* arg_ptr
             data++;
             arg_int--;
         }
+#endif
         break;
     case U8X8_MSG_BYTE_START_TRANSFER:
         //SPI0->CR = (SPI0->CR & ~SPI_CR_MSR_SSN_MASK) | SPI_CR_MSR_SSN_BITS_DISABLE;
         break;
     case U8X8_MSG_BYTE_END_TRANSFER:
         //SPI0->CR = (SPI0->CR & ~SPI_CR_MSR_SSN_MASK) | SPI_CR_MSR_SSN_BITS_ENABLE;
+#ifdef ENABLE_LCD_DMA
+        LCD_DMA_Publish();
+#else
         SPI_WaitForUndocumentedTxFifoStatusBit();
+#endif
         break;
     case U8X8_MSG_BYTE_SET_DC:
+#ifdef ENABLE_LCD_DMA
+        (void)u8g2;
+        gLcdDataMode = arg_int != 0;    // HandlerDMA drives A0
+#else
         u8x8_gpio_SetDC(u8g2, arg_int);
+#endif
         break;
     default:
         return 0;
@@ -67,10 +287,16 @@ uint8_t u8x8_hw_spi_cb(u8x8_t* u8g2, uint8_t msg, uint8_t arg_int, void* arg_ptr
 void U8G2_HAL_Init(void) {
     SPI0_Init();
     SPI_ToggleMasterMode(&SPI0->CR, false);
+#ifdef ENABLE_LCD_DMA
+    LCD_DMA_Init();
+#endif
     u8g2_Setup_st7565_64128n_f(&u8g2, U8G2_R0, u8x8_hw_spi_cb, u8x8_gpio_and_delay_cb);
     u8g2_InitDisplay(&u8g2); // send init sequence to the display, display is in sleep mode after this,
     u8g2_SetPowerSave(&u8g2, 0); // wake up display
     //u8g2_SetContrast(&u8g2, 128);
     u8g2_ClearDisplay(&u8g2);
+#ifdef ENABLE_LCD_DMA
+    U8G2_HAL_WaitIdle();    // UART_Init reprograms the DMA controller next
+#endif
 
 }
\ No newline at end of file
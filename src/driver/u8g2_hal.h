@@ -4,4 +4,8 @@
 
 extern u8g2_t u8g2;
 
-void U8G2_HAL_Init(void);
\ No newline at end of file
+void U8G2_HAL_Init(void);
+#ifdef ENABLE_LCD_DMA
+// Blocks until everything queued for the display has been clocked out.
+void U8G2_HAL_WaitIdle(void);
+#endif
\ No newline at end of file
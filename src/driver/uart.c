@@ -20,18 +20,102 @@
 #include "dp32g030/syscon.h"
 #include "dp32g030/uart.h"
 #include "driver/uart.h"
+#ifdef ENABLE_UART_FAST_EEPROM
+    #include "driver/systick.h"
+#endif
+#ifdef ENABLE_UART_TX_QUEUE
+    #include "ARMCM0.h"
+    #include "dp32g030/irq.h"
+#endif
 #include "printf.h"
 
 static bool UART_IsLogEnabled;
 uint8_t UART_DMA_Buffer[256];
 
-void UART_Init(void)
+#ifdef ENABLE_UART_TX_QUEUE
+// UART_Send copies into a ring and HandlerUART1 tops the TX FIFO up from it
+// each time the FIFO runs down to TF_LEVEL. A large buffer that stays put
+// (the screen mirror's frame) can be queued by reference instead: it goes
+// out when the ring's tail reaches gTxInPlaceAt, anything queued after it
+// waits behind it. Head and tail run free, the mask is applied on access.
+#define TX_MASK (UART_TX_QUEUE_SIZE - 1U)
+
+_Static_assert((UART_TX_QUEUE_SIZE & TX_MASK) == 0, "UART_TX_QUEUE_SIZE must be a power of two");
+
+static uint8_t                  gTxRing[UART_TX_QUEUE_SIZE];
+static volatile uint16_t        gTxHead;        // written by the main loop only
+static volatile uint16_t        gTxTail;        // written by HandlerUART1 only
+static const uint8_t *volatile  gTxInPlace;
+static volatile uint16_t        gTxInPlaceSize; // set last by the main loop, counted down by HandlerUART1
+static uint16_t                 gTxInPlaceAt;
+
+UART_TxStats_t gUART_TxStats;
+
+static void TxFill(void)
+{
+    while ((UART1->IF & UART_IF_TXFIFO_FULL_MASK) == UART_IF_TXFIFO_FULL_BITS_NOT_SET) {
+        const uint16_t Tail = gTxTail;
+
+        if (gTxInPlaceSize && Tail == gTxInPlaceAt) {
+            UART1->TDR = *gTxInPlace++;
+            gTxInPlaceSize--;
+        } else if (Tail != gTxHead) {
+            UART1->TDR = gTxRing[Tail & TX_MASK];
+            gTxTail = Tail + 1;
+        } else {
+            UART1->IE &= ~UART_IE_TXFIFO_MASK;
+            return;
+        }
+    }
+}
+
+void HandlerUART1(void)
+{
+    TxFill();
+    UART1->IF = UART_IF_TXFIFO_BITS_SET;
+}
+
+static uint16_t TxFree(void)
+{
+    return UART_TX_QUEUE_SIZE - (uint16_t)(gTxHead - gTxTail);
+}
+
+// Fills the FIFO from here rather than waiting for the interrupt, so a
+// caller with interrupts masked doesn't wait forever.
+static void TxWait(void)
+{
+    const uint32_t Primask = __get_PRIMASK();
+
+    __disable_irq();
+    TxFill();
+    __set_PRIMASK(Primask);
+}
+
+// Size must not exceed TxFree()
+static void TxPut(const uint8_t *pData, uint16_t Size)
+{
+    uint16_t Head = gTxHead;
+    uint16_t Used;
+
+    gUART_TxStats.Queued += Size;
+    while (Size--)
+        gTxRing[Head++ & TX_MASK] = *pData++;
+    gTxHead = Head;
+
+    Used = Head - gTxTail;
+    if (Used > gUART_TxStats.Peak)
+        gUART_TxStats.Peak = Used;
+
+    UART1->IE |= UART_IE_TXFIFO_BITS_ENABLE;
+}
+#endif
+
+static uint32_t UART_GetClock(void)
 {
     uint32_t Delta;
     uint32_t Positive;
     uint32_t Frequency;
 
-    UART1->CTRL = (UART1->CTRL & ~UART_CTRL_UARTEN_MASK) | UART_CTRL_UARTEN_BITS_DISABLE;
     Delta = SYSCON_RC_FREQ_DELTA;
     Positive = (Delta & SYSCON_RC_FREQ_DELTA_RCHF_SIG_MASK) >> SYSCON_RC_FREQ_DELTA_RCHF_SIG_SHIFT;
     Frequency = (Delta & SYSCON_RC_FREQ_DELTA_RCHF_DELTA_MASK) >> SYSCON_RC_FREQ_DELTA_RCHF_DELTA_SHIFT;
@@ -41,12 +125,26 @@ void UART_Init(void)
         Frequency = 48000000U - Frequency;
     }
 
+    return Frequency;
+}
+
+void UART_Init(void)
+{
+    UART1->CTRL = (UART1->CTRL & ~UART_CTRL_UARTEN_MASK) | UART_CTRL_UARTEN_BITS_DISABLE;
+
     //UART1->BAUD = Frequency / 39053U;
-    UART1->BAUD = Frequency / 115200;
+    UART1->BAUD = UART_GetClock() / UART_DEFAULT_BAUD;
     UART1->CTRL = UART_CTRL_RXEN_BITS_ENABLE | UART_CTRL_TXEN_BITS_ENABLE | UART_CTRL_RXDMAEN_BITS_ENABLE;
     UART1->RXTO = 4;
     UART1->FC = 0;
+#ifdef ENABLE_UART_TX_QUEUE
+    UART1->FIFO = UART_FIFO_RF_LEVEL_BITS_8_BYTE | UART_FIFO_TF_LEVEL_BITS_2_BYTE | UART_FIFO_RF_CLR_BITS_ENABLE | UART_FIFO_TF_CLR_BITS_ENABLE;
+    gTxHead = 0;
+    gTxTail = 0;
+    gTxInPlaceSize = 0;
+#else
     UART1->FIFO = UART_FIFO_RF_LEVEL_BITS_8_BYTE | UART_FIFO_RF_CLR_BITS_ENABLE | UART_FIFO_TF_CLR_BITS_ENABLE;
+#endif
     UART1->IE = 0;
 
     DMA_CTR = (DMA_CTR & ~DMA_CTR_DMAEN_MASK) | DMA_CTR_DMAEN_BITS_DISABLE;
@@ -63,6 +161,14 @@ void UART_Init(void)
         | DMA_CH_MOD_MD_SIZE_BITS_8BIT
         | DMA_CH_MOD_MD_SEL_BITS_SRAM
         ;
+#ifdef ENABLE_LCD_DMA
+    // CH1 belongs to the display
+    DMA_INTEN &= ~(DMA_INTEN_CH0_TC_INTEN_MASK | DMA_INTEN_CH0_THC_INTEN_MASK);
+    DMA_INTST = 0
+        | DMA_INTST_CH0_TC_INTST_BITS_SET
+        | DMA_INTST_CH0_THC_INTST_BITS_SET
+        ;
+#else
     DMA_INTEN = 0;
     DMA_INTST = 0
         | DMA_INTST_CH0_TC_INTST_BITS_SET
@@ -74,6 +180,7 @@ void UART_Init(void)
         | DMA_INTST_CH2_THC_INTST_BITS_SET
         | DMA_INTST_CH3_THC_INTST_BITS_SET
         ;
+#endif
     DMA_CH0->CTR = 0
         | DMA_CH_CTR_CH_EN_BITS_ENABLE
         | ((0xFF << DMA_CH_CTR_LENGTH_SHIFT) & DMA_CH_CTR_LENGTH_MASK)
@@ -85,8 +192,85 @@ void UART_Init(void)
     DMA_CTR = (DMA_CTR & ~DMA_CTR_DMAEN_MASK) | DMA_CTR_DMAEN_BITS_ENABLE;
 
     UART1->CTRL |= UART_CTRL_UARTEN_BITS_ENABLE;
+
+#ifdef ENABLE_UART_TX_QUEUE
+    NVIC_EnableIRQ((IRQn_Type)DP32_UART1_IRQn);
+#endif
+}
+
+#ifdef ENABLE_UART_TX_QUEUE
+void UART_Send(const void *pBuffer, uint32_t Size)
+{
+    const uint8_t *pData = (const uint8_t *)pBuffer;
+    bool           bWaited = false;
+
+    while (Size) {
+        uint32_t Free = TxFree();
+
+        if (Free == 0) {
+            if (!bWaited) {
+                bWaited = true;
+                gUART_TxStats.Waits++;
+            }
+            TxWait();
+            continue;
+        }
+
+        if (Free > Size)
+            Free = Size;
+        TxPut(pData, Free);
+        pData += Free;
+        Size  -= Free;
+    }
+}
+
+// All or nothing, for output that is better lost than late
+bool UART_TrySend(const void *pBuffer, uint32_t Size)
+{
+    if (Size > TxFree()) {
+        gUART_TxStats.Dropped += Size;
+        return false;
+    }
+
+    TxPut(pBuffer, Size);
+    return true;
+}
+
+// Queues pPrefix by copy and pBuffer by reference; pBuffer is read while it
+// goes out and must stay valid until then. One buffer can be in flight, a
+// second one is dropped along with its prefix.
+bool UART_SendInPlace(const void *pPrefix, uint32_t PrefixSize, const void *pBuffer, uint16_t Size)
+{
+    if (gTxInPlaceSize || PrefixSize > TxFree()) {
+        gUART_TxStats.Dropped += PrefixSize + Size;
+        return false;
+    }
+
+    TxPut(pPrefix, PrefixSize);
+    gTxInPlace   = pBuffer;
+    gTxInPlaceAt = gTxHead;
+    gTxInPlaceSize = Size;
+    gUART_TxStats.Queued += Size;
+    UART1->IE |= UART_IE_TXFIFO_BITS_ENABLE;
+
+    return true;
 }
 
+bool UART_TxInPlaceBusy(void)
+{
+    return gTxInPlaceSize != 0;
+}
+
+// returns once the last byte has left the FIFO
+void UART_Flush(void)
+{
+    while (gTxHead != gTxTail || gTxInPlaceSize)
+        TxWait();
+
+    while ((UART1->IF & UART_IF_TXFIFO_EMPTY_MASK) == UART_IF_TXFIFO_EMPTY_BITS_NOT_SET) {
+    }
+}
+#else
 void UART_Send(const void *pBuffer, uint32_t Size)
 {
     const uint8_t *pData = (const uint8_t *)pBuffer;
@@ -98,11 +282,35 @@ void UART_Send(const void *pBuffer, uint32_t Size)
         }
     }
 }
+#endif
+
+#ifdef ENABLE_UART_FAST_EEPROM
+// Lets whatever is still queued go out at the old rate first. The
+// RX DMA keeps running, bytes arriving during the switch are garbage and
+// dropped by the framing check.
+void UART_SetBaudRate(uint32_t Baud)
+{
+#ifdef ENABLE_UART_TX_QUEUE
+    UART_Flush();
+#else
+    while ((UART1->IF & UART_IF_TXFIFO_EMPTY_MASK) == UART_IF_TXFIFO_EMPTY_BITS_NOT_SET) {
+    }
+#endif
+    // the shift register still holds the last byte
+    SYSTICK_DelayUs(100);
+
+    UART1->BAUD = UART_GetClock() / Baud;
+}
+#endif
 
 void UART_LogSend(const void *pBuffer, uint32_t Size)
 {
     if (UART_IsLogEnabled) {
+#ifdef ENABLE_UART_TX_QUEUE
+        UART_TrySend(pBuffer, Size);
+#else
         UART_Send(pBuffer, Size);
+#endif
     }
 }
 
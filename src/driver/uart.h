@@ -18,14 +18,39 @@
 #ifndef DRIVER_UART_H
 #define DRIVER_UART_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#define UART_DEFAULT_BAUD   115200U
+
 extern uint8_t UART_DMA_Buffer[256];
 
 void UART_Init(void);
 void UART_Send(const void *pBuffer, uint32_t Size);
+#ifdef ENABLE_UART_FAST_EEPROM
+void UART_SetBaudRate(uint32_t Baud);
+#endif
 void UART_LogSend(const void *pBuffer, uint32_t Size);
 
+#ifdef ENABLE_UART_TX_QUEUE
+// UART_Send only waits when the ring is full; HandlerUART1 drains it
+#define UART_TX_QUEUE_SIZE  512U    // power of two
+
+typedef struct {
+    uint32_t Queued;    // bytes accepted
+    uint32_t Dropped;   // bytes refused by UART_TrySend and UART_SendInPlace
+    uint16_t Waits;     // UART_Send calls that had to wait for room
+    uint16_t Peak;      // most bytes in the ring at once
+} UART_TxStats_t;
+
+extern UART_TxStats_t gUART_TxStats;
+
+bool UART_TrySend(const void *pBuffer, uint32_t Size);
+bool UART_SendInPlace(const void *pPrefix, uint32_t PrefixSize, const void *pBuffer, uint16_t Size);
+bool UART_TxInPlaceBusy(void);
+void UART_Flush(void);
+#endif
+
 #ifdef ENABLE_FEAT_F4HWN_SCREENSHOT
     bool UART_IsCableConnected(void);
 #endif
@@ -0,0 +1,139 @@
+#ifdef ENABLE_FREQ_BLACKLIST
+
+#include <string.h>
+
+#include "driver/eeprom.h"
+#include "helper/blacklist.h"
+
+#define SLOT_BITS   7
+
+_Static_assert((1u << SLOT_BITS) == BLACKLIST_SLOTS, "BLACKLIST_SLOTS must be 1 << SLOT_BITS");
+_Static_assert(BLACKLIST_MAX_ENTRIES * 3 < BLACKLIST_SLOTS * 2, "blacklist table too full for linear probing");
+
+// 0 marks a free slot, no valid frequency rounds to key 0
+static uint32_t gSlots[BLACKLIST_SLOTS];
+static uint8_t  gCount;
+static bool     gLoaded;
+
+static uint32_t ToKey(uint32_t Frequency)
+{
+    return (Frequency + BLACKLIST_QUANTUM / 2) / BLACKLIST_QUANTUM;
+}
+
+// multiplicative hash, nearby frequencies land far apart
+static uint32_t *Find(uint32_t Key)
+{
+    uint32_t i = (Key * 2654435761u) >> (32 - SLOT_BITS);
+
+    while (gSlots[i] != 0 && gSlots[i] != Key)
+        i = (i + 1) & (BLACKLIST_SLOTS - 1);
+
+    return &gSlots[i];
+}
+
+// EEPROM_WriteBuffer() takes whole aligned 8 byte blocks
+static void PatchEeprom(uint16_t Address, const uint8_t *pData, uint8_t Size)
+{
+    while (Size) {
+        const uint16_t Block  = Address & ~7u;
+        const uint8_t  Offset = Address - Block;
+        const uint8_t  Length = (Size < 8 - Offset) ? Size : 8 - Offset;
+        uint8_t        Buffer[8];
+
+        EEPROM_ReadBuffer(Block, Buffer, sizeof(Buffer));
+        memcpy(Buffer + Offset, pData, Length);
+        EEPROM_WriteBuffer(Block, Buffer);
+
+        Address += Length;
+        pData   += Length;
+        Size    -= Length;
+    }
+
+#ifdef ENABLE_EEPROM_WRITE_CACHE
+    // the spectrum loop never runs the cache's time slice
+    EEPROM_Flush();
+#endif
+}
+
+static void Load(void)
+{
+    uint8_t Count;
+
+    gLoaded = true;
+
+    EEPROM_ReadBuffer(BLACKLIST_EEPROM_ADDR, &Count, 1);
+    if (Count > BLACKLIST_MAX_ENTRIES)
+        return;     // blank or foreign data, start empty
+
+    for (unsigned int i = 0; i < Count; i++) {
+        uint8_t   Entry[3];
+        uint32_t  Key;
+        uint32_t *pSlot;
+
+        EEPROM_ReadBuffer(BLACKLIST_EEPROM_ADDR + 1 + i * 3, Entry, sizeof(Entry));
+        Key = Entry[0] | (Entry[1] << 8) | ((uint32_t)Entry[2] << 16);
+        if (Key == 0)
+            continue;
+
+        pSlot  = Find(Key);
+        *pSlot = Key;
+    }
+
+    // counts stored entries, new ones are appended after them
+    gCount = Count;
+}
+
+bool BLACKLIST_Contains(uint32_t Frequency)
+{
+    if (!gLoaded)
+        Load();
+
+    return gCount && *Find(ToKey(Frequency)) != 0;
+}
+
+// false if the frequency could not be added because the list is full
+bool BLACKLIST_Add(uint32_t Frequency)
+{
+    const uint32_t Key   = ToKey(Frequency);
+    uint32_t      *pSlot;
+    uint8_t        Entry[3];
+
+    if (!gLoaded)
+        Load();
+
+    pSlot = Find(Key);
+    if (*pSlot != 0)
+        return true;
+    if (gCount >= BLACKLIST_MAX_ENTRIES)
+        return false;
+
+    *pSlot = Key;
+
+    // entry first, then the count that makes it visible
+    Entry[0] = Key & 0xFF;
+    Entry[1] = (Key >> 8) & 0xFF;
+    Entry[2] = (Key >> 16) & 0xFF;
+    PatchEeprom(BLACKLIST_EEPROM_ADDR + 1 + gCount * 3, Entry, sizeof(Entry));
+    gCount++;
+    PatchEeprom(BLACKLIST_EEPROM_ADDR, &gCount, 1);
+
+    return true;
+}
+
+void BLACKLIST_Clear(void)
+{
+    memset(gSlots, 0, sizeof(gSlots));
+    gCount  = 0;
+    gLoaded = true;
+    PatchEeprom(BLACKLIST_EEPROM_ADDR, &gCount, 1);
+}
+
+uint8_t BLACKLIST_Count(void)
+{
+    if (!gLoaded)
+        Load();
+
+    return gCount;
+}
+
+#endif
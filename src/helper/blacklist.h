@@ -0,0 +1,31 @@
+#ifndef HELPER_BLACKLIST_H
+#define HELPER_BLACKLIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Frequencies to skip, shared by the spectrum sweep and the frequency
+// scanner. Keys are frequencies rounded to BLACKLIST_QUANTUM, held in an
+// open-addressing table so a lookup costs the same however long the list
+// grows. The list persists in the EEPROM hole at BLACKLIST_EEPROM_ADDR that
+// neither CHIRP (writes up to 0x1D00) nor a settings reset touches:
+//
+//   0x1D00       entry count (0xFF on a blank EEPROM)
+//   0x1D01...    entries, 3 bytes little endian each, in the order added
+
+#define BLACKLIST_QUANTUM       250u    // 2.5 kHz, in 10 Hz units
+#define BLACKLIST_EEPROM_ADDR   0x1D00u
+#define BLACKLIST_EEPROM_SIZE   0x100u
+#define BLACKLIST_MAX_ENTRIES   ((BLACKLIST_EEPROM_SIZE - 1) / 3)
+#define BLACKLIST_SLOTS         128u    // power of two, keeps the load under 2/3
+
+#ifdef ENABLE_FREQ_BLACKLIST
+
+bool    BLACKLIST_Contains(uint32_t Frequency);
+bool    BLACKLIST_Add(uint32_t Frequency);
+void    BLACKLIST_Clear(void);
+uint8_t BLACKLIST_Count(void);
+
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef HELPER_FEC_H
+#define HELPER_FEC_H
+
+#include <stdint.h>
+
+// Reed-Solomon code over GF(256) for the messenger's FSK packets. The
+// parity bytes follow the data unchanged, so a station without FEC reads
+// the data part as a normal packet, and FEC_PARITY_SIZE of them put right
+// any FEC_PARITY_SIZE / 2 bytes, a burst of up to 57 bits included.
+//
+// Decoding is split so most of it happens while the packet comes in:
+// every byte updates the syndromes, FEC_DecodeEnd() only has work to do
+// when they aren't all zero. The field arithmetic is log/antilog table
+// lookups, no division.
+
+#define FEC_PARITY_SIZE 16
+
+#ifdef ENABLE_MESSENGER_FEC
+
+typedef struct {
+    uint8_t Syndrome[FEC_PARITY_SIZE];
+    uint8_t Count;      // bytes fed so far
+} FEC_Decoder_t;
+
+void   FEC_Encode(const uint8_t *pData, uint8_t Size, uint8_t *pParity);
+
+void   FEC_DecodeStart(FEC_Decoder_t *pDecoder);
+void   FEC_DecodeByte(FEC_Decoder_t *pDecoder, uint8_t Byte);
+// Corrects the data (the first Size of the bytes fed, the parity after
+// them). Returns how many bytes were wrong, -1 if there are too many.
+int8_t FEC_DecodeEnd(const FEC_Decoder_t *pDecoder, uint8_t *pData, uint8_t Size);
+
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+#ifdef ENABLE_MESSENGER_LINK
+
+#include <string.h>
+
+#include "driver/crc.h"
+#include "helper/msglink.h"
+
+void MSGLINK_Build(uint8_t *pFrame, const MSGLINK_Frame_t *pInfo)
+{
+    const uint8_t Length = (pInfo->Length < MSGLINK_MAX_PAYLOAD) ? pInfo->Length : MSGLINK_MAX_PAYLOAD;
+    uint16_t      Crc;
+
+    memset(pFrame, 0, MSGLINK_FRAME_SIZE);
+
+    pFrame[0] = 'M';
+    pFrame[1] = 'L';
+    pFrame[2] = pInfo->Type;
+    pFrame[3] = pInfo->Seq;
+    pFrame[4] = pInfo->Src & 0xFF;
+    pFrame[5] = pInfo->Src >> 8;
+    pFrame[6] = pInfo->Dst & 0xFF;
+    pFrame[7] = pInfo->Dst >> 8;
+    pFrame[8] = Length;
+    memcpy(pFrame + MSGLINK_HEADER_SIZE, pInfo->pPayload, Length);
+
+    Crc = CRC_Calculate(pFrame, MSGLINK_HEADER_SIZE + Length);
+    pFrame[MSGLINK_HEADER_SIZE + Length]     = Crc & 0xFF;
+    pFrame[MSGLINK_HEADER_SIZE + Length + 1] = Crc >> 8;
+}
+
+MSGLINK_Result_t MSGLINK_Parse(const uint8_t *pFrame, uint8_t Size, MSGLINK_Frame_t *pInfo)
+{
+    uint16_t Crc;
+
+    if (Size < MSGLINK_HEADER_SIZE + 2 || pFrame[0] != 'M' || pFrame[1] != 'L')
+        return MSGLINK_NOT_LINK;
+
+    pInfo->Type     = pFrame[2];
+    pInfo->Seq      = pFrame[3];
+    pInfo->Src      = pFrame[4] | (pFrame[5] << 8);
+    pInfo->Dst      = pFrame[6] | (pFrame[7] << 8);
+    pInfo->Length   = pFrame[8];
+    pInfo->pPayload = pFrame + MSGLINK_HEADER_SIZE;
+
+    if (pInfo->Length > MSGLINK_MAX_PAYLOAD || MSGLINK_HEADER_SIZE + pInfo->Length + 2 > Size)
+        return MSGLINK_BAD_CRC;
+
+    Crc = pFrame[MSGLINK_HEADER_SIZE + pInfo->Length] | (pFrame[MSGLINK_HEADER_SIZE + pInfo->Length + 1] << 8);
+    if (Crc != CRC_Calculate(pFrame, MSGLINK_HEADER_SIZE + pInfo->Length))
+        return MSGLINK_BAD_CRC;
+
+    return MSGLINK_OK;
+}
+
+#endif
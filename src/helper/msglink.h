@@ -0,0 +1,67 @@
+#ifndef HELPER_MSGLINK_H
+#define HELPER_MSGLINK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Messenger link frames. Every FSK packet is MSGLINK_FRAME_SIZE bytes, the
+// packet length the BK4819 is set up for; a link frame fills it as
+//
+//   0        'M'
+//   1        'L'
+//   2        type, MSGLINK_DATA / MSGLINK_ACK / MSGLINK_NACK
+//   3        sequence number
+//   4..5     source station, little endian
+//   6..7     destination station, MSGLINK_BROADCAST for chat messages
+//   8        payload length
+//   9...     payload
+//   9 + len  CRC-16 (the CRC unit's CCITT) over bytes 0 .. 8 + len
+//
+// An ACK carries the highest sequence number taken from the destination
+// and, as its one payload byte, which of the 8 before it were taken too
+// (bit i: sequence - 1 - i), so one ACK settles every frame in flight.
+// A message too long for one frame goes as MSGLINK_FRAGMENT frames with
+// consecutive sequence numbers, sent back to back. Their first payload byte
+// is the fragment index (high nibble) and the count less one (low nibble),
+// every fragment but the last carries MSGLINK_FRAGMENT_DATA bytes.
+// Frames starting 'M','S' are the older format without a CRC.
+
+#define MSGLINK_FRAME_SIZE      52
+#define MSGLINK_HEADER_SIZE     9
+#define MSGLINK_MAX_PAYLOAD     (MSGLINK_FRAME_SIZE - MSGLINK_HEADER_SIZE - 2)
+#define MSGLINK_BROADCAST       0xFFFFu
+#define MSGLINK_FRAGMENT_DATA   (MSGLINK_MAX_PAYLOAD - 1)
+
+#ifdef ENABLE_MESSENGER_LINK
+
+enum {
+    MSGLINK_DATA = 0,
+    MSGLINK_ACK,
+    MSGLINK_NACK,
+    MSGLINK_FRAGMENT,
+};
+
+typedef enum {
+    MSGLINK_NOT_LINK = 0,   // not a link frame (older format or noise)
+    MSGLINK_BAD_CRC,        // the header fields may be wrong too
+    MSGLINK_OK,
+} MSGLINK_Result_t;
+
+typedef struct {
+    uint8_t        Type;
+    uint8_t        Seq;
+    uint16_t       Src;
+    uint16_t       Dst;
+    uint8_t        Length;
+    const uint8_t *pPayload;    // into the frame
+} MSGLINK_Frame_t;
+
+// pFrame gets MSGLINK_FRAME_SIZE bytes, zero padded; pInfo->pPayload is
+// copied from, Length is cut to MSGLINK_MAX_PAYLOAD
+void             MSGLINK_Build(uint8_t *pFrame, const MSGLINK_Frame_t *pInfo);
+// Size is how much of the frame arrived
+MSGLINK_Result_t MSGLINK_Parse(const uint8_t *pFrame, uint8_t Size, MSGLINK_Frame_t *pInfo);
+
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+#ifdef ENABLE_MESSENGER_LOG
+
+#include <string.h>
+
+#include "driver/eeprom.h"
+#include "helper/msglog.h"
+
+#define MAGIC       0xA0u
+
+_Static_assert(MSGLOG_SLOT_SIZE == EEPROM_PAGE_SIZE, "a slot is one page burn");
+_Static_assert(MSGLOG_EEPROM_ADDR % EEPROM_PAGE_SIZE == 0, "slots must be page aligned");
+_Static_assert(MSGLOG_SLOTS < 256, "sequence numbers must tell every slot apart");
+
+static uint8_t gNewest;     // slot
+static uint8_t gCount;
+static uint8_t gNextSeq;
+static bool    gLoaded;
+
+static uint16_t SlotAddress(uint8_t Slot)
+{
+    return MSGLOG_EEPROM_ADDR + Slot * MSGLOG_SLOT_SIZE;
+}
+
+// the slot Back lines before the newest
+static uint8_t SlotBack(uint8_t Back)
+{
+    return (gNewest + MSGLOG_SLOTS - Back) % MSGLOG_SLOTS;
+}
+
+static void Load(void)
+{
+    uint8_t Seq[MSGLOG_SLOTS];
+    bool    Valid[MSGLOG_SLOTS];
+    bool    Found = false;
+
+    gLoaded = true;
+
+    for (unsigned int i = 0; i < MSGLOG_SLOTS; i++) {
+        uint8_t Header[2];
+
+        EEPROM_ReadBuffer(SlotAddress(i), Header, sizeof(Header));
+        Seq[i]   = Header[0];
+        Valid[i] = (Header[1] & 0xF0) == MAGIC;
+    }
+
+    // the newest is the slot the next one doesn't follow on from
+    for (unsigned int i = 0; i < MSGLOG_SLOTS && !Found; i++) {
+        const unsigned int Next = (i + 1) % MSGLOG_SLOTS;
+
+        if (Valid[i] && !(Valid[Next] && Seq[Next] == (uint8_t)(Seq[i] + 1))) {
+            gNewest = i;
+            Found   = true;
+        }
+    }
+
+    if (!Found) {
+        // blank, the first line goes to slot 0
+        gNewest  = MSGLOG_SLOTS - 1;
+        gCount   = 0;
+        gNextSeq = 0;
+        return;
+    }
+
+    gCount   = 1;
+    gNextSeq = Seq[gNewest] + 1;
+    while (gCount < MSGLOG_SLOTS) {
+        const uint8_t Slot = SlotBack(gCount);
+
+        if (!Valid[Slot] || Seq[Slot] != (uint8_t)(gNextSeq - 1 - gCount))
+            break;
+        gCount++;
+    }
+}
+
+uint8_t MSGLOG_Count(void)
+{
+    if (!gLoaded)
+        Load();
+
+    return gCount;
+}
+
+uint8_t MSGLOG_Append(uint8_t Kind, const char *pText, uint8_t Length)
+{
+    uint8_t  Slot[MSGLOG_SLOT_SIZE];
+    uint16_t Address;
+
+    if (!gLoaded)
+        Load();
+
+    if (Length > MSGLOG_TEXT_SIZE)
+        Length = MSGLOG_TEXT_SIZE;
+
+    memset(Slot, 0, sizeof(Slot));
+    Slot[0] = gNextSeq;
+    Slot[1] = MAGIC | (Kind & 3);
+    memcpy(Slot + 2, pText, Length);
+
+    gNewest = (gNewest + 1) % MSGLOG_SLOTS;
+    Address = SlotAddress(gNewest);
+
+    // text first, the header that makes it valid last; with the write
+    // cache the four blocks go in as one page anyway
+    for (unsigned int i = 8; i < MSGLOG_SLOT_SIZE; i += 8)
+        EEPROM_WriteBuffer(Address + i, Slot + i);
+    EEPROM_WriteBuffer(Address, Slot);
+
+    if (gCount < MSGLOG_SLOTS)
+        gCount++;
+
+    return gNextSeq++;
+}
+
+bool MSGLOG_Read(uint8_t Back, MSGLOG_Entry_t *pEntry)
+{
+    uint8_t Slot[MSGLOG_SLOT_SIZE];
+
+    if (!gLoaded)
+        Load();
+
+    if (Back >= gCount)
+        return false;
+
+    EEPROM_ReadBuffer(SlotAddress(SlotBack(Back)), Slot, sizeof(Slot));
+    pEntry->Seq  = Slot[0];
+    pEntry->Kind = Slot[1] & 3;
+    pEntry->Mark = (Slot[1] >> 2) & 3;
+    memcpy(pEntry->Text, Slot + 2, MSGLOG_TEXT_SIZE);
+    pEntry->Text[MSGLOG_TEXT_SIZE] = '\0';
+
+    return true;
+}
+
+void MSGLOG_Mark(uint8_t Seq, uint8_t Mark)
+{
+    const uint8_t Back = gNextSeq - 1 - Seq;
+    uint8_t       Block[8];
+    uint16_t      Address;
+
+    if (!gLoaded)
+        Load();
+
+    if (Back >= gCount)
+        return;
+
+    Address = SlotAddress(SlotBack(Back));
+    EEPROM_ReadBuffer(Address, Block, sizeof(Block));
+    Block[1] = (Block[1] & ~(3u << 2)) | ((Mark & 3) << 2);
+    EEPROM_WriteBuffer(Address, Block);
+}
+
+void MSGLOG_Clear(void)
+{
+    uint8_t Block[8];
+
+    if (!gLoaded)
+        Load();
+
+    memset(Block, 0xFF, sizeof(Block));
+    while (gCount)
+        EEPROM_WriteBuffer(SlotAddress(SlotBack(--gCount)), Block);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef HELPER_MSGLOG_H
+#define HELPER_MSGLOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Messenger history. Every line the messenger shows is appended to a ring
+// of one-page slots in the DTMF contact area, which nothing else uses
+// without ENABLE_DTMF_CALLING and which a settings reset leaves alone. A
+// slot is
+//
+//   0        sequence number, one up from the slot before it
+//   1        MSGLOG_MAGIC | Mark << 2 | Kind
+//   2..31    text, 0 padded
+//
+// There is no head pointer to wear out: the newest slot is the one after
+// which the sequence numbers break, found once on first use, and appends
+// go round the ring so every page takes the same share of writes, one page
+// burn per line. Kind and Mark are two bits each for the caller. Contacts
+// written there by CHIRP only cost the history, they don't carry the magic.
+
+#define MSGLOG_EEPROM_ADDR      0x1C00u
+#define MSGLOG_EEPROM_SIZE      0x100u
+#define MSGLOG_SLOT_SIZE        32u     // an EEPROM page
+#define MSGLOG_SLOTS            (MSGLOG_EEPROM_SIZE / MSGLOG_SLOT_SIZE)
+#define MSGLOG_TEXT_SIZE        (MSGLOG_SLOT_SIZE - 2)
+
+#ifdef ENABLE_MESSENGER_LOG
+
+typedef struct {
+    uint8_t Seq;
+    uint8_t Kind;
+    uint8_t Mark;
+    char    Text[MSGLOG_TEXT_SIZE + 1];
+} MSGLOG_Entry_t;
+
+uint8_t MSGLOG_Count(void);
+// the new line's sequence number; Length is cut to MSGLOG_TEXT_SIZE
+uint8_t MSGLOG_Append(uint8_t Kind, const char *pText, uint8_t Length);
+// Back 0 is the newest line, false past the oldest
+bool    MSGLOG_Read(uint8_t Back, MSGLOG_Entry_t *pEntry);
+// does nothing once the line has been written over
+void    MSGLOG_Mark(uint8_t Seq, uint8_t Mark);
+void    MSGLOG_Clear(void);
+
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#ifdef ENABLE_PROFILER
+
+#include "ARMCM0.h"
+#include "helper/profiler.h"
+#include "misc.h"
+
+PROFILER_Entry_t gProfilerTable[PROFILER_PROBE_COUNT];
+
+// free running cycle counter built on the scheduler's 10 ms tick, as
+// SysTick->VAL alone wraps every slice; wraps after ~89 s which the
+// unsigned subtraction in PROFILER_Record() copes with
+uint32_t PROFILER_Now(void)
+{
+    uint32_t ticks;
+    uint32_t val;
+
+    do {
+        ticks = gGlobalSysTickCounter;
+        val   = SysTick->VAL;
+    } while (ticks != gGlobalSysTickCounter);
+
+    return ticks * PROFILER_CYCLES_PER_SLICE + (PROFILER_CYCLES_PER_SLICE - 1 - val);
+}
+
+void PROFILER_Record(PROFILER_Probe_t Probe, uint32_t Start)
+{
+    PROFILER_Entry_t *pEntry  = &gProfilerTable[Probe];
+    const uint32_t    Elapsed = PROFILER_Now() - Start;
+
+    if (pEntry->Calls == 0 || Elapsed < pEntry->Min)
+        pEntry->Min = Elapsed;
+    if (Elapsed > pEntry->Max)
+        pEntry->Max = Elapsed;
+    if (Elapsed > PROFILER_CYCLES_PER_SLICE)
+        pEntry->Overruns++;
+
+    pEntry->Calls++;
+    pEntry->Total += Elapsed;
+}
+
+void PROFILER_Reset(void)
+{
+    for (unsigned int i = 0; i < PROFILER_PROBE_COUNT; i++) {
+        gProfilerTable[i] = (PROFILER_Entry_t){0};
+    }
+}
+
+#endif
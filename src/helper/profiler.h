@@ -0,0 +1,48 @@
+#ifndef HELPER_PROFILER_H
+#define HELPER_PROFILER_H
+
+#include <stdint.h>
+
+// Hot-path timing probes. Each probe keeps call count, min/max/total CPU
+// cycles (48 MHz, measured with SysTick) and how often it ran longer than a
+// whole 10 ms slice. The table is read out with UART command 0x0603 and
+// decoded by utils/profiler.py. Without ENABLE_PROFILER the probes vanish.
+
+typedef enum {
+    PROFILER_SLICE_10MS = 0,    // APP_TimeSlice10ms
+    PROFILER_RADIO_IRQ,         // CheckRadioInterrupts
+    PROFILER_DISPLAY,           // GUI_DisplayScreen
+    PROFILER_AM_FIX,            // AM_fix_10ms
+    PROFILER_UART,              // UART_IsCommandAvailable + UART_HandleCommand
+    PROFILER_PROBE_COUNT
+} PROFILER_Probe_t;
+
+#define PROFILER_CYCLES_PER_SLICE 480000u
+
+#ifdef ENABLE_PROFILER
+
+typedef struct {
+    uint32_t Calls;
+    uint32_t Min;
+    uint32_t Max;
+    uint32_t Overruns;
+    uint64_t Total;
+} PROFILER_Entry_t;
+
+extern PROFILER_Entry_t gProfilerTable[PROFILER_PROBE_COUNT];
+
+uint32_t PROFILER_Now(void);
+void     PROFILER_Record(PROFILER_Probe_t Probe, uint32_t Start);
+void     PROFILER_Reset(void);
+
+#define PROFILE_BEGIN(probe) const uint32_t profile_start_##probe = PROFILER_Now()
+#define PROFILE_END(probe)   PROFILER_Record(probe, profile_start_##probe)
+
+#else
+
+#define PROFILE_BEGIN(probe)
+#define PROFILE_END(probe)
+
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#ifdef ENABLE_RSSI_LUT
+
+#include "helper/rssi.h"
+
+void RSSI_ScaleSet(RSSI_Scale_t *pScale, int16_t DbMin, int16_t DbMax, int8_t Corr, uint8_t PxRange)
+{
+    if (pScale->PxRange == PxRange && pScale->DbMin == DbMin && pScale->DbMax == DbMax && pScale->Corr == Corr)
+        return;
+
+    pScale->DbMin   = DbMin;
+    pScale->DbMax   = DbMax;
+    pScale->Corr    = Corr;
+    pScale->PxRange = PxRange;
+
+    if (DbMax - DbMin > RSSI_SCALE_MAX_SPAN)
+        DbMin = DbMax - RSSI_SCALE_MAX_SPAN;
+
+    pScale->Base = DbMin + 160 - Corr;
+    pScale->Span = (DbMax > DbMin) ? DbMax - DbMin : 0;
+
+    if (pScale->Span == 0) {
+        pScale->Px[0] = 0;
+        return;
+    }
+
+    // pixel i is round(i * PxRange / Span), stepped with an error term
+    // instead of one division per entry
+    const uint16_t Range = pScale->Span * 2;
+    uint16_t       Acc   = pScale->Span;     // Range / 2, the rounding
+    uint8_t        Px    = 0;
+
+    for (unsigned int i = 0; i <= pScale->Span; i++) {
+        pScale->Px[i] = Px;
+        Acc += PxRange * 2;
+        while (Acc >= Range) {
+            Acc -= Range;
+            Px++;
+        }
+    }
+}
+
+uint8_t RSSI_DBmToSLevel(int16_t dBm)
+{
+    // S1 at -120..-115 dBm up to S9 at -72..-67 dBm
+    static const uint8_t Levels[54] = {
+        1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3,
+        4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6,
+        7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9,
+    };
+
+    if (dBm <= -121)
+        return 0;
+    if (dBm > -67)
+        return 10;
+    return Levels[dBm + 120];
+}
+
+#endif
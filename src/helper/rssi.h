@@ -0,0 +1,47 @@
+#ifndef HELPER_RSSI_H
+#define HELPER_RSSI_H
+
+#include <stdint.h>
+
+// Raw BK4819 RSSI (0.5 dB units, dBm = rssi / 2 - 160 + band correction)
+// to S-levels and to pixels of a dBm window without dividing: the Cortex-M0
+// has no hardware divider. A scale is a table from whole dBm in the window
+// to pixels; RSSI_ScaleSet() rebuilds it only when the window, the band
+// correction or the pixel range changed, draw loops just look it up.
+
+// widest window: dbMax is capped at +10, dbMin can't go below RSSI 0 with
+// the most negative band correction (-160 - 25)
+#define RSSI_SCALE_MAX_SPAN 195
+
+#ifdef ENABLE_RSSI_LUT
+
+typedef struct {
+    int16_t DbMin;
+    int16_t DbMax;
+    int8_t  Corr;
+    uint8_t PxRange;
+    int16_t Base;       // rssi / 2 at DbMin
+    uint8_t Span;
+    uint8_t Px[RSSI_SCALE_MAX_SPAN + 1];
+} RSSI_Scale_t;
+
+void    RSSI_ScaleSet(RSSI_Scale_t *pScale, int16_t DbMin, int16_t DbMax, int8_t Corr, uint8_t PxRange);
+
+// 0..PxRange, rounded the same way as ((dbm - min) * px + range / 2) / range
+static inline uint8_t RSSI_ScalePx(const RSSI_Scale_t *pScale, uint16_t Rssi)
+{
+    const int16_t i = (int16_t)(Rssi >> 1) - pScale->Base;
+
+    if (i <= 0)
+        return pScale->Px[0];
+    if (i >= pScale->Span)
+        return pScale->Px[pScale->Span];
+    return pScale->Px[i];
+}
+
+// S0..S9 with -121 dBm as S1's floor and 6 dB per S, 10 above -67 dBm
+uint8_t RSSI_DBmToSLevel(int16_t dBm);
+
+#endif
+
+#endif
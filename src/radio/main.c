@@ -58,9 +58,15 @@
 
 #include "helper/battery.h"
 #include "helper/boot.h"
+#include "helper/profiler.h"
 
 #include "ui/welcome.h"
 #include "ui/menu.h"
+
+#ifdef ENABLE_SIMULATOR
+    #include "sim.h"
+#endif
+
 void _putchar(__attribute__((unused)) char c)
 {
 
@@ -350,11 +356,17 @@ void Main(void)
 
         if (gNextTimeslice) {
 
+            PROFILE_BEGIN(PROFILER_SLICE_10MS);
             APP_TimeSlice10ms();
+            PROFILE_END(PROFILER_SLICE_10MS);
 
             if (gNextTimeslice_500ms) {
                 APP_TimeSlice500ms();
             }
         }
+
+#ifdef ENABLE_SIMULATOR
+        SIM_Idle();
+#endif
     }
 }
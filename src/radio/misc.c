@@ -180,6 +180,8 @@ volatile uint8_t  gSerialConfigCountDown_500ms;
 
 volatile bool     gNextTimeslice_500ms;
 
+volatile uint32_t gGlobalSysTickCounter;
+
 volatile uint16_t gTxTimerCountdown_500ms;
 volatile bool     gTxTimeoutReached;
 
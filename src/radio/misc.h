@@ -246,6 +246,8 @@ extern volatile uint8_t      gSerialConfigCountDown_500ms;
 
 extern volatile bool         gNextTimeslice_500ms;
 
+extern volatile uint32_t     gGlobalSysTickCounter;     // 10 ms ticks since boot
+
 extern volatile uint16_t     gTxTimerCountdown_500ms;
 extern volatile bool         gTxTimeoutReached;
 
@@ -50,6 +50,17 @@ VFO_Info_t    *gCurrentVfo;
 DCS_CodeType_t gCurrentCodeType;
 VfoState_t     VfoState[2];
 
+// One bit per MR channel for every scanList value RADIO_CheckValidChannel()
+// knows: 0 = in no list, 1..3 = in that list, 4 = in any list, 5 = valid at
+// all. Kept in step with gMR_ChannelAttributes and gMR_ChannelExclude through
+// RADIO_UpdateChannelBitmaps() so RADIO_FindNextChannel() can skip whole
+// words of channels at once.
+#define CHANNEL_BITMAP_WORDS  ((MR_CHANNEL_LAST + 32) / 32)
+#define CHANNEL_BITMAP_LISTS  6
+
+static uint32_t gScanListBitmap[CHANNEL_BITMAP_LISTS][CHANNEL_BITMAP_WORDS];
+static uint32_t gExcludeBitmap[CHANNEL_BITMAP_WORDS];
+
 const char gModulationStr[MODULATION_UKNOWN][4] = {
     [MODULATION_FM]="FM",
     [MODULATION_AM]="AM",
@@ -119,17 +130,88 @@ bool RADIO_CheckValidChannel(uint16_t channel, bool checkScanList, uint8_t scanL
     return PriorityCh1 != channel && PriorityCh2 != channel;
 }
 
+void RADIO_UpdateChannelBitmaps(uint8_t channel)
+{
+    if (!IS_MR_CHANNEL(channel))
+        return;
+
+    const ChannelAttributes_t att = gMR_ChannelAttributes[channel];
+    const bool     valid  = att.band <= BAND7_470MHz;
+    const bool     inAny  = att.scanlist1 || att.scanlist2 || att.scanlist3;
+    const uint32_t bit    = 1u << (channel % 32);
+    const unsigned word   = channel / 32;
+    const bool     member[CHANNEL_BITMAP_LISTS] = {
+        valid && !inAny,
+        valid && att.scanlist1,
+        valid && att.scanlist2,
+        valid && att.scanlist3,
+        valid && inAny,
+        valid
+    };
+
+    for (unsigned int i = 0; i < CHANNEL_BITMAP_LISTS; i++) {
+        if (member[i])
+            gScanListBitmap[i][word] |= bit;
+        else
+            gScanListBitmap[i][word] &= ~bit;
+    }
+
+    if (gMR_ChannelExclude[channel])
+        gExcludeBitmap[word] |= bit;
+    else
+        gExcludeBitmap[word] &= ~bit;
+}
+
+// channels of one bitmap word that RADIO_CheckValidChannel() would accept
+static uint32_t RADIO_ValidChannelWord(unsigned int word, bool checkScanList, uint8_t scanList)
+{
+    if (!checkScanList)
+        return gScanListBitmap[CHANNEL_BITMAP_LISTS - 1][word];
+
+    uint32_t bits = gExcludeBitmap[word];
+
+    if (scanList > 4)
+        return gScanListBitmap[CHANNEL_BITMAP_LISTS - 1][word] & ~bits;
+
+    const uint8_t PriorityCh1 = gEeprom.SCANLIST_PRIORITY_CH1[scanList - 1];
+    const uint8_t PriorityCh2 = gEeprom.SCANLIST_PRIORITY_CH2[scanList - 1];
+
+    if (PriorityCh1 / 32 == word)
+        bits |= 1u << (PriorityCh1 % 32);
+    if (PriorityCh2 / 32 == word)
+        bits |= 1u << (PriorityCh2 % 32);
+
+    return gScanListBitmap[scanList][word] & ~bits;
+}
+
 uint8_t RADIO_FindNextChannel(uint8_t Channel, int8_t Direction, bool bCheckScanList, uint8_t VFO)
 {
-    for (unsigned int i = 0; IS_MR_CHANNEL(i); i++, Channel += Direction) {
-        if (Channel == 0xFF) {
-            Channel = MR_CHANNEL_LAST;
-        } else if (!IS_MR_CHANNEL(Channel)) {
-            Channel = MR_CHANNEL_FIRST;
-        }
+    if (Channel == 0xFF) {
+        Channel = MR_CHANNEL_LAST;
+    } else if (!IS_MR_CHANNEL(Channel)) {
+        Channel = MR_CHANNEL_FIRST;
+    }
 
-        if (RADIO_CheckValidChannel(Channel, bCheckScanList, VFO)) {
-            return Channel;
+    // walk the words from the start channel, wrapping around; the last pass
+    // comes back to the first word for the channels behind the start
+    unsigned int word = Channel / 32;
+    uint32_t     bits = RADIO_ValidChannelWord(word, bCheckScanList, VFO);
+
+    if (Direction > 0) {
+        bits &= ~0u << (Channel % 32);
+        for (unsigned int i = 0; i <= CHANNEL_BITMAP_WORDS; i++) {
+            if (bits)
+                return word * 32 + __builtin_ctz(bits);
+            word = (word + 1) % CHANNEL_BITMAP_WORDS;
+            bits = RADIO_ValidChannelWord(word, bCheckScanList, VFO);
+        }
+    } else {
+        bits &= ~0u >> (31 - (Channel % 32));
+        for (unsigned int i = 0; i <= CHANNEL_BITMAP_WORDS; i++) {
+            if (bits)
+                return word * 32 + 31 - __builtin_clz(bits);
+            word = (word == 0) ? CHANNEL_BITMAP_WORDS - 1 : word - 1;
+            bits = RADIO_ValidChannelWord(word, bCheckScanList, VFO);
         }
     }
 
@@ -42,8 +42,6 @@
                 flag = true;             \
     } while (0)
 
-static volatile uint32_t gGlobalSysTickCounter;
-
 void SystickHandler(void);
 
 // we come here every 10ms
@@ -40,6 +40,49 @@ static const uint32_t gDefaultFrequencyTable[] =
 
 EEPROM_Config_t gEeprom = { 0 };
 
+#ifdef ENABLE_CHANNEL_INDEX
+// RAM copy of the channel fields read on every redraw and scan step, so those
+// paths stay off the I2C bus. Anything that writes the channel (0000..0C7F) or
+// name (0F50..1BCF) areas must refresh the affected range.
+static uint32_t gMR_ChannelFrequency[MR_CHANNEL_LAST + 1];
+static char     gMR_ChannelName[MR_CHANNEL_LAST + 1][10];
+
+static void SETTINGS_LoadChannelIndex(void)
+{
+    uint8_t Data[8 * 16];   // 8 channels per read
+
+    for (unsigned int channel = 0; IS_MR_CHANNEL(channel); channel += 8)
+    {
+        unsigned int i;
+
+        EEPROM_ReadBuffer(channel * 16, Data, sizeof(Data));
+        for (i = 0; i < 8; i++)
+            memcpy(&gMR_ChannelFrequency[channel + i], &Data[i * 16], 4);
+
+        EEPROM_ReadBuffer(0x0F50 + (channel * 16), Data, sizeof(Data));
+        for (i = 0; i < 8; i++)
+            memcpy(gMR_ChannelName[channel + i], &Data[i * 16], 10);
+    }
+}
+
+void SETTINGS_RefreshChannelIndex(uint16_t Address, uint16_t Size)
+{
+    const uint16_t End = Address + Size;
+
+    for (unsigned int channel = 0; IS_MR_CHANNEL(channel); channel++)
+    {
+        const uint16_t Info = channel * 16;
+        const uint16_t Name = 0x0F50 + (channel * 16);
+
+        if (Info < End && Info + 4 > Address)
+            EEPROM_ReadBuffer(Info, &gMR_ChannelFrequency[channel], 4);
+
+        if (Name < End && Name + 10 > Address)
+            EEPROM_ReadBuffer(Name, gMR_ChannelName[channel], 10);
+    }
+}
+#endif
+
 void SETTINGS_InitEEPROM(void)
 {
     uint8_t Data[16] = {0};
@@ -324,8 +367,14 @@ void SETTINGS_InitEEPROM(void)
             att->band = 0x7;
         }
         gMR_ChannelExclude[i] = false;
+        RADIO_UpdateChannelBitmaps(i);
     }
 
+#ifdef ENABLE_CHANNEL_INDEX
+    // 0000..0C7F, 0F50..1BCF
+    SETTINGS_LoadChannelIndex();
+#endif
+
         // 0F30..0F3F
         EEPROM_ReadBuffer(0x0F30, gCustomAesKey, sizeof(gCustomAesKey));
         bHasCustomAesKey = false;
@@ -455,6 +504,9 @@ void SETTINGS_LoadCalibration(void)
 
 uint32_t SETTINGS_FetchChannelFrequency(const int channel)
 {
+#ifdef ENABLE_CHANNEL_INDEX
+    return gMR_ChannelFrequency[channel];
+#else
     struct
     {
         uint32_t frequency;
@@ -464,6 +516,7 @@ uint32_t SETTINGS_FetchChannelFrequency(const int channel)
     EEPROM_ReadBuffer(channel * 16, &info, sizeof(info));
 
     return info.frequency;
+#endif
 }
 
 void SETTINGS_FetchChannelName(char *s, const int channel)
@@ -479,7 +532,11 @@ void SETTINGS_FetchChannelName(char *s, const int channel)
     if (!RADIO_CheckValidChannel(channel, false, 0))
         return;
 
+#ifdef ENABLE_CHANNEL_INDEX
+    memcpy(s, gMR_ChannelName[channel], 10);
+#else
     EEPROM_ReadBuffer(0x0F50 + (channel * 16), s, 10);
+#endif
 
     int i;
     for (i = 0; i < 10; i++)
@@ -522,6 +579,10 @@ void SETTINGS_FactoryReset(bool bIsAll)
         }
     }
 
+#ifdef ENABLE_CHANNEL_INDEX
+    SETTINGS_LoadChannelIndex();
+#endif
+
     if (bIsAll)
     {
         RADIO_InitInfo(gRxVfo, FREQ_CHANNEL_FIRST + BAND6_400MHz, 43350000);
@@ -874,6 +935,11 @@ void SETTINGS_SaveChannel(uint8_t Channel, uint8_t VFO, const VFO_Info_t *pVFO,
 #endif
         EEPROM_WriteBuffer(OffsetVFO + 8, State._8);
 
+#ifdef ENABLE_CHANNEL_INDEX
+        if (IS_MR_CHANNEL(Channel))
+            gMR_ChannelFrequency[Channel] = pVFO->freq_config_RX.Frequency;
+#endif
+
         SETTINGS_UpdateChannel(Channel, pVFO, true, true, true);
 
         if (IS_MR_CHANNEL(Channel)) {
@@ -907,6 +973,11 @@ void SETTINGS_SaveChannelName(uint8_t channel, const char * name)
     memcpy(buf, name, MIN(strlen(name), 10u));
     EEPROM_WriteBuffer(0x0F50 + offset, buf);
     EEPROM_WriteBuffer(0x0F58 + offset, buf + 8);
+
+#ifdef ENABLE_CHANNEL_INDEX
+    if (IS_MR_CHANNEL(channel))
+        memcpy(gMR_ChannelName[channel], buf, 10);
+#endif
 }
 
 void SETTINGS_UpdateChannel(uint8_t channel, const VFO_Info_t *pVFO, bool keep, bool check, bool save)
@@ -949,6 +1020,7 @@ void SETTINGS_UpdateChannel(uint8_t channel, const VFO_Info_t *pVFO, bool keep,
 #endif
 
         gMR_ChannelAttributes[channel] = att;
+        RADIO_UpdateChannelBitmaps(channel);
 
         if (IS_MR_CHANNEL(channel)) {   // it's a memory channel
             if (!keep) {
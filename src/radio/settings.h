@@ -310,6 +310,9 @@ void     SETTINGS_InitEEPROM(void);
 void     SETTINGS_LoadCalibration(void);
 uint32_t SETTINGS_FetchChannelFrequency(const int channel);
 void     SETTINGS_FetchChannelName(char *s, const int channel);
+#ifdef ENABLE_CHANNEL_INDEX
+    void SETTINGS_RefreshChannelIndex(uint16_t Address, uint16_t Size);
+#endif
 void     SETTINGS_FactoryReset(bool bIsAll);
 #ifdef ENABLE_FMRADIO
     void SETTINGS_SaveFM(void);
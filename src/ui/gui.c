@@ -4,6 +4,9 @@
 #include <string.h>
 
 #include "app/uart.h"
+#if defined(ENABLE_LCD_DMA) && !defined(ENABLE_LCD_DMA_DOUBLE_BUFFER)
+#include "driver/u8g2_hal.h"
+#endif
 #include "font/font_10_tr.h"
 #include "font/font_5_tr.h"
 #include "font/font_8_tr.h"
@@ -18,6 +21,22 @@ UI_Context gUiCtx;
 
 static char ui_buffer[UI_CHAR_BUFFER_SIZE];
 
+#ifdef ENABLE_LCD_PARTIAL_REFRESH
+// Only the display pages (8 pixel rows each) that changed since the last
+// flush are sent. A page is compared through a checksum of its bytes, or with
+// ENABLE_LCD_SHADOW_BUFFER against a copy of the last frame, which also
+// narrows the update down to the changed tile columns.
+#define UI_PAGES (UI_H / 8)
+#define UI_TILES (UI_W / 8)
+
+#ifdef ENABLE_LCD_SHADOW_BUFFER
+static uint8_t  ui_shadow[UI_PAGES * UI_W];
+#else
+static uint32_t ui_page_sum[UI_PAGES];
+#endif
+static bool     ui_shadow_valid;
+#endif
+
 static void UI_DrawXbm(u8g2_uint_t x, u8g2_uint_t y, bool color,
                        u8g2_uint_t w, u8g2_uint_t h, const uint8_t *bits)
 {
@@ -68,6 +87,71 @@ void UI_ClearDisplay(void)
     u8g2_ClearBuffer(gUiCtx.lcd);
 }
 
+#ifdef ENABLE_LCD_PARTIAL_REFRESH
+#ifndef ENABLE_LCD_SHADOW_BUFFER
+static uint32_t UI_PageChecksum(const uint8_t *page)
+{
+    uint32_t sum = 2166136261u;     // FNV-1a
+
+    for (unsigned int i = 0; i < UI_W; i++) {
+        sum ^= page[i];
+        sum *= 16777619u;
+    }
+
+    return sum;
+}
+#endif
+
+static void UI_SendChangedPages(void)
+{
+    const uint8_t *buffer = u8g2_GetBufferPtr(gUiCtx.lcd);
+
+    if (!ui_shadow_valid) {
+        u8g2_SendBuffer(gUiCtx.lcd);
+#ifdef ENABLE_LCD_SHADOW_BUFFER
+        memcpy(ui_shadow, buffer, sizeof(ui_shadow));
+#else
+        for (unsigned int page = 0; page < UI_PAGES; page++)
+            ui_page_sum[page] = UI_PageChecksum(buffer + page * UI_W);
+#endif
+        ui_shadow_valid = true;
+        return;
+    }
+
+    for (unsigned int page = 0; page < UI_PAGES; page++) {
+        const uint8_t *row = buffer + page * UI_W;
+
+#ifdef ENABLE_LCD_SHADOW_BUFFER
+        uint8_t *shadow = ui_shadow + page * UI_W;
+        int      first  = -1;
+        int      last   = -1;
+
+        for (unsigned int tile = 0; tile < UI_TILES; tile++) {
+            if (memcmp(row + tile * 8, shadow + tile * 8, 8) != 0) {
+                if (first < 0)
+                    first = tile;
+                last = tile;
+            }
+        }
+
+        if (first < 0)
+            continue;
+
+        memcpy(shadow + first * 8, row + first * 8, (last - first + 1) * 8);
+        u8g2_UpdateDisplayArea(gUiCtx.lcd, first, page, last - first + 1, 1);
+#else
+        const uint32_t sum = UI_PageChecksum(row);
+
+        if (sum == ui_page_sum[page])
+            continue;
+
+        ui_page_sum[page] = sum;
+        u8g2_UpdateDisplayArea(gUiCtx.lcd, 0, page, UI_TILES, 1);
+#endif
+    }
+}
+#endif
+
 void UI_UpdateDisplay(void)
 {
     if (gUiCtx.lcd == NULL) {
@@ -81,9 +165,19 @@ void UI_UpdateDisplay(void)
                       UI_GetStrValue(UI_INFO_MESSAGE_STR, (uint8_t)gUiCtx.info_message - 1));
     }
 
+#ifdef ENABLE_LCD_PARTIAL_REFRESH
+    UI_SendChangedPages();
+#else
     u8g2_SendBuffer(gUiCtx.lcd);
+#endif
 
     sendScreenBuffer(u8g2_GetBufferPtr(gUiCtx.lcd), 1024);
+
+#if defined(ENABLE_LCD_DMA) && !defined(ENABLE_LCD_DMA_DOUBLE_BUFFER)
+    // the frame streams out of the buffer itself: nothing may clear or
+    // draw into it until it has gone
+    U8G2_HAL_WaitIdle();
+#endif
 }
 
 void UI_TimeOut(void)
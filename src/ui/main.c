@@ -32,6 +32,9 @@
 #include "printf.h"
 #include "functions.h"
 #include "helper/battery.h"
+#ifdef ENABLE_RSSI_LUT
+    #include "helper/rssi.h"
+#endif
 #include "misc.h"
 #include "radio.h"
 #include "settings.h"
@@ -231,6 +234,9 @@ void UI_DisplayAudioBar(void)
 #endif
 
 
+#ifdef ENABLE_RSSI_LUT
+    #define convertRSSIToSLevel RSSI_DBmToSLevel
+#else
 uint8_t convertRSSIToSLevel(int16_t rssi_dBm)
 {
     static const int16_t sLevelThresholds[] = {
@@ -245,6 +251,7 @@ uint8_t convertRSSIToSLevel(int16_t rssi_dBm)
 
     return 10;
 }
+#endif
 
 static inline int16_t convertRSSIToPlusDB(int16_t rssi_dBm)
 {
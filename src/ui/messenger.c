@@ -30,7 +30,11 @@ void UI_DisplayMSG(void) {
 	UI_DrawBox(0, 56, 128, 8);
 
     UI_SetFont(FONT_8B_TR);
-    UI_DrawString(UI_TEXT_ALIGN_LEFT, 2, 0, 6, false, false, false, "MESSENGER");
+	if (MSG_GetScrollBack() != 0) {
+		UI_DrawStringf(UI_TEXT_ALIGN_LEFT, 2, 0, 6, false, false, false, "HISTORY -%u", MSG_GetScrollBack());
+	} else {
+		UI_DrawString(UI_TEXT_ALIGN_LEFT, 2, 0, 6, false, false, false, "MESSENGER");
+	}
 	UI_DrawString(UI_TEXT_ALIGN_RIGHT, 0, 126, 6, true, true, false, keyboardType == NUMERIC ? "-123-" : "-ABC-");
 
 	/*if ( msgStatus == SENDING ) {
@@ -46,7 +50,7 @@ void UI_DisplayMSG(void) {
 	uint8_t mPos = 14;
 	const uint8_t mLine = 7;
 	for (uint8_t i = 0; i < MAX_LINES; ++i) {
-		UI_DrawString(UI_TEXT_ALIGN_LEFT, 2, 0, mPos, true, false, false, rxMessage[i]);
+		UI_DrawString(UI_TEXT_ALIGN_LEFT, 2, 0, mPos, true, false, false, MSG_GetLine(i));
 		mPos += mLine;
     }
 
@@ -23,6 +23,7 @@
     #include "app/fm.h"
 #endif
 #include "driver/keyboard.h"
+#include "helper/profiler.h"
 #include "misc.h"
 #ifdef ENABLE_AIRCOPY
     #include "ui/aircopy.h"
@@ -79,7 +80,9 @@ static_assert(ARRAY_SIZE(UI_DisplayFunctions) == DISPLAY_N_ELEM);
 void GUI_DisplayScreen(void)
 {
     if (gScreenToDisplay != DISPLAY_INVALID) {
+        PROFILE_BEGIN(PROFILER_DISPLAY);
         UI_DisplayFunctions[gScreenToDisplay]();
+        PROFILE_END(PROFILER_DISPLAY);
     }
 }
 
@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+"""Read or write the whole EEPROM over the fast transfer commands (ENABLE_UART_FAST_EEPROM=1).
+
+    eeprom_clone.py /dev/ttyUSB0 read backup.bin            dump 0x0000-0x2000
+    eeprom_clone.py /dev/ttyUSB0 write backup.bin           write 0x0000-0x1E00 and
+                                                            read it back to verify
+    eeprom_clone.py /dev/ttyUSB0 write backup.bin --calibration    include 0x1E00-0x2000
+    eeprom_clone.py --baud 460800 ...                       if the cable can't do 921600
+    eeprom_clone.py --sim-script write backup.bin --period 60 > clone.txt
+                                                            the same as a make sim script,
+                                                            frames sent every 60 ms
+    eeprom_clone.py --decode uart.out -o image.bin          decode a captured session
+
+The session starts with a plain (not obfuscated) 0x0514 hello, which turns
+the obfuscation off, then 0x0604 moves both ends to the fast baud rate.
+Reads are one 0x0606 request answered by a run of CRC'd chunks. Writes are
+whole pages; the radio acknowledges a frame before burning it, so the next
+frame is sent as soon as the acknowledgement arrives and crosses the wire
+while the previous one is being written. A failed burn shows in the next
+acknowledgement, so the transfer ends with an empty frame that only asks
+how the last one went.
+"""
+
+import argparse
+import random
+import struct
+import sys
+import time
+
+OBFUSCATION = bytes([
+    0x16, 0x6C, 0x14, 0xE6, 0x2E, 0x91, 0x0D, 0x40, 0x21, 0x35, 0xD5, 0x40, 0x13, 0x03, 0xE9, 0x80
+])
+
+CMD_HELLO = 0x0514
+CMD_BAUD = 0x0604
+CMD_READ = 0x0606
+CMD_WRITE = 0x0608
+
+REPLY_HELLO = 0x0515
+REPLY_BAUD = 0x0605
+REPLY_READ = 0x0607
+REPLY_WRITE = 0x0609
+
+DEFAULT_BAUD = 115200
+EEPROM_SIZE = 0x2000
+CALIBRATION = 0x1E00
+PAGE_SIZE = 32
+WRITE_MAX = 224
+
+STATUS = {0x01: 'rejected', 0x02: 'locked', 0x80: 'previous frame did not burn in'}
+
+
+def describe(status):
+    return ', '.join(text for bit, text in STATUS.items() if status & bit)
+
+
+def crc16_xmodem(data):
+    crc = 0
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def xor(data):
+    return bytes(b ^ OBFUSCATION[i % 16] for i, b in enumerate(data))
+
+
+def build_request(cmd, body):
+    payload = struct.pack('<HH', cmd, len(body)) + body
+    return (b'\xAB\xCD' + struct.pack('<H', len(payload)) + payload +
+            struct.pack('<H', crc16_xmodem(payload)) + b'\xDC\xBA')
+
+
+def hello(session):
+    return build_request(CMD_HELLO, struct.pack('<I', session))
+
+
+def set_baud(session, baud):
+    return build_request(CMD_BAUD, struct.pack('<II', session, baud))
+
+
+def read(session, offset, size):
+    return build_request(CMD_READ, struct.pack('<HHI', offset, size, session))
+
+
+def write(session, offset, data):
+    return build_request(CMD_WRITE, struct.pack('<HBBI', offset, len(data), 0, session) + data)
+
+
+def write_frames(session, image, start, end):
+    for offset in range(start, end, WRITE_MAX):
+        yield offset, write(session, offset, image[offset:min(offset + WRITE_MAX, end)])
+    yield end, write(session, end, b'')
+
+
+class Replies:
+    """Incremental reply parser; feed() bytes as they arrive, get (id, body) pairs."""
+
+    def __init__(self):
+        self.buffer = b''
+
+    def feed(self, data):
+        self.buffer += data
+        replies = []
+        while True:
+            i = self.buffer.find(b'\xAB\xCD')
+            if i < 0:
+                self.buffer = self.buffer[-1:]
+                return replies
+            if len(self.buffer) - i < 4:
+                self.buffer = self.buffer[i:]
+                return replies
+            size = struct.unpack_from('<H', self.buffer, i + 2)[0]
+            end = i + 4 + size + 4
+            if len(self.buffer) < end:
+                self.buffer = self.buffer[i:]
+                return replies
+            if self.buffer[end - 2:end] != b'\xDC\xBA' or size < 4:
+                self.buffer = self.buffer[i + 2:]
+                continue
+            payload = self.buffer[i + 4:i + 4 + size]
+            self.buffer = self.buffer[end:]
+            ident = struct.unpack_from('<H', payload)[0]
+            if ident not in (REPLY_HELLO, REPLY_BAUD, REPLY_READ, REPLY_WRITE):
+                payload = xor(payload)
+                ident = struct.unpack_from('<H', payload)[0]
+            replies.append((ident, payload[4:]))
+
+
+class Image:
+    """Collects 0x0607 chunks."""
+
+    def __init__(self):
+        self.data = bytearray(b'\xFF' * EEPROM_SIZE)
+        self.have = bytearray(EEPROM_SIZE)
+        self.bad_crc = 0
+
+    def add(self, body):
+        offset, size, _, crc = struct.unpack_from('<HBBH', body)
+        chunk = body[6:6 + size]
+        if len(chunk) != size or crc16_xmodem(chunk) != crc:
+            self.bad_crc += 1
+            return 0
+        self.data[offset:offset + size] = chunk
+        self.have[offset:offset + size] = b'\x01' * size
+        return size
+
+    def missing(self, start, end):
+        """First [from, to) run not received yet, or None."""
+        try:
+            first = self.have.index(0, start, end)
+        except ValueError:
+            return None
+        try:
+            return first, self.have.index(1, first, end)
+        except ValueError:
+            return first, end
+
+
+class Link:
+    def __init__(self, port, baud):
+        import serial
+        self.port = serial.Serial(port, DEFAULT_BAUD, timeout=0.05)
+        self.port.reset_input_buffer()
+        self.replies = Replies()
+        self.pending = []
+        self.session = random.getrandbits(32)
+        self.fast = baud
+
+    def send(self, frame):
+        self.port.write(frame)
+
+    def wait(self, ident, timeout=1.0):
+        limit = time.time() + timeout
+        while time.time() < limit:
+            for i, (got, body) in enumerate(self.pending):
+                if got == ident:
+                    del self.pending[i]
+                    return body
+            self.pending += self.replies.feed(self.port.read(4096))
+        raise TimeoutError('no reply 0x%04X from the radio' % ident)
+
+    def open(self):
+        self.send(hello(self.session))
+        version = self.wait(REPLY_HELLO)[:16].split(b'\0')[0].decode(errors='replace')
+        print('radio firmware %s' % version, file=sys.stderr)
+        self.baud(self.fast)
+
+    def baud(self, rate):
+        self.send(set_baud(self.session, rate))
+        accepted, max_read, max_write, page = struct.unpack('<IHBB', self.wait(REPLY_BAUD)[:8])
+        if accepted == 0:
+            raise RuntimeError('the radio refused %d baud' % rate)
+        self.port.baudrate = accepted
+        self.port.reset_input_buffer()
+        self.replies = Replies()
+
+    def close(self):
+        try:
+            self.baud(DEFAULT_BAUD)
+        finally:
+            self.port.close()
+
+    def read(self, start, end):
+        image = Image()
+        run = (start, end)
+        while run is not None:
+            self.send(read(self.session, run[0], run[1] - run[0]))
+            limit = time.time() + 2.0
+            while time.time() < limit and image.missing(*run) is not None:
+                for ident, body in self.replies.feed(self.port.read(4096)):
+                    if ident == REPLY_READ:
+                        image.add(body)
+            if image.missing(*run) == run:
+                raise TimeoutError('no data for 0x%04X-0x%04X' % run)
+            run = image.missing(start, end)
+        return image
+
+    def write(self, image, start, end):
+        # one frame in flight: the radio's RX ring holds 256 bytes
+        for offset, frame in write_frames(self.session, image, start, end):
+            self.send(frame)
+            status = struct.unpack_from('<HB', self.wait(REPLY_WRITE))[1]
+            if status:
+                raise RuntimeError('write at 0x%04X: %s' % (offset, describe(status)))
+
+
+def sim_script(args, image):
+    """Open loop: every frame at a fixed period, the make sim UART has no host to answer."""
+    session = 0x5EED5EED
+    esc = lambda frame: ''.join('\\x%02X' % b for b in frame)
+    t = 3000    # past the boot screen
+    lines = ['%d uart %s' % (t, esc(hello(session)))]
+    t += 100
+    lines.append('%d uart %s' % (t, esc(set_baud(session, args.baud))))
+    t += 100
+    start, end = 0, CALIBRATION if (args.action == 'write' and not args.calibration) else EEPROM_SIZE
+    if args.action == 'write':
+        for _, frame in write_frames(session, image, start, end):
+            lines.append('%d uart %s' % (t, esc(frame)))
+            t += args.period
+        t += 100
+    lines.append('%d uart %s' % (t, esc(read(session, start, end - start))))
+    lines.append('%d quit' % (t + 2000))
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port', nargs='?', help='serial port of the radio')
+    parser.add_argument('action', nargs='?', choices=['read', 'write'])
+    parser.add_argument('image', nargs='?', help='EEPROM image file')
+    parser.add_argument('--baud', type=int, default=921600, help='transfer rate (default 921600)')
+    parser.add_argument('--calibration', action='store_true', help='also write 0x1E00-0x2000')
+    parser.add_argument('--sim-script', nargs=2, metavar=('ACTION', 'IMAGE'), help='print a make sim script')
+    parser.add_argument('--period', type=int, default=60, help='ms between write frames in a sim script')
+    parser.add_argument('--decode', metavar='FILE', help='decode a captured session')
+    parser.add_argument('-o', '--output', help='image decoded from the read chunks')
+    args = parser.parse_args()
+
+    if args.sim_script:
+        args.action, path = args.sim_script
+        sys.stdout.write(sim_script(args, open(path, 'rb').read() if args.action == 'write' else b''))
+        return 0
+
+    if args.decode:
+        image = Image()
+        counts = {}
+        for ident, body in Replies().feed(open(args.decode, 'rb').read()):
+            counts[ident] = counts.get(ident, 0) + 1
+            if ident == REPLY_READ:
+                image.add(body)
+            elif ident == REPLY_WRITE and body[2]:
+                print('write at 0x%04X: %s' % (struct.unpack_from('<H', body)[0], describe(body[2])), file=sys.stderr)
+        print('%d write acks, %d read chunks, %d bytes read, %d bad crc' %
+              (counts.get(REPLY_WRITE, 0), counts.get(REPLY_READ, 0), sum(image.have), image.bad_crc), file=sys.stderr)
+        if args.output:
+            open(args.output, 'wb').write(image.data)
+        return 0 if image.bad_crc == 0 else 1
+
+    if not (args.port and args.action and args.image):
+        parser.print_usage()
+        return 2
+
+    link = Link(args.port, args.baud)
+    link.open()
+    try:
+        begin = time.time()
+        if args.action == 'read':
+            image = link.read(0, EEPROM_SIZE)
+            open(args.image, 'wb').write(image.data)
+            print('read %d bytes in %.2f s' % (EEPROM_SIZE, time.time() - begin), file=sys.stderr)
+        else:
+            data = open(args.image, 'rb').read()
+            end = EEPROM_SIZE if args.calibration else CALIBRATION
+            if len(data) < end:
+                raise RuntimeError('%s holds %d bytes, need %d' % (args.image, len(data), end))
+            link.write(data, 0, end)
+            written = time.time()
+            check = link.read(0, end)
+            bad = [i for i in range(end) if check.data[i] != data[i]]
+            print('wrote %d bytes in %.2f s, verified in %.2f s, %s' %
+                  (end, written - begin, time.time() - written,
+                   'identical' if not bad else '%d bytes differ from 0x%04X' % (len(bad), bad[0])), file=sys.stderr)
+            if bad:
+                return 1
+    finally:
+        link.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Read and print the firmware profiler table (ENABLE_PROFILER=1).
+
+    profiler.py /dev/ttyUSB0            query the radio and print the report
+    profiler.py /dev/ttyUSB0 --reset    same, then clear the table on the radio
+    profiler.py --request               print the request as a C-escaped string
+                                        (for a "uart" line in a make sim script)
+    profiler.py --decode uart.out       decode replies captured to a file
+"""
+
+import argparse
+import struct
+import sys
+
+OBFUSCATION = bytes([
+    0x16, 0x6C, 0x14, 0xE6, 0x2E, 0x91, 0x0D, 0x40, 0x21, 0x35, 0xD5, 0x40, 0x13, 0x03, 0xE9, 0x80
+])
+
+PROBES = ['slice 10ms', 'radio irq', 'display', 'am fix', 'uart']
+
+CMD_PROFILER = 0x0603
+CPU_HZ = 48000000
+
+
+def crc16_xmodem(data):
+    crc = 0
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def xor(data):
+    return bytes(b ^ OBFUSCATION[i % 16] for i, b in enumerate(data))
+
+
+def build_request(reset):
+    payload = struct.pack('<HHB', CMD_PROFILER, 1, 1 if reset else 0)
+    body = payload + struct.pack('<H', crc16_xmodem(payload))
+    return b'\xAB\xCD' + struct.pack('<H', len(payload)) + xor(body) + b'\xDC\xBA'
+
+
+def find_replies(stream):
+    """Yield de-obfuscated reply payloads found in a byte stream."""
+    i = 0
+    while True:
+        i = stream.find(b'\xAB\xCD', i)
+        if i < 0 or i + 4 > len(stream):
+            return
+        size = struct.unpack_from('<H', stream, i + 2)[0]
+        end = i + 4 + size + 4
+        if end <= len(stream) and stream[end - 2:end] == b'\xDC\xBA':
+            payload = stream[i + 4:i + 4 + size]
+            if struct.unpack_from('<H', payload)[0] != CMD_PROFILER:
+                payload = xor(payload)
+            yield payload
+            i = end
+        else:
+            i += 2
+
+
+def decode(payload):
+    msg_id, size = struct.unpack_from('<HH', payload)
+    if msg_id != CMD_PROFILER:
+        return None
+    cycles_per_slice, count = struct.unpack_from('<IB', payload, 4)
+    entries = []
+    for n in range(count):
+        calls, cmin, cmax, overruns, total = struct.unpack_from('<IIIIQ', payload, 12 + n * 24)
+        entries.append((PROBES[n] if n < len(PROBES) else 'probe %d' % n, calls, cmin, cmax, overruns, total))
+    return cycles_per_slice, entries
+
+
+def report(cycles_per_slice, entries):
+    us = lambda cycles: cycles * 1e6 / CPU_HZ
+    print('%-12s %10s %10s %10s %10s %9s %8s' % ('probe', 'calls', 'min us', 'avg us', 'max us', 'overruns', 'slice %'))
+    for name, calls, cmin, cmax, overruns, total in entries:
+        if calls == 0:
+            print('%-12s %10d %10s %10s %10s %9s %8s' % (name, 0, '-', '-', '-', '-', '-'))
+            continue
+        avg = total / calls
+        print('%-12s %10d %10.1f %10.1f %10.1f %9d %7.1f%%' %
+              (name, calls, us(cmin), us(avg), us(cmax), overruns, 100.0 * avg / cycles_per_slice))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port', nargs='?', help='serial port of the radio')
+    parser.add_argument('--reset', action='store_true', help='clear the table after reading it')
+    parser.add_argument('--request', action='store_true', help='print the request bytes and exit')
+    parser.add_argument('--decode', metavar='FILE', help='decode a captured UART stream')
+    args = parser.parse_args()
+
+    if args.request:
+        print(''.join('\\x%02X' % b for b in build_request(args.reset)))
+        return 0
+
+    if args.decode:
+        stream = open(args.decode, 'rb').read()
+    elif args.port:
+        import serial
+        with serial.Serial(args.port, 115200, timeout=1) as port:
+            port.reset_input_buffer()
+            port.write(build_request(args.reset))
+            stream = port.read(512)
+    else:
+        parser.print_usage()
+        return 2
+
+    found = False
+    for payload in find_replies(stream):
+        table = decode(payload)
+        if table:
+            report(*table)
+            found = True
+
+    if not found:
+        print('no profiler reply (built with ENABLE_PROFILER=1?)', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""Record the spectrum analyzer's per-step samples (ENABLE_SPECTRUM_STREAM=1).
+
+    spectrum_stream.py /dev/ttyUSB0 -o sweeps.csv         start the stream, record
+                                                          until Ctrl-C, stop it
+    spectrum_stream.py /dev/ttyUSB0 --fields rssi,noise,glitch --seconds 10 -o s.csv
+    spectrum_stream.py --request start [--fields ...]     print a request as a
+    spectrum_stream.py --request stop                     C-escaped string (for a
+                                                          "uart" line in a make sim script)
+    spectrum_stream.py --decode uart.out -o sweeps.csv    decode a captured stream
+
+The CSV has one row per sample: sweep, step index, frequency in Hz, then the
+recorded fields (RSSI is the raw BK4819 value, dBm = rssi / 2 - 160).
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import time
+
+OBFUSCATION = bytes([
+    0x16, 0x6C, 0x14, 0xE6, 0x2E, 0x91, 0x0D, 0x40, 0x21, 0x35, 0xD5, 0x40, 0x13, 0x03, 0xE9, 0x80
+])
+
+CMD_STREAM_START = 0x0A05
+CMD_STREAM_STOP = 0x0A06
+
+MARKER = b'\xAB\xEE'
+HEADER = struct.Struct('<HBBHHIHBB')
+ESCAPE = 0x80
+
+FIELDS = [('rssi', 0x01, 2), ('noise', 0x02, 1), ('glitch', 0x04, 1)]
+LAST = 0x80
+
+
+def crc16_xmodem(data):
+    crc = 0
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def xor(data):
+    return bytes(b ^ OBFUSCATION[i % 16] for i, b in enumerate(data))
+
+
+def build_request(cmd, fields=0):
+    payload = struct.pack('<HH', cmd, 1 if cmd == CMD_STREAM_START else 0)
+    if cmd == CMD_STREAM_START:
+        payload += bytes([fields])
+    body = payload + struct.pack('<H', crc16_xmodem(payload))
+    return b'\xAB\xCD' + struct.pack('<H', len(payload)) + xor(body) + b'\xDC\xBA'
+
+
+def parse_fields(text):
+    mask = 0
+    for name in text.split(','):
+        match = [bit for field, bit, _ in FIELDS if field == name.strip()]
+        if not match:
+            raise argparse.ArgumentTypeError('unknown field %r' % name)
+        mask |= match[0]
+    return mask
+
+
+class Decoder:
+    """Incremental frame decoder; feed() bytes as they arrive, get (rows, fields) batches."""
+
+    def __init__(self):
+        self.buffer = b''
+        self.frames = 0
+        self.bad_crc = 0
+        self.lost = 0
+        self.sweeps = 0
+        self.samples = 0
+        self.payload_bytes = 0
+        self.next_seq = None
+
+    def feed(self, data):
+        self.buffer += data
+        batches = []
+        while True:
+            i = self.buffer.find(MARKER)
+            if i < 0:
+                self.buffer = self.buffer[-1:]
+                return batches
+            if len(self.buffer) - i < HEADER.size:
+                self.buffer = self.buffer[i:]
+                return batches
+            _, seq, flags, sweep, index, freq, step, count, length = HEADER.unpack_from(self.buffer, i)
+            end = i + HEADER.size + length + 2
+            if len(self.buffer) < end:
+                self.buffer = self.buffer[i:]
+                return batches
+            body = self.buffer[i + 2:end - 2]
+            if crc16_xmodem(body) != struct.unpack_from('<H', self.buffer, end - 2)[0]:
+                self.bad_crc += 1
+                self.buffer = self.buffer[i + 2:]
+                continue
+            self.buffer = self.buffer[end:]
+
+            if self.next_seq is not None:
+                self.lost += (seq - self.next_seq) & 0xFF
+            self.next_seq = (seq + 1) & 0xFF
+            self.frames += 1
+            self.payload_bytes += length
+            if flags & LAST:
+                self.sweeps += 1
+            batches.append(self.decode_samples(body[HEADER.size - 2:], flags, sweep, index, freq, step, count))
+
+    def decode_samples(self, payload, flags, sweep, index, freq, step, count):
+        fields = [(name, size) for name, bit, size in FIELDS if flags & bit]
+        prev = [0] * len(fields)
+        rows = []
+        p = 0
+        for n in range(count):
+            values = []
+            for k, (_, size) in enumerate(fields):
+                b = payload[p]
+                p += 1
+                if b == ESCAPE:
+                    prev[k] = int.from_bytes(payload[p:p + size], 'little')
+                    p += size
+                else:
+                    prev[k] = (prev[k] + (b - 256 if b & 0x80 else b)) & 0xFFFF
+                values.append(prev[k])
+            rows.append([sweep, index + n, (freq + n * step) * 10] + values)
+        self.samples += count
+        return rows, fields
+
+    def report(self, seconds=None):
+        rate = ''
+        if seconds:
+            rate = ', %.1f sweeps/s' % (self.sweeps / seconds)
+        per = self.payload_bytes / self.samples if self.samples else 0
+        print('%d frames, %d sweeps, %d samples (%.2f payload bytes/sample), %d lost, %d bad crc%s' %
+              (self.frames, self.sweeps, self.samples, per, self.lost, self.bad_crc, rate), file=sys.stderr)
+
+
+def record(decoder, chunks, out):
+    writer = None
+    for chunk in chunks:
+        for rows, fields in decoder.feed(chunk):
+            if out is None:
+                continue
+            if writer is None:
+                writer = csv.writer(out)
+                writer.writerow(['sweep', 'index', 'frequency_hz'] + [name for name, _ in fields])
+            writer.writerows(rows)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port', nargs='?', help='serial port of the radio')
+    parser.add_argument('-o', '--output', help='CSV file to write the samples to')
+    parser.add_argument('--fields', type=parse_fields, default=0x01, help='rssi,noise,glitch (default rssi)')
+    parser.add_argument('--seconds', type=float, help='stop recording after this long')
+    parser.add_argument('--request', choices=['start', 'stop'], help='print the request bytes and exit')
+    parser.add_argument('--decode', metavar='FILE', help='decode a captured UART stream')
+    args = parser.parse_args()
+
+    if args.request:
+        cmd = CMD_STREAM_START if args.request == 'start' else CMD_STREAM_STOP
+        print(''.join('\\x%02X' % b for b in build_request(cmd, args.fields)))
+        return 0
+
+    decoder = Decoder()
+    out = open(args.output, 'w', newline='') if args.output else None
+
+    if args.decode:
+        record(decoder, [open(args.decode, 'rb').read()], out)
+        decoder.report()
+    elif args.port:
+        import serial
+        with serial.Serial(args.port, 115200, timeout=0.1) as port:
+            port.reset_input_buffer()
+            port.write(build_request(CMD_STREAM_START, args.fields))
+            start = time.time()
+
+            def chunks():
+                while args.seconds is None or time.time() - start < args.seconds:
+                    yield port.read(4096)
+
+            try:
+                record(decoder, chunks(), out)
+            except KeyboardInterrupt:
+                pass
+            port.write(build_request(CMD_STREAM_STOP))
+            decoder.report(time.time() - start)
+    else:
+        parser.print_usage()
+        return 2
+
+    if out:
+        out.close()
+    return 0 if decoder.frames else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())